@@ -0,0 +1,7 @@
+/* Offline prefab cook tool: cook <input directory> <output directory> [--threads N] [--force] [--binary] [--archive <file>] */
+#include "svh/cook.hpp"
+#include "prefab_types.hpp"
+
+int main(int argc, char** argv) {
+	return svh::CookMain<CookedPrefab>(argc, argv);
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "svh/serializer.hpp"
+#include "svh/std_types.hpp"
+
+#include <map>				// for std::map
+#include <string>			// for std::string
+#include <vector>			// for std::vector
+
+/* The prefab type the cook tool is built for, replace it with the project's own type */
+
+struct CookedItem {
+	std::string name;
+	int count = 0;
+};
+VISITABLE_STRUCT(CookedItem, name, count);
+
+struct CookedEntity {
+	std::string name;
+	std::vector<float> position;
+	std::vector<CookedItem> items;
+	std::map<std::string, int> stats;
+};
+VISITABLE_STRUCT(CookedEntity, name, position, items, stats);
+
+using CookedPrefab = CookedEntity;
@@ -0,0 +1,314 @@
+#pragma once
+#include "svh/serializer.hpp"
+#include "svh/binary.hpp"
+#include "svh/mapped_file.hpp"
+
+#include <cstdint>			// for std::uint32_t, std::uint64_t
+#include <cstring>			// for std::memcpy
+#include <filesystem>		// for std::filesystem
+#include <fstream>			// for std::ifstream, std::ofstream
+#include <iterator>			// for std::istreambuf_iterator
+#include <map>				// for std::map
+#include <memory>			// for std::shared_ptr
+#include <mutex>			// for std::unique_lock
+#include <shared_mutex>		// for std::shared_mutex, std::shared_lock
+#include <string>			// for std::string
+#include <string_view>		// for std::string_view
+#include <unordered_map>	// for std::unordered_map
+#include <vector>			// for std::vector
+
+namespace svh {
+
+	/* Archive layout: header, binary prefabs at 16 byte aligned offsets, index records sorted by id, ids. */
+	/* Header: "SVHA", version, byte order, 2 reserved bytes, entry count, 4 reserved bytes, index offset, ids offset */
+	constexpr char ARCHIVE_MAGIC[] = { 'S', 'V', 'H', 'A' };
+	constexpr std::uint8_t ARCHIVE_VERSION = 1;
+	constexpr std::size_t ARCHIVE_HEADER_SIZE = 32;
+
+	/* One index record, 40 bytes in the file */
+	struct ArchiveEntry {
+		/* Offset of the id in the ids block */
+		std::uint64_t id_offset = 0;
+		std::uint32_t id_length = 0;
+		std::uint32_t reserved = 0;
+		/* Binary prefab of the entry, from the start of the file */
+		std::uint64_t offset = 0;
+		std::uint64_t length = 0;
+		/* Binary::SchemaHash of the type it was written from */
+		std::uint64_t schema = 0;
+	};
+
+	/* Collects binary prefabs by id and writes them as one archive */
+	class ArchiveWriter {
+	public:
+		template<typename T>
+		void Add(const std::string& id, const T& value, StringTable strings = StringTable::Keys) {
+			entries[id] = Binary::Write(value, strings);
+		}
+
+		/* Adds a binary prefab written by Binary::Write, returns false if bytes is not one */
+		bool AddBinary(const std::string& id, std::vector<std::uint8_t> bytes) {
+			if (!IsBinary(bytes.data(), bytes.size())) {
+				return false;
+			}
+			entries[id] = std::move(bytes);
+			return true;
+		}
+
+		std::size_t Size() const {
+			return entries.size();
+		}
+
+		/* Returns false if the file could not be written */
+		bool Save(const std::string& path) const {
+			std::vector<ArchiveEntry> index;
+			index.reserve(entries.size());
+			std::uint64_t offset = ARCHIVE_HEADER_SIZE;
+			std::uint64_t id_offset = 0;
+			/* std::map keeps the ids sorted for the binary search in PrefabArchive */
+			for (const auto& [id, bytes] : entries) {
+				ArchiveEntry entry;
+				entry.id_offset = id_offset;
+				entry.id_length = static_cast<std::uint32_t>(id.size());
+				entry.offset = offset;
+				entry.length = bytes.size();
+				std::memcpy(&entry.schema, bytes.data() + BINARY_HEADER_SIZE - sizeof(std::uint64_t), sizeof(std::uint64_t));
+				index.push_back(entry);
+				offset = Align(offset + bytes.size());
+				id_offset += id.size();
+			}
+			const std::uint64_t index_offset = offset;
+			const std::uint64_t ids_offset = index_offset + index.size() * sizeof(ArchiveEntry);
+
+			std::ofstream file(path, std::ios::binary | std::ios::trunc);
+			if (!file) {
+				return false;
+			}
+			const std::uint32_t count = static_cast<std::uint32_t>(index.size());
+			const std::uint8_t order = NativeByteOrder();
+			const std::uint16_t reserved16 = 0;
+			const std::uint32_t reserved32 = 0;
+			file.write(ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+			Put(file, ARCHIVE_VERSION);
+			Put(file, order);
+			Put(file, reserved16);
+			Put(file, count);
+			Put(file, reserved32);
+			Put(file, index_offset);
+			Put(file, ids_offset);
+
+			std::uint64_t written = ARCHIVE_HEADER_SIZE;
+			for (const auto& [id, bytes] : entries) {
+				file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+				written += bytes.size();
+				const std::uint64_t aligned = Align(written);
+				for (; written < aligned; ++written) file.put('\0');
+			}
+			static_assert(sizeof(ArchiveEntry) == 40, "archive index records are 40 bytes");
+			file.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size() * sizeof(ArchiveEntry)));
+			for (const auto& item : entries) {
+				file.write(item.first.data(), static_cast<std::streamsize>(item.first.size()));
+			}
+			return static_cast<bool>(file);
+		}
+
+	private:
+		std::map<std::string, std::vector<std::uint8_t>> entries;
+
+		static std::uint64_t Align(std::uint64_t offset) {
+			return (offset + BINARY_ALIGNMENT - 1) / BINARY_ALIGNMENT * BINARY_ALIGNMENT;
+		}
+
+		template<typename T>
+		static void Put(std::ofstream& file, const T& value) {
+			file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+	};
+
+	/* Read-only view of an archive through a memory mapping. */
+	/* Opening only checks the header, an entry is decoded on its first Get and kept until it is released. */
+	/* Pages of entries that are never read are never loaded, and processes that open the same archive share them */
+	class PrefabArchive {
+	public:
+		/* Returns false if the file can not be mapped or is not an archive */
+		bool Open(const std::string& path) {
+			Close();
+			if (!file.Open(path)) {
+				return false;
+			}
+			const std::uint8_t* data = file.Data();
+			const std::size_t size = file.Size();
+			if (size < ARCHIVE_HEADER_SIZE || std::memcmp(data, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0 ||
+				data[4] != ARCHIVE_VERSION || data[5] != NativeByteOrder()) {
+				file.Close();
+				return false;
+			}
+			std::uint32_t entry_count = 0;
+			std::memcpy(&entry_count, data + 8, sizeof(entry_count));
+			std::memcpy(&index_offset, data + 16, sizeof(index_offset));
+			std::memcpy(&ids_offset, data + 24, sizeof(ids_offset));
+			if (index_offset > size || ids_offset > size || ids_offset < index_offset || (ids_offset - index_offset) / sizeof(ArchiveEntry) != entry_count) {
+				file.Close();
+				return false;
+			}
+			count = entry_count;
+			return true;
+		}
+
+		void Close() {
+			std::unique_lock<std::shared_mutex> lock(mutex);
+			decoded.clear();
+			file.Close();
+			count = 0;
+		}
+
+		bool IsOpen() const {
+			return file.IsOpen();
+		}
+
+		std::size_t Size() const {
+			return count;
+		}
+
+		bool Contains(std::string_view id) const {
+			return Find(id) < count;
+		}
+
+		/* Every id, in sorted order */
+		std::vector<std::string> Ids() const {
+			std::vector<std::string> ids;
+			ids.reserve(count);
+			for (std::size_t i = 0; i < count; ++i) {
+				ids.emplace_back(IdAt(Entry(i)));
+			}
+			return ids;
+		}
+
+		/* The entry of id decoded as T, null if there is no such entry. */
+		/* An entry written from another type is reported through Deserializer::HandleError */
+		template<typename T>
+		std::shared_ptr<const T> Get(std::string_view id) {
+			const std::size_t position = Find(id);
+			if (position >= count) {
+				return nullptr;
+			}
+			/* Checked before the cache too, the decoded object is cast back to T */
+			const ArchiveEntry entry = Entry(position);
+			if (entry.schema != Binary::SchemaHash<T>()) {
+				Deserializer::HandleError("Archive entry schema does not match the type", json(std::string(id)));
+				return nullptr;
+			}
+			{
+				std::shared_lock<std::shared_mutex> lock(mutex);
+				auto it = decoded.find(position);
+				if (it != decoded.end()) {
+					return std::static_pointer_cast<const T>(it->second);
+				}
+			}
+			/* Decoded without the lock, two threads asking for the same entry both decode it */
+			auto value = std::make_shared<T>();
+			if (!Binary::Read(file.Data() + entry.offset, static_cast<std::size_t>(entry.length), *value)) {
+				return nullptr;
+			}
+			std::unique_lock<std::shared_mutex> lock(mutex);
+			auto inserted = decoded.emplace(position, std::shared_ptr<const void>(value));
+			return std::static_pointer_cast<const T>(inserted.first->second);
+		}
+
+		/* The binary prefab of id inside the mapping, null if there is no such entry */
+		const std::uint8_t* Bytes(std::string_view id, std::size_t& length) const {
+			const std::size_t position = Find(id);
+			if (position >= count) {
+				length = 0;
+				return nullptr;
+			}
+			const ArchiveEntry entry = Entry(position);
+			length = static_cast<std::size_t>(entry.length);
+			return file.Data() + entry.offset;
+		}
+
+		bool IsDecoded(std::string_view id) const {
+			const std::size_t position = Find(id);
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			return decoded.find(position) != decoded.end();
+		}
+
+		std::size_t DecodedCount() const {
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			return decoded.size();
+		}
+
+		/* Drops the decoded object of id, the next Get decodes it again. Objects handed out stay alive */
+		void Release(std::string_view id) {
+			const std::size_t position = Find(id);
+			std::unique_lock<std::shared_mutex> lock(mutex);
+			decoded.erase(position);
+		}
+
+		void ReleaseAll() {
+			std::unique_lock<std::shared_mutex> lock(mutex);
+			decoded.clear();
+		}
+
+	private:
+		MappedFile file;
+		std::size_t count = 0;
+		std::uint64_t index_offset = 0;
+		std::uint64_t ids_offset = 0;
+		mutable std::shared_mutex mutex;
+		std::unordered_map<std::size_t, std::shared_ptr<const void>> decoded;
+
+		/* Records are copied out, the index is only 8 byte aligned in the file */
+		ArchiveEntry Entry(std::size_t position) const {
+			ArchiveEntry entry;
+			std::memcpy(&entry, file.Data() + index_offset + position * sizeof(ArchiveEntry), sizeof(ArchiveEntry));
+			return entry;
+		}
+
+		std::string_view IdAt(const ArchiveEntry& entry) const {
+			const std::uint64_t begin = ids_offset + entry.id_offset;
+			if (begin > file.Size() || entry.id_length > file.Size() - begin) {
+				return std::string_view();
+			}
+			return std::string_view(reinterpret_cast<const char*>(file.Data() + begin), entry.id_length);
+		}
+
+		/* Binary search over the sorted records, count if id is not found */
+		std::size_t Find(std::string_view id) const {
+			std::size_t low = 0;
+			std::size_t high = count;
+			while (low < high) {
+				const std::size_t middle = low + (high - low) / 2;
+				if (IdAt(Entry(middle)) < id) {
+					low = middle + 1;
+				} else {
+					high = middle;
+				}
+			}
+			if (low < count) {
+				const ArchiveEntry entry = Entry(low);
+				if (IdAt(entry) == id && entry.offset <= file.Size() && entry.length <= file.Size() - entry.offset) {
+					return low;
+				}
+			}
+			return count;
+		}
+	};
+
+	/* Packs every binary .prefab file under directory into an archive, ids are relative paths without extension. */
+	/* Returns the number of entries, files that are not binary prefabs are skipped */
+	inline std::size_t PackArchive(const std::filesystem::path& directory, const std::string& path, const std::string& extension = ".prefab") {
+		ArchiveWriter writer;
+		std::error_code error;
+		for (std::filesystem::recursive_directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+			if (!it->is_regular_file() || it->path().extension() != extension) {
+				continue;
+			}
+			std::ifstream input(it->path(), std::ios::binary);
+			std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+			auto relative = std::filesystem::relative(it->path(), directory);
+			writer.AddBinary(relative.replace_extension().generic_string(), std::move(bytes));
+		}
+		return writer.Save(path) ? writer.Size() : 0;
+	}
+}
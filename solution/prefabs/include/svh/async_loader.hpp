@@ -0,0 +1,293 @@
+#pragma once
+#include "svh/serializer.hpp"
+#include "svh/cooked.hpp"
+#include "svh/binary.hpp"
+
+#include <algorithm>		// for std::max
+#include <atomic>			// for std::atomic
+#include <condition_variable>	// for std::condition_variable
+#include <cstdint>			// for std::uint64_t
+#include <fstream>			// for std::ifstream
+#include <functional>		// for std::function
+#include <future>			// for std::promise, std::shared_future
+#include <memory>			// for std::shared_ptr
+#include <mutex>			// for std::mutex
+#include <queue>			// for std::priority_queue
+#include <sstream>			// for std::stringstream
+#include <stdexcept>		// for std::runtime_error
+#include <string>			// for std::string
+#include <thread>			// for std::thread
+#include <unordered_map>	// for std::unordered_map
+#include <vector>			// for std::vector
+
+namespace svh {
+
+	/* Stored in the future of a load that was cancelled before it finished */
+	class LoadCancelled : public std::runtime_error {
+	public:
+		explicit LoadCancelled(const std::string& path) : std::runtime_error("Load cancelled: " + path) {}
+	};
+
+	/* Shared flag to cancel loads that did not finish yet, copies refer to the same flag */
+	class CancelToken {
+	public:
+		CancelToken() : flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+		void Cancel() { flag->store(true); }
+		bool IsCancelled() const { return flag->load(); }
+
+	private:
+		std::shared_ptr<std::atomic<bool>> flag;
+	};
+
+	/* Fixed set of worker threads running tasks by priority, higher first. */
+	/* Tasks with the same priority run in the order they were submitted. The destructor runs the queued tasks first */
+	class LoadPool {
+	public:
+		/* 0 = hardware concurrency */
+		explicit LoadPool(unsigned thread_count = 0) {
+			if (thread_count == 0) {
+				thread_count = std::max(1u, std::thread::hardware_concurrency());
+			}
+			threads.reserve(thread_count);
+			for (unsigned t = 0; t < thread_count; ++t) {
+				threads.emplace_back([this]() { Work(); });
+			}
+		}
+
+		~LoadPool() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			condition.notify_all();
+			for (auto& thread : threads) {
+				thread.join();
+			}
+		}
+
+		LoadPool(const LoadPool&) = delete;
+		LoadPool& operator=(const LoadPool&) = delete;
+
+		void Submit(int priority, std::function<void()> task) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				tasks.push({ priority, next_sequence++, std::move(task) });
+			}
+			condition.notify_one();
+		}
+
+		unsigned ThreadCount() const {
+			return static_cast<unsigned>(threads.size());
+		}
+
+	private:
+		struct Task {
+			int priority;
+			std::uint64_t sequence;
+			std::function<void()> run;
+		};
+
+		/* Highest priority first, then the oldest */
+		struct Later {
+			bool operator()(const Task& a, const Task& b) const {
+				if (a.priority != b.priority) return a.priority < b.priority;
+				return a.sequence > b.sequence;
+			}
+		};
+
+		std::vector<std::thread> threads;
+		std::priority_queue<Task, std::vector<Task>, Later> tasks;
+		std::mutex mutex;
+		std::condition_variable condition;
+		std::uint64_t next_sequence = 0;
+		bool stopping = false;
+
+		void Work() {
+			for (;;) {
+				Task task;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+					if (tasks.empty()) {
+						return;
+					}
+					/* top() is const, the task is only moved out right before pop() */
+					task = std::move(const_cast<Task&>(tasks.top()));
+					tasks.pop();
+				}
+				task.run();
+			}
+		}
+	};
+
+	/* Used by LoadAsync and LoadManyAsync */
+	inline LoadPool& DefaultLoadPool() {
+		static LoadPool pool;
+		return pool;
+	}
+
+	/* Reads the bytes of a prefab file. Errors go through Deserializer::HandleError */
+	inline std::string ReadPrefabContent(const std::string& path) {
+		std::ifstream file(path, std::ios::binary);
+		if (!file) {
+			Deserializer::HandleError("prefab file", json(path));
+			return std::string();
+		}
+		std::stringstream buffer;
+		buffer << file.rdbuf();
+		return buffer.str();
+	}
+
+	/* Reads and decodes a prefab file, json text or cooked. Errors go through Deserializer::HandleError */
+	inline json ReadPrefabFile(const std::string& path) {
+		json j;
+		if (!ParsePrefabContent(ReadPrefabContent(path), j)) {
+			Deserializer::HandleError("prefab file", json(path));
+			return json();
+		}
+		return j;
+	}
+
+	/* Reads, parses and deserializes path into promise. parsed(json) is called between parsing and deserializing, */
+	/* binary prefabs are read straight into the object and never call it */
+	template<typename T, typename Parsed>
+	void LoadPrefabFile(const std::string& path, const CancelToken& token, std::promise<T>& promise, Parsed&& parsed) {
+		try {
+			if (token.IsCancelled()) {
+				throw LoadCancelled(path);
+			}
+			const std::string content = ReadPrefabContent(path);
+			T value{};
+			if (IsBinary(content)) {
+				Binary::Read(content, value);
+				promise.set_value(std::move(value));
+				return;
+			}
+			json j;
+			if (!ParsePrefabContent(content, j)) {
+				Deserializer::HandleError("prefab file", json(path));
+			}
+			parsed(j);
+			if (token.IsCancelled()) {
+				throw LoadCancelled(path);
+			}
+			Deserializer::FromJson(j, value);
+			promise.set_value(std::move(value));
+		} catch (...) {
+			promise.set_exception(std::current_exception());
+		}
+	}
+
+	/* Loads prefab files of type T on a pool. Every path is loaded once, later requests share the same future. */
+	/* When a references function is set, the paths it returns for a parsed file are queued right away, */
+	/* before that file is deserialized, so referenced prefabs are read while their parent is still being built */
+	template<typename T>
+	class AsyncLoader {
+	public:
+		using References = std::function<std::vector<std::string>(const json&)>;
+
+		explicit AsyncLoader(LoadPool& pool = DefaultLoadPool()) : pool(pool) {}
+
+		/* Waits for the loads that are still queued or running, they point to this loader */
+		~AsyncLoader() {
+			std::unique_lock<std::mutex> lock(mutex);
+			idle.wait(lock, [this]() { return pending == 0; });
+		}
+
+		AsyncLoader(const AsyncLoader&) = delete;
+		AsyncLoader& operator=(const AsyncLoader&) = delete;
+
+		/* Has to be set before the first load */
+		void SetReferences(References function) {
+			references = std::move(function);
+		}
+
+		std::shared_future<T> Load(const std::string& path, int priority = 0, CancelToken token = CancelToken()) {
+			std::lock_guard<std::mutex> lock(mutex);
+			return LoadLocked(path, priority, std::move(token));
+		}
+
+		std::vector<std::shared_future<T>> LoadMany(const std::vector<std::string>& paths, int priority = 0, CancelToken token = CancelToken()) {
+			std::vector<std::shared_future<T>> futures;
+			futures.reserve(paths.size());
+			std::lock_guard<std::mutex> lock(mutex);
+			for (const auto& path : paths) {
+				futures.push_back(LoadLocked(path, priority, token));
+			}
+			return futures;
+		}
+
+		/* Drops the finished and pending futures, the next Load reads the file again */
+		void Clear() {
+			std::lock_guard<std::mutex> lock(mutex);
+			loads.clear();
+		}
+
+	private:
+		struct Entry {
+			std::shared_future<T> future;
+			CancelToken token;
+		};
+
+		LoadPool& pool;
+		References references;
+		std::mutex mutex;
+		std::unordered_map<std::string, Entry> loads;
+		std::condition_variable idle;
+		std::size_t pending = 0;
+
+		std::shared_future<T> LoadLocked(const std::string& path, int priority, CancelToken token) {
+			auto it = loads.find(path);
+			/* A cancelled path is loaded again */
+			if (it != loads.end() && !it->second.token.IsCancelled()) {
+				return it->second.future;
+			}
+			auto promise = std::make_shared<std::promise<T>>();
+			std::shared_future<T> future = promise->get_future().share();
+			loads[path] = { future, token };
+			++pending;
+			pool.Submit(priority, [this, path, priority, token, promise]() {
+				LoadPrefabFile(path, token, *promise, [&](const json& j) {
+					if (references) {
+						Prefetch(references(j), priority, token);
+					}
+				});
+				std::lock_guard<std::mutex> lock(mutex);
+				if (--pending == 0) {
+					idle.notify_all();
+				}
+			});
+			return future;
+		}
+
+		void Prefetch(const std::vector<std::string>& paths, int priority, const CancelToken& token) {
+			std::lock_guard<std::mutex> lock(mutex);
+			for (const auto& path : paths) {
+				LoadLocked(path, priority, token);
+			}
+		}
+	};
+
+	/* Loads one prefab file on the default pool, nothing is cached */
+	template<typename T>
+	std::future<T> LoadAsync(const std::string& path, int priority = 0, CancelToken token = CancelToken()) {
+		auto promise = std::make_shared<std::promise<T>>();
+		std::future<T> future = promise->get_future();
+		DefaultLoadPool().Submit(priority, [path, token, promise]() {
+			LoadPrefabFile(path, token, *promise, [](const json&) {});
+		});
+		return future;
+	}
+
+	/* Same as above for every path, the files are read, parsed and deserialized in parallel */
+	template<typename T>
+	std::vector<std::future<T>> LoadManyAsync(const std::vector<std::string>& paths, int priority = 0, CancelToken token = CancelToken()) {
+		std::vector<std::future<T>> futures;
+		futures.reserve(paths.size());
+		for (const auto& path : paths) {
+			futures.push_back(LoadAsync<T>(path, priority, token));
+		}
+		return futures;
+	}
+}
@@ -0,0 +1,613 @@
+#pragma once
+#include "svh/serializer.hpp"
+#include "svh/std_types.hpp"
+
+#include <array>			// for std::array
+#include <cstddef>			// for std::size_t
+#include <cstdint>			// for std::uint8_t, std::uint32_t, std::uint64_t
+#include <cstring>			// for std::memcpy
+#include <deque>			// for std::deque
+#include <fstream>			// for std::ofstream
+#include <limits>			// for std::numeric_limits
+#include <list>				// for std::list
+#include <memory>			// for std::shared_ptr, std::unique_ptr
+#include <optional>			// for std::optional
+#include <string>			// for std::string
+#include <string_view>		// for std::string_view
+#include <tuple>			// for std::tuple, std::apply
+#include <type_traits>		// for std::is_trivially_copyable
+#include <unordered_map>	// for std::unordered_map
+#include <utility>			// for std::index_sequence
+#include <vector>			// for std::vector
+
+/* Native binary prefab format, see Binary below */
+
+namespace svh {
+
+	/* Specialize for trivially copyable types without padding that are not visitable, like glm::vec3, */
+	/* to store them and vectors of them as raw blocks: template<> struct svh::is_bulk_copyable<glm::vec3> : std::true_type {}; */
+	template<typename T>
+	struct is_bulk_copyable : std::false_type {};
+
+	/* "SVHB", format version, byte order, 16 bit flags, 64 bit schema hash */
+	constexpr char BINARY_MAGIC[] = { 'S', 'V', 'H', 'B' };
+	constexpr std::uint8_t BINARY_VERSION = 1;
+	constexpr std::size_t BINARY_HEADER_SIZE = 16;
+	/* Raw blocks start at a multiple of this from the start of the buffer */
+	constexpr std::size_t BINARY_ALIGNMENT = 16;
+	/* Header flags, string map keys or all strings are stored once in a table after the header */
+	constexpr std::uint16_t BINARY_INTERN_KEYS = 1;
+	constexpr std::uint16_t BINARY_INTERN_VALUES = 2;
+
+	/* Which strings Binary::Write stores in the string table, the others are written where they are used */
+	enum class StringTable { None, Keys, KeysAndValues };
+
+	inline bool IsBinary(const void* data, std::size_t size) {
+		return size >= BINARY_HEADER_SIZE && std::memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0;
+	}
+
+	inline bool IsBinary(const std::string& content) {
+		return IsBinary(content.data(), content.size());
+	}
+
+	/* 1 on little-endian machines, raw blocks are only valid on machines with the same byte order */
+	inline std::uint8_t NativeByteOrder() {
+		const std::uint16_t probe = 1;
+		std::uint8_t first;
+		std::memcpy(&first, &probe, 1);
+		return first;
+	}
+
+	/* Schema hashes are 64 bit FNV-1a over a description of the type */
+	constexpr std::uint64_t SCHEMA_HASH_SEED = 14695981039346656037ull;
+
+	constexpr std::uint64_t HashSchema(std::uint64_t hash, const char* text) {
+		for (; *text != '\0'; ++text) {
+			hash = (hash ^ static_cast<unsigned char>(*text)) * 1099511628211ull;
+		}
+		return (hash ^ 0xff) * 1099511628211ull;
+	}
+
+	constexpr std::uint64_t HashSchema(std::uint64_t hash, std::uint64_t value) {
+		for (int i = 0; i < 8; ++i) {
+			hash = (hash ^ ((value >> (i * 8)) & 0xff)) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	/* Native binary format with a header and length-prefixed containers. */
+	/* Numbers, enums, bulk copyable types and visitable structs of those without padding are stored as they are in memory, */
+	/* vectors and arrays of them as one aligned block that loads with a single memcpy. */
+	/* The header holds a schema hash of T computed at compile time from the field names and types, */
+	/* a file written for a different layout of T is rejected instead of misread. */
+	/* Types the format does not know, for example those with custom SerializeImpl functions, are stored as MessagePack. */
+	/* Field names are never stored. Repeated map keys and string values can be stored once in a string table */
+	/* and referenced by a varint index, the reader resolves them to views of the buffer */
+	class Binary {
+	public: /* API */
+
+		template<typename T>
+		static constexpr std::uint64_t SchemaHash() {
+			return TypeHash<T>();
+		}
+
+		/* True if T and arrays and vectors of T are stored as raw blocks */
+		template<typename T>
+		static constexpr bool IsBulk() {
+			if constexpr (is_bulk_copyable<T>::value) {
+				return true;
+			} else if constexpr (std::is_same_v<T, bool>) {
+				return false;
+			} else if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>) {
+				return true;
+			} else if constexpr (std::is_array_v<T>) {
+				return IsBulk<std::remove_extent_t<T>>();
+			} else if constexpr (is_std_array_v<T>) {
+				return IsBulk<typename T::value_type>();
+			} else if constexpr (is_visitable_v<T> && std::is_trivially_copyable_v<T>) {
+				return BulkStruct<T>(std::make_index_sequence<visit_struct::field_count<T>()>{});
+			} else {
+				return false;
+			}
+		}
+
+		template<typename T>
+		static std::vector<std::uint8_t> Write(const T& value, StringTable strings = StringTable::Keys) {
+			Writer writer;
+			writer.intern_keys = strings != StringTable::None;
+			writer.intern_values = strings == StringTable::KeysAndValues;
+			writer.bytes.reserve(256);
+			writer.Raw(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+			writer.Pod(BINARY_VERSION);
+			writer.Pod(NativeByteOrder());
+			writer.Pod(std::uint16_t(0));
+			writer.Pod(SchemaHash<T>());
+			WriteImpl(writer, value);
+			if (!writer.table.empty()) {
+				writer.InsertTable();
+			}
+			return std::move(writer.bytes);
+		}
+
+		/* Returns false and reports through Deserializer::HandleError if data is not a binary T */
+		template<typename T>
+		static bool Read(const void* data, std::size_t size, T& value) {
+			Reader reader{ static_cast<const std::uint8_t*>(data), size };
+			if (!IsBinary(data, size)) {
+				return Fail("Not a binary prefab", reader);
+			}
+			reader.offset = sizeof(BINARY_MAGIC);
+			std::uint8_t version = 0, order = 0;
+			std::uint16_t flags = 0;
+			std::uint64_t schema = 0;
+			reader.Pod(version);
+			reader.Pod(order);
+			reader.Pod(flags);
+			reader.Pod(schema);
+			if (version != BINARY_VERSION || order != NativeByteOrder()) {
+				return Fail("Unsupported binary prefab version or byte order", reader);
+			}
+			if (schema != SchemaHash<T>()) {
+				return Fail("Binary prefab schema does not match the type", reader);
+			}
+			reader.intern_keys = (flags & BINARY_INTERN_KEYS) != 0;
+			reader.intern_values = (flags & BINARY_INTERN_VALUES) != 0;
+			if (reader.intern_keys || reader.intern_values) {
+				reader.ReadTable();
+			}
+			ReadImpl(reader, value);
+			if (!reader.ok) {
+				return Fail("Truncated or corrupt binary prefab", reader);
+			}
+			return true;
+		}
+
+		template<typename T>
+		static bool Read(const std::vector<std::uint8_t>& bytes, T& value) {
+			return Read(bytes.data(), bytes.size(), value);
+		}
+
+		template<typename T>
+		static bool Read(const std::string& content, T& value) {
+			return Read(content.data(), content.size(), value);
+		}
+
+	private: /* Types */
+
+		template<typename T>
+		static constexpr bool is_sequence_container_v = is_std_vector_v<T> || is_specialization<T, std::deque>::value || is_specialization<T, std::list>::value;
+
+		struct Writer {
+			std::vector<std::uint8_t> bytes;
+			bool intern_keys = false;
+			bool intern_values = false;
+			/* Views of the strings in the value being written, in the order they were first used */
+			std::vector<std::string_view> table;
+			std::unordered_map<std::string_view, std::uint32_t> table_index;
+
+			void Raw(const void* data, std::size_t size) {
+				const auto* begin = static_cast<const std::uint8_t*>(data);
+				bytes.insert(bytes.end(), begin, begin + size);
+			}
+
+			template<typename T>
+			void Pod(const T& value) {
+				Raw(&value, sizeof(T));
+			}
+
+			void Align() {
+				bytes.resize((bytes.size() + BINARY_ALIGNMENT - 1) / BINARY_ALIGNMENT * BINARY_ALIGNMENT, 0);
+			}
+
+			void Count(std::size_t count) {
+				if (count > std::numeric_limits<std::uint32_t>::max()) {
+					Deserializer::HandleError("Container too large for a binary prefab", json(count));
+				}
+				Pod(static_cast<std::uint32_t>(count));
+			}
+
+			void Varint(std::uint64_t value) {
+				while (value >= 0x80) {
+					bytes.push_back(static_cast<std::uint8_t>(value | 0x80));
+					value >>= 7;
+				}
+				bytes.push_back(static_cast<std::uint8_t>(value));
+			}
+
+			void String(const std::string& value, bool key) {
+				if (key ? !intern_keys : !intern_values) {
+					Count(value.size());
+					Raw(value.data(), value.size());
+					return;
+				}
+				auto inserted = table_index.emplace(std::string_view(value), static_cast<std::uint32_t>(table.size()));
+				if (inserted.second) {
+					table.push_back(value);
+				}
+				Varint(inserted.first->second);
+			}
+
+			/* Puts the table between the header and the body, padded so the raw blocks in the body stay aligned */
+			void InsertTable() {
+				std::vector<std::uint8_t> document;
+				std::swap(bytes, document);
+				Varint(table.size());
+				for (const auto& item : table) {
+					Varint(item.size());
+					Raw(item.data(), item.size());
+				}
+				bytes.resize((bytes.size() + BINARY_ALIGNMENT - 1) / BINARY_ALIGNMENT * BINARY_ALIGNMENT, 0);
+				const std::uint16_t flags = BINARY_INTERN_KEYS | (intern_values ? BINARY_INTERN_VALUES : 0);
+				std::memcpy(document.data() + 6, &flags, sizeof(flags));
+				document.insert(document.begin() + BINARY_HEADER_SIZE, bytes.begin(), bytes.end());
+				bytes = std::move(document);
+			}
+		};
+
+		/* Bounds checked, a failed read sets ok to false and every read after it does nothing */
+		struct Reader {
+			const std::uint8_t* data;
+			std::size_t size;
+			std::size_t offset = 0;
+			bool ok = true;
+			bool intern_keys = false;
+			bool intern_values = false;
+			/* Views into data, strings are copied out of the table without a lookup allocation */
+			std::vector<std::string_view> table;
+
+			Reader(const std::uint8_t* bytes, std::size_t length) : data(bytes), size(length) {}
+
+			std::size_t Remaining() const {
+				return size - offset;
+			}
+
+			const std::uint8_t* Take(std::size_t count) {
+				if (!ok || count > Remaining()) {
+					ok = false;
+					return nullptr;
+				}
+				const std::uint8_t* at = data + offset;
+				offset += count;
+				return at;
+			}
+
+			void Raw(void* target, std::size_t count) {
+				if (const std::uint8_t* at = Take(count)) {
+					if (count != 0) std::memcpy(target, at, count);
+				}
+			}
+
+			template<typename T>
+			void Pod(T& value) {
+				Raw(&value, sizeof(T));
+			}
+
+			void Align() {
+				const std::size_t aligned = (offset + BINARY_ALIGNMENT - 1) / BINARY_ALIGNMENT * BINARY_ALIGNMENT;
+				Take(aligned - offset);
+			}
+
+			std::uint64_t Varint() {
+				std::uint64_t value = 0;
+				for (int shift = 0; shift < 64; shift += 7) {
+					const std::uint8_t* at = Take(1);
+					if (at == nullptr) {
+						return 0;
+					}
+					value |= static_cast<std::uint64_t>(*at & 0x7f) << shift;
+					if ((*at & 0x80) == 0) {
+						return value;
+					}
+				}
+				ok = false;
+				return 0;
+			}
+
+			void ReadTable() {
+				const std::uint64_t count = Varint();
+				if (count > Remaining()) {
+					ok = false;
+					return;
+				}
+				table.reserve(static_cast<std::size_t>(count));
+				for (std::uint64_t i = 0; i < count && ok; ++i) {
+					const std::uint64_t length = Varint();
+					if (length > Remaining()) {
+						ok = false;
+						return;
+					}
+					const std::uint8_t* at = Take(static_cast<std::size_t>(length));
+					table.emplace_back(reinterpret_cast<const char*>(at), static_cast<std::size_t>(length));
+				}
+				Align();
+			}
+
+			void String(std::string& value, bool key) {
+				if (key ? !intern_keys : !intern_values) {
+					const std::size_t length = Count(1);
+					if (const std::uint8_t* at = Take(length)) {
+						value.assign(reinterpret_cast<const char*>(at), length);
+					}
+					return;
+				}
+				const std::uint64_t index = Varint();
+				if (!ok || index >= table.size()) {
+					ok = false;
+					return;
+				}
+				value.assign(table[static_cast<std::size_t>(index)]);
+			}
+
+			/* Element counts are checked against the bytes left, a corrupt count can not allocate more than the file */
+			std::size_t Count(std::size_t element_size) {
+				std::uint32_t count = 0;
+				Pod(count);
+				if (ok && static_cast<std::uint64_t>(count) * (element_size == 0 ? 1 : element_size) > Remaining()) {
+					ok = false;
+				}
+				return ok ? count : 0;
+			}
+		};
+
+	private: /* Schema */
+
+		template<typename T, std::size_t... I>
+		static constexpr bool BulkStruct(std::index_sequence<I...>) {
+			return (IsBulk<visit_struct::type_at<I, T>>() && ...) &&
+				(sizeof(visit_struct::type_at<I, T>) + ... + std::size_t(0)) == sizeof(T);
+		}
+
+		/* Visited holds the structs being hashed, a struct that contains itself hashes its depth instead */
+		template<typename T, typename... Visited>
+		static constexpr std::uint64_t TypeHash(std::uint64_t hash = SCHEMA_HASH_SEED) {
+			if constexpr ((std::is_same_v<T, Visited> || ...)) {
+				return HashSchema(HashSchema(hash, "recursive"), RecursionDepth<T, Visited...>());
+			} else if constexpr (is_visitable_v<T>) {
+				hash = HashSchema(HashSchema(hash, "struct"), visit_struct::field_count<T>());
+				return FieldsHash<T, Visited...>(hash, std::make_index_sequence<visit_struct::field_count<T>()>{});
+			} else if constexpr (std::is_same_v<T, bool>) {
+				return HashSchema(hash, "bool");
+			} else if constexpr (std::is_floating_point_v<T>) {
+				return HashSchema(HashSchema(hash, "float"), sizeof(T));
+			} else if constexpr (std::is_integral_v<T>) {
+				return HashSchema(HashSchema(hash, std::is_signed_v<T> ? "int" : "uint"), sizeof(T));
+			} else if constexpr (std::is_enum_v<T>) {
+				return HashSchema(HashSchema(hash, "enum"), sizeof(T));
+			} else if constexpr (is_bulk_copyable<T>::value) {
+				return HashSchema(HashSchema(hash, "bulk"), sizeof(T));
+			} else if constexpr (is_string_v<T>) {
+				return HashSchema(hash, "string");
+			} else if constexpr (std::is_array_v<T>) {
+				return TypeHash<std::remove_extent_t<T>, Visited...>(HashSchema(HashSchema(hash, "array"), std::extent_v<T>));
+			} else if constexpr (is_std_array_v<T>) {
+				return TypeHash<typename T::value_type, Visited...>(HashSchema(HashSchema(hash, "array"), std::tuple_size<T>::value));
+			} else if constexpr (is_sequence_container_v<T>) {
+				return TypeHash<typename T::value_type, Visited...>(HashSchema(hash, "sequence"));
+			} else if constexpr (is_associative_map_v<T>) {
+				return TypeHash<typename T::mapped_type, Visited...>(TypeHash<typename T::key_type, Visited...>(HashSchema(hash, "map")));
+			} else if constexpr (is_set_v<T>) {
+				return TypeHash<typename T::key_type, Visited...>(HashSchema(hash, "set"));
+			} else if constexpr (is_std_pair_v<T>) {
+				return TypeHash<typename T::second_type, Visited...>(TypeHash<typename T::first_type, Visited...>(HashSchema(hash, "pair")));
+			} else if constexpr (is_std_tuple_v<T>) {
+				return TupleHash<T, Visited...>(HashSchema(hash, "tuple"), std::make_index_sequence<std::tuple_size<T>::value>{});
+			} else if constexpr (is_specialization<T, std::optional>::value) {
+				return TypeHash<typename T::value_type, Visited...>(HashSchema(hash, "optional"));
+			} else if constexpr (is_pointer_like_v<T>) {
+				return TypeHash<typename T::element_type, Visited...>(HashSchema(hash, "pointer"));
+			} else {
+				return HashSchema(hash, "json");
+			}
+		}
+
+		template<typename T, typename First, typename... Rest>
+		static constexpr std::uint64_t RecursionDepth() {
+			if constexpr (std::is_same_v<T, First>) {
+				return 0;
+			} else {
+				return 1 + RecursionDepth<T, Rest...>();
+			}
+		}
+
+		template<typename T, typename... Visited, std::size_t... I>
+		static constexpr std::uint64_t FieldsHash(std::uint64_t hash, std::index_sequence<I...>) {
+			((hash = TypeHash<visit_struct::type_at<I, T>, Visited..., T>(HashSchema(hash, visit_struct::get_name<I, T>()))), ...);
+			return hash;
+		}
+
+		template<typename T, typename... Visited, std::size_t... I>
+		static constexpr std::uint64_t TupleHash(std::uint64_t hash, std::index_sequence<I...>) {
+			((hash = TypeHash<std::tuple_element_t<I, T>, Visited...>(hash)), ...);
+			return hash;
+		}
+
+	private: /* Write */
+
+		template<typename T>
+		static void WriteImpl(Writer& writer, const T& value) {
+			if constexpr (IsBulk<T>()) {
+				writer.Pod(value);
+			} else if constexpr (is_visitable_v<T>) {
+				visit_struct::for_each(value, [&](const char*, const auto& field) {
+					WriteImpl(writer, field);
+				});
+			} else if constexpr (std::is_same_v<T, bool>) {
+				writer.Pod(static_cast<std::uint8_t>(value ? 1 : 0));
+			} else if constexpr (is_string_v<T>) {
+				writer.String(value, false);
+			} else if constexpr (std::is_array_v<T>) {
+				WriteElements(writer, value, std::extent_v<T>, false);
+			} else if constexpr (is_std_array_v<T>) {
+				WriteElements(writer, value.data(), value.size(), false);
+			} else if constexpr (is_std_vector_v<T> && !std::is_same_v<T, std::vector<bool>>) {
+				WriteElements(writer, value.data(), value.size(), true);
+			} else if constexpr (is_sequence_container_v<T> || is_set_v<T>) {
+				writer.Count(value.size());
+				for (const auto& item : value) {
+					WriteImpl(writer, item);
+				}
+			} else if constexpr (is_associative_map_v<T>) {
+				writer.Count(value.size());
+				for (const auto& [key, item] : value) {
+					if constexpr (is_string_v<typename T::key_type>) {
+						writer.String(key, true);
+					} else {
+						WriteImpl(writer, key);
+					}
+					WriteImpl(writer, item);
+				}
+			} else if constexpr (is_std_pair_v<T>) {
+				WriteImpl(writer, value.first);
+				WriteImpl(writer, value.second);
+			} else if constexpr (is_std_tuple_v<T>) {
+				std::apply([&](const auto&... items) { (WriteImpl(writer, items), ...); }, value);
+			} else if constexpr (is_specialization<T, std::optional>::value || is_pointer_like_v<T>) {
+				writer.Pod(static_cast<std::uint8_t>(value ? 1 : 0));
+				if (value) WriteImpl(writer, *value);
+			} else {
+				std::vector<std::uint8_t> packed;
+				json::to_msgpack(Serializer::ToJson(value), packed);
+				writer.Count(packed.size());
+				writer.Raw(packed.data(), packed.size());
+			}
+		}
+
+		template<typename E>
+		static void WriteElements(Writer& writer, const E* items, std::size_t count, bool counted) {
+			if (counted) writer.Count(count);
+			if constexpr (IsBulk<E>()) {
+				writer.Align();
+				writer.Raw(items, count * sizeof(E));
+			} else {
+				for (std::size_t i = 0; i < count; ++i) {
+					WriteImpl(writer, items[i]);
+				}
+			}
+		}
+
+	private: /* Read */
+
+		template<typename T>
+		static void ReadImpl(Reader& reader, T& value) {
+			if constexpr (IsBulk<T>()) {
+				reader.Pod(value);
+			} else if constexpr (is_visitable_v<T>) {
+				visit_struct::for_each(value, [&](const char*, auto& field) {
+					ReadImpl(reader, field);
+				});
+			} else if constexpr (std::is_same_v<T, bool>) {
+				std::uint8_t byte = 0;
+				reader.Pod(byte);
+				value = byte != 0;
+			} else if constexpr (is_string_v<T>) {
+				reader.String(value, false);
+			} else if constexpr (std::is_array_v<T>) {
+				ReadElements(reader, value, std::extent_v<T>);
+			} else if constexpr (is_std_array_v<T>) {
+				ReadElements(reader, value.data(), value.size());
+			} else if constexpr (is_std_vector_v<T>) {
+				using Elem = typename T::value_type;
+				const std::size_t count = reader.Count(IsBulk<Elem>() ? sizeof(Elem) : 1);
+				if constexpr (std::is_same_v<Elem, bool>) {
+					value.assign(count, false);
+					for (std::size_t i = 0; i < count && reader.ok; ++i) {
+						bool item = false;
+						ReadImpl(reader, item);
+						value[i] = item;
+					}
+				} else {
+					value.clear();
+					value.resize(count);
+					ReadElements(reader, value.data(), count);
+				}
+			} else if constexpr (is_sequence_container_v<T>) {
+				const std::size_t count = reader.Count(1);
+				value.clear();
+				for (std::size_t i = 0; i < count && reader.ok; ++i) {
+					typename T::value_type item{};
+					ReadImpl(reader, item);
+					value.push_back(std::move(item));
+				}
+			} else if constexpr (is_set_v<T>) {
+				const std::size_t count = reader.Count(1);
+				value.clear();
+				for (std::size_t i = 0; i < count && reader.ok; ++i) {
+					typename T::key_type key{};
+					ReadImpl(reader, key);
+					value.insert(std::move(key));
+				}
+			} else if constexpr (is_associative_map_v<T>) {
+				const std::size_t count = reader.Count(1);
+				value.clear();
+				for (std::size_t i = 0; i < count && reader.ok; ++i) {
+					typename T::key_type key{};
+					typename T::mapped_type item{};
+					if constexpr (is_string_v<typename T::key_type>) {
+						reader.String(key, true);
+					} else {
+						ReadImpl(reader, key);
+					}
+					ReadImpl(reader, item);
+					value.emplace(std::move(key), std::move(item));
+				}
+			} else if constexpr (is_std_pair_v<T>) {
+				ReadImpl(reader, value.first);
+				ReadImpl(reader, value.second);
+			} else if constexpr (is_std_tuple_v<T>) {
+				std::apply([&](auto&... items) { (ReadImpl(reader, items), ...); }, value);
+			} else if constexpr (is_specialization<T, std::optional>::value || is_pointer_like_v<T>) {
+				std::uint8_t present = 0;
+				reader.Pod(present);
+				if (!present) {
+					value.reset();
+					return;
+				}
+				if constexpr (is_specialization<T, std::optional>::value) {
+					if (!value) value.emplace();
+				} else if constexpr (is_specialization<T, std::shared_ptr>::value) {
+					/* The pointee may be shared with other objects, it is replaced instead of written through */
+					value = std::make_shared<typename T::element_type>();
+				} else {
+					if (!value) value.reset(new typename T::element_type());
+				}
+				ReadImpl(reader, *value);
+			} else {
+				const std::size_t size = reader.Count(1);
+				if (const std::uint8_t* at = reader.Take(size)) {
+					const json j = json::from_msgpack(at, at + size, true, false);
+					if (j.is_discarded()) {
+						reader.ok = false;
+						return;
+					}
+					Deserializer::FromJson(j, value);
+				}
+			}
+		}
+
+		template<typename E>
+		static void ReadElements(Reader& reader, E* items, std::size_t count) {
+			if constexpr (IsBulk<E>()) {
+				reader.Align();
+				reader.Raw(items, count * sizeof(E));
+			} else {
+				for (std::size_t i = 0; i < count && reader.ok; ++i) {
+					ReadImpl(reader, items[i]);
+				}
+			}
+		}
+
+		static bool Fail(const char* message, const Reader& reader) {
+			Deserializer::HandleError(message, json(reader.offset));
+			return false;
+		}
+	};
+
+	/* Writes value as a binary prefab, returns false if the file could not be written */
+	template<typename T>
+	bool WriteBinaryFile(const std::string& path, const T& value, StringTable strings = StringTable::Keys) {
+		const auto bytes = Binary::Write(value, strings);
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+		return static_cast<bool>(file);
+	}
+}
@@ -0,0 +1,413 @@
+#pragma once
+#include "svh/serializer.hpp"
+#include "svh/std_types.hpp"
+#include "svh/cooked.hpp"
+#include "svh/binary.hpp"
+#include "svh/archive.hpp"
+#include "svh/parallel.hpp"
+#include "svh/prefab_library.hpp"
+
+#include <charconv>			// for std::from_chars
+#include <cstdint>			// for std::uint64_t
+#include <filesystem>		// for std::filesystem
+#include <fstream>			// for std::ifstream, std::ofstream
+#include <iostream>			// for std::cout
+#include <mutex>			// for std::mutex
+#include <optional>			// for std::optional
+#include <sstream>			// for std::stringstream
+#include <string>			// for std::string
+#include <string_view>		// for std::string_view
+#include <unordered_map>	// for std::unordered_map
+#include <vector>			// for std::vector
+
+/* Offline conversion of a directory of json prefabs to cooked prefabs, see cook/main.cpp */
+
+namespace svh {
+
+	/* An override prefab file is { "$parent": "<id>", "$patch": <Compare patch> }, any other file is a serialized base object. */
+	/* The id of a prefab is its path relative to the input directory, without extension and with '/' separators */
+	constexpr char PREFAB_PARENT[] = "$parent";
+	constexpr char PREFAB_PATCH[] = "$patch";
+	constexpr char COOK_MANIFEST[] = "cook_manifest.json";
+	constexpr char COOKED_EXTENSION[] = ".prefab";
+
+	/* True if the manifest entry of id stores hash under key */
+	inline bool ManifestHashIs(const json& prefabs, const std::string& id, const char* key, std::uint64_t hash) {
+		auto entry = prefabs.find(id);
+		if (entry == prefabs.end() || !entry->is_object()) {
+			return false;
+		}
+		auto stored = entry->find(key);
+		return stored != entry->end() && stored->is_number_unsigned() && stored->get<std::uint64_t>() == hash;
+	}
+
+	/* MessagePack outputs can be read as json by any tool, binary outputs load much faster but only as T */
+	enum class CookFormat { MessagePack, Binary };
+
+	struct CookReport {
+		std::size_t cooked = 0;
+		std::size_t skipped = 0;
+		std::size_t removed = 0;
+		std::vector<std::string> errors;
+	};
+
+	/* Resolves the inheritance of every prefab in a directory and writes one cooked, flattened prefab per file. */
+	/* The manifest in the output directory stores a hash of every input and of the inputs it derives from, */
+	/* prefabs whose own content and parents did not change are skipped */
+	template<typename T>
+	class PrefabCooker {
+	public:
+		/* 0 threads = hardware concurrency */
+		PrefabCooker(std::filesystem::path input_directory, std::filesystem::path output_directory, unsigned thread_count = 0, CookFormat cook_format = CookFormat::MessagePack)
+			: input(std::move(input_directory)), output(std::move(output_directory)), threads(thread_count), format(cook_format) {
+		}
+
+		/* force cooks every prefab, even if it did not change */
+		CookReport Cook(bool force = false) {
+			CookReport report;
+			std::vector<Source> sources = FindSources(report);
+			const json manifest = ReadManifest();
+			const json& previous = manifest.contains("prefabs") ? manifest["prefabs"] : json();
+
+			/* Read and hash every input, files that changed are parsed to find their parent */
+			std::mutex error_mutex;
+			ParallelFor(sources.size(), threads, [&](std::size_t i) {
+				Source& source = sources[i];
+				std::string error;
+				if (!ReadSource(source, previous, error)) {
+					std::lock_guard<std::mutex> lock(error_mutex);
+					report.errors.push_back(std::move(error));
+				}
+			});
+
+			std::unordered_map<std::string, std::size_t> by_id;
+			for (std::size_t i = 0; i < sources.size(); ++i) {
+				by_id.emplace(sources[i].id, i);
+			}
+			for (auto& source : sources) {
+				Hash(source, sources, by_id, report);
+				/* Binary outputs are cooked again when the format or the layout of T changes */
+				if (source.state == State::Hashed && format == CookFormat::Binary) {
+					source.output_hash = HashSchema(source.hash, Binary::SchemaHash<T>());
+				} else {
+					source.output_hash = source.hash;
+				}
+			}
+
+			/* Dirty prefabs and the parents they need to be resolved */
+			for (auto& source : sources) {
+				if (source.state != State::Hashed) {
+					continue;
+				}
+				const bool unchanged = !force && ManifestHashIs(previous, source.id, "hash", source.output_hash);
+				source.dirty = !unchanged || !std::filesystem::exists(OutputPath(source.id));
+				if (source.dirty) {
+					for (Source* needed = &source; needed != nullptr && !needed->needed; needed = Parent(*needed, sources, by_id)) {
+						needed->needed = true;
+					}
+				}
+			}
+
+			/* Parse and deserialize what is needed, then resolve them parents first */
+			ParallelFor(sources.size(), threads, [&](std::size_t i) {
+				Source& source = sources[i];
+				if (!source.needed) {
+					return;
+				}
+				try {
+					if (source.j.is_null() && !ParsePrefabContent(source.content, source.j)) {
+						throw std::runtime_error("invalid json");
+					}
+					if (!source.parent) {
+						Deserializer::FromJson(source.j, source.base);
+					}
+				} catch (const std::exception& e) {
+					std::lock_guard<std::mutex> lock(error_mutex);
+					report.errors.push_back(source.id + ": " + e.what());
+					source.state = State::Failed;
+				}
+			});
+
+			PrefabLibrary<T> library;
+			for (auto& source : sources) {
+				if (!source.needed || source.state == State::Failed) {
+					continue;
+				}
+				if (source.parent) {
+					/* A parent that derives from this prefab is rejected */
+					try {
+						library.SetOverride(source.id, *source.parent, source.j.contains(PREFAB_PATCH) ? source.j[PREFAB_PATCH] : json());
+					} catch (const std::exception& e) {
+						report.errors.push_back(source.id + ": " + e.what());
+						source.state = State::Failed;
+					}
+				} else {
+					library.SetBase(source.id, std::move(source.base));
+				}
+			}
+			/* A patch that does not fit T fails its prefab and the ones derived from it, not the whole cook */
+			try {
+				library.ResolveAll(threads);
+			} catch (const std::exception&) {
+				for (auto& source : sources) {
+					if (!source.needed || source.state == State::Failed || library.IsCached(source.id)) {
+						continue;
+					}
+					try {
+						library.Resolve(source.id);
+					} catch (const std::exception& e) {
+						report.errors.push_back(source.id + ": " + e.what());
+						source.state = State::Failed;
+					}
+				}
+			}
+
+			std::vector<std::pair<Source*, const T*>> work;
+			for (auto& source : sources) {
+				if (!source.dirty) {
+					if (source.state == State::Hashed) ++report.skipped;
+					continue;
+				}
+				/* Already reported */
+				if (source.state == State::Failed) {
+					continue;
+				}
+				if (!library.IsCached(source.id)) {
+					report.errors.push_back(source.id + ": could not be resolved");
+					source.state = State::Failed;
+					continue;
+				}
+				work.push_back({ &source, &library.Resolve(source.id) });
+				std::error_code error;
+				std::filesystem::create_directories(OutputPath(source.id).parent_path(), error);
+			}
+
+			/* Writing only reads the resolved prefabs */
+			ParallelFor(work.size(), threads, [&](std::size_t i) {
+				Source& source = *work[i].first;
+				const std::string path = OutputPath(source.id).string();
+				const bool written = format == CookFormat::Binary ? WriteBinaryFile(path, *work[i].second, StringTable::KeysAndValues) : WriteCooked(path, Serializer::ToJson(*work[i].second));
+				if (!written) {
+					std::lock_guard<std::mutex> lock(error_mutex);
+					report.errors.push_back(source.id + ": could not write " + OutputPath(source.id).string());
+					source.state = State::Failed;
+				}
+			});
+			for (const auto& item : work) {
+				if (item.first->state != State::Failed) ++report.cooked;
+			}
+
+			/* Outputs of inputs that no longer exist */
+			for (auto it = previous.begin(); it != previous.end(); ++it) {
+				if (by_id.find(it.key()) == by_id.end()) {
+					std::error_code error;
+					if (std::filesystem::remove(OutputPath(it.key()), error)) ++report.removed;
+				}
+			}
+
+			WriteManifest(sources);
+			return report;
+		}
+
+		std::filesystem::path OutputPath(const std::string& id) const {
+			return output / std::filesystem::path(id + COOKED_EXTENSION);
+		}
+
+	private:
+		enum class State { Unread, Read, Hashing, Hashed, Failed };
+
+		struct Source {
+			std::string id;
+			std::filesystem::path path;
+			std::string content;
+			std::uint64_t content_hash = 0;
+			/* Content hash combined with the hashes of all parents */
+			std::uint64_t hash = 0;
+			/* Hash combined with the output format, stored in the manifest */
+			std::uint64_t output_hash = 0;
+			std::optional<std::string> parent;
+			json j;
+			T base{};
+			State state = State::Unread;
+			bool dirty = false;
+			bool needed = false;
+		};
+
+		std::filesystem::path input;
+		std::filesystem::path output;
+		unsigned threads;
+		CookFormat format;
+
+		std::vector<Source> FindSources(CookReport& report) const {
+			std::vector<Source> sources;
+			std::error_code error;
+			for (std::filesystem::recursive_directory_iterator it(input, error), end; !error && it != end; it.increment(error)) {
+				if (!it->is_regular_file() || it->path().extension() != ".json") {
+					continue;
+				}
+				Source source;
+				source.path = it->path();
+				auto relative = std::filesystem::relative(it->path(), input);
+				source.id = relative.replace_extension().generic_string();
+				sources.push_back(std::move(source));
+			}
+			if (error) {
+				report.errors.push_back(input.string() + ": " + error.message());
+			}
+			return sources;
+		}
+
+		/* Reads and hashes source, the parent comes from the manifest if the content is the same */
+		static bool ReadSource(Source& source, const json& previous, std::string& error) {
+			std::ifstream file(source.path, std::ios::binary);
+			if (!file) {
+				error = source.id + ": could not read " + source.path.string();
+				source.state = State::Failed;
+				return false;
+			}
+			std::stringstream buffer;
+			buffer << file.rdbuf();
+			source.content = buffer.str();
+			source.content_hash = HashContent(source.content);
+			source.state = State::Read;
+
+			if (ManifestHashIs(previous, source.id, "content", source.content_hash)) {
+				const json& parent = previous[source.id]["parent"];
+				if (parent.is_string()) {
+					source.parent = parent.template get<std::string>();
+				}
+				return true;
+			}
+			if (!ParsePrefabContent(source.content, source.j) || !source.j.is_object()) {
+				error = source.id + ": invalid json";
+				source.state = State::Failed;
+				return false;
+			}
+			if (source.j.contains(PREFAB_PARENT)) {
+				if (!source.j[PREFAB_PARENT].is_string()) {
+					error = source.id + ": " + PREFAB_PARENT + " must be a string";
+					source.state = State::Failed;
+					return false;
+				}
+				source.parent = source.j[PREFAB_PARENT].template get<std::string>();
+			}
+			return true;
+		}
+
+		static Source* Parent(const Source& source, std::vector<Source>& sources, const std::unordered_map<std::string, std::size_t>& by_id) {
+			if (!source.parent) {
+				return nullptr;
+			}
+			auto it = by_id.find(*source.parent);
+			return it == by_id.end() ? nullptr : &sources[it->second];
+		}
+
+		/* Combines the content hash with the hashes of the parents, fails on missing parents and cycles */
+		static bool Hash(Source& source, std::vector<Source>& sources, const std::unordered_map<std::string, std::size_t>& by_id, CookReport& report) {
+			if (source.state == State::Hashed) {
+				return true;
+			}
+			if (source.state != State::Read) {
+				if (source.state == State::Hashing) {
+					report.errors.push_back(source.id + ": parent cycle");
+					source.state = State::Failed;
+				}
+				return false;
+			}
+			source.hash = source.content_hash;
+			if (source.parent) {
+				Source* parent = Parent(source, sources, by_id);
+				if (parent == nullptr) {
+					report.errors.push_back(source.id + ": missing parent " + *source.parent);
+					source.state = State::Failed;
+					return false;
+				}
+				source.state = State::Hashing;
+				if (!Hash(*parent, sources, by_id, report)) {
+					if (source.state == State::Hashing) source.state = State::Failed;
+					return false;
+				}
+				source.hash ^= parent->hash + 0x9e3779b97f4a7c15ull + (source.hash << 6) + (source.hash >> 2);
+			}
+			source.state = State::Hashed;
+			return true;
+		}
+
+		json ReadManifest() const {
+			std::ifstream file(output / COOK_MANIFEST);
+			if (!file) {
+				return json();
+			}
+			json manifest = json::parse(file, nullptr, false);
+			return manifest.is_discarded() ? json() : manifest;
+		}
+
+		/* Failed prefabs are left out, so they are cooked again next time */
+		void WriteManifest(const std::vector<Source>& sources) const {
+			json prefabs = json::object();
+			for (const auto& source : sources) {
+				if (source.state != State::Hashed) {
+					continue;
+				}
+				json entry;
+				entry["content"] = source.content_hash;
+				entry["hash"] = source.output_hash;
+				entry["parent"] = source.parent ? json(*source.parent) : json();
+				prefabs[source.id] = std::move(entry);
+			}
+			json manifest;
+			manifest["version"] = COOKED_VERSION;
+			manifest["prefabs"] = std::move(prefabs);
+			std::error_code error;
+			std::filesystem::create_directories(output, error);
+			std::ofstream file(output / COOK_MANIFEST, std::ios::trunc);
+			file << manifest.dump(1, '\t');
+		}
+	};
+
+	/* Command line entry point: cook <input directory> <output directory> [--threads N] [--force] [--binary] [--archive <file>] */
+	/* --archive cooks binary prefabs and packs them into one archive for PrefabArchive */
+	template<typename T>
+	int CookMain(int argc, char** argv) {
+		const auto usage = [&]() {
+			std::cout << "usage: " << argv[0] << " <input directory> <output directory> [--threads N] [--force] [--binary] [--archive <file>]" << std::endl;
+			return 2;
+		};
+		if (argc < 3) {
+			return usage();
+		}
+		unsigned thread_count = 0;
+		bool force = false;
+		CookFormat format = CookFormat::MessagePack;
+		std::string archive;
+		for (int i = 3; i < argc; ++i) {
+			const std::string argument = argv[i];
+			if (argument == "--force") {
+				force = true;
+			} else if (argument == "--binary") {
+				format = CookFormat::Binary;
+			} else if (argument == "--archive" && i + 1 < argc) {
+				format = CookFormat::Binary;
+				archive = argv[++i];
+			} else if (argument == "--threads" && i + 1 < argc) {
+				const std::string_view value = argv[++i];
+				auto result = std::from_chars(value.data(), value.data() + value.size(), thread_count);
+				if (result.ec != std::errc() || result.ptr != value.data() + value.size()) {
+					std::cout << "error: invalid thread count '" << value << "'" << std::endl;
+					return usage();
+				}
+			}
+		}
+
+		PrefabCooker<T> cooker(argv[1], argv[2], thread_count, format);
+		CookReport report = cooker.Cook(force);
+		for (const auto& error : report.errors) {
+			std::cout << "error: " << error << std::endl;
+		}
+		std::cout << report.cooked << " cooked, " << report.skipped << " up to date, " << report.removed << " removed" << std::endl;
+		if (!archive.empty()) {
+			std::cout << PackArchive(argv[2], archive, COOKED_EXTENSION) << " prefabs packed into " << archive << std::endl;
+		}
+		return report.errors.empty() ? 0 : 1;
+	}
+}
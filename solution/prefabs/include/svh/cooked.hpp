@@ -0,0 +1,65 @@
+#pragma once
+#include "svh/serializer.hpp"
+
+#include <cstdint>			// for std::uint8_t, std::uint64_t
+#include <fstream>			// for std::ofstream
+#include <string>			// for std::string
+#include <vector>			// for std::vector
+
+/* Define SVH_COOKED_ONLY to reject json text when loading prefab files, for shipping builds */
+
+//#define SVH_COOKED_ONLY
+
+namespace svh {
+
+	/* A cooked prefab starts with this magic and a format version, followed by the MessagePack encoded prefab */
+	constexpr char COOKED_MAGIC[] = { 'S', 'V', 'H', 'P' };
+	constexpr std::uint8_t COOKED_VERSION = 1;
+	constexpr std::size_t COOKED_HEADER_SIZE = sizeof(COOKED_MAGIC) + 1;
+
+	/* 64 bit FNV-1a, identifies the content of a prefab file */
+	inline std::uint64_t HashContent(const std::string& content) {
+		std::uint64_t hash = 14695981039346656037ull;
+		for (unsigned char c : content) {
+			hash ^= c;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	inline bool IsCooked(const std::string& content) {
+		return content.size() >= COOKED_HEADER_SIZE && content.compare(0, sizeof(COOKED_MAGIC), COOKED_MAGIC, sizeof(COOKED_MAGIC)) == 0;
+	}
+
+	inline std::vector<std::uint8_t> EncodeCooked(const json& j) {
+		std::vector<std::uint8_t> bytes(COOKED_MAGIC, COOKED_MAGIC + sizeof(COOKED_MAGIC));
+		bytes.push_back(COOKED_VERSION);
+		json::to_msgpack(j, bytes);
+		return bytes;
+	}
+
+	/* Writes j as a cooked prefab, returns false if the file could not be written */
+	inline bool WriteCooked(const std::string& path, const json& j) {
+		const auto bytes = EncodeCooked(j);
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+		return static_cast<bool>(file);
+	}
+
+	/* Decodes the content of a prefab file, cooked or json text. Returns false if it is invalid */
+	inline bool ParsePrefabContent(const std::string& content, json& j) {
+		if (IsCooked(content)) {
+			if (static_cast<std::uint8_t>(content[sizeof(COOKED_MAGIC)]) != COOKED_VERSION) {
+				return false;
+			}
+			j = json::from_msgpack(content.begin() + COOKED_HEADER_SIZE, content.end(), true, false);
+			return !j.is_discarded();
+		}
+#ifdef SVH_COOKED_ONLY
+		return false;
+#else
+		j = json::parse(content, nullptr, false);
+		return !j.is_discarded();
+#endif
+	}
+}
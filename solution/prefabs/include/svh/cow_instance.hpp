@@ -0,0 +1,258 @@
+#pragma once
+#include "svh/serializer.hpp"
+#include "svh/std_types.hpp"
+
+#include <memory>			// for std::shared_ptr
+#include <string>			// for std::string
+#include <tuple>			// for std::tuple
+#include <type_traits>		// for std::is_trivially_copyable
+#include <utility>			// for std::integer_sequence
+
+namespace svh {
+
+	/* An instance of a visitable struct that shares its fields with an immutable base. */
+	/* Every field points into the base until it is written, the first write copies only that field. */
+	/* Copying an instance shares the fields it already owns, they are copied again on the next write */
+	template<typename T>
+	class CowInstance {
+		static_assert(is_visitable_v<T>, "CowInstance needs a visitable struct");
+
+		static constexpr int field_count = static_cast<int>(visit_struct::field_count<T>());
+
+		template<int I>
+		using Field = visit_struct::type_at<I, T>;
+
+		template<int... I>
+		static auto FieldsType(std::integer_sequence<int, I...>) -> std::tuple<std::shared_ptr<const Field<I>>...>;
+
+		template<int... I>
+		static auto OwnedFieldsType(std::integer_sequence<int, I...>) -> std::tuple<std::shared_ptr<Field<I>>...>;
+
+		using Fields = decltype(FieldsType(std::make_integer_sequence<int, field_count>{}));
+		using OwnedFields = decltype(OwnedFieldsType(std::make_integer_sequence<int, field_count>{}));
+
+	public:
+		CowInstance() : CowInstance(std::make_shared<const T>()) {}
+
+		explicit CowInstance(std::shared_ptr<const T> base) {
+			Reset(std::move(base));
+		}
+
+		/* Drops every written field and points all of them into base */
+		void Reset(std::shared_ptr<const T> new_base) {
+			base = std::move(new_base);
+			ForEachIndex([&](auto index) {
+				constexpr int I = decltype(index)::value;
+				/* Aliasing constructor, the field keeps the whole base alive */
+				std::get<I>(fields) = std::shared_ptr<const Field<I>>(base, &visit_struct::get<I>(*base));
+				std::get<I>(owned).reset();
+			});
+		}
+
+		const std::shared_ptr<const T>& Base() const {
+			return base;
+		}
+
+		template<int I>
+		const Field<I>& Get() const {
+			return *std::get<I>(fields);
+		}
+
+		/* Same as above, by member pointer: instance.Get(&Entity::name) */
+		template<typename M>
+		const M& Get(M T::* member) const {
+			const M* result = nullptr;
+			ForEachIndex([&](auto index) {
+				constexpr int I = decltype(index)::value;
+				if constexpr (std::is_same_v<Field<I>, M>) {
+					if (visit_struct::get_pointer<I, T>() == member) result = &Get<I>();
+				}
+			});
+			if (result == nullptr) {
+				Deserializer::HandleError("Member is not a field of the visitable struct", json());
+				/* Only reached when exceptions are disabled */
+				static const M missing{};
+				return missing;
+			}
+			return *result;
+		}
+
+		/* Copies the field if it is still shared, the reference is valid until the instance is copied or reset */
+		template<int I>
+		Field<I>& Mutable() {
+			auto& field = std::get<I>(fields);
+			auto& own = std::get<I>(owned);
+			if (IsShared<I>()) {
+				own = std::make_shared<Field<I>>(Copy(*field));
+				field = own;
+			}
+			return *own;
+		}
+
+		template<typename M>
+		M& Mutable(M T::* member) {
+			M* result = nullptr;
+			ForEachIndex([&](auto index) {
+				constexpr int I = decltype(index)::value;
+				if constexpr (std::is_same_v<Field<I>, M>) {
+					if (visit_struct::get_pointer<I, T>() == member) result = &Mutable<I>();
+				}
+			});
+			if (result == nullptr) {
+				Deserializer::HandleError("Member is not a field of the visitable struct", json());
+				/* Only reached when exceptions are disabled, the write is dropped */
+				thread_local M missing{};
+				missing = M{};
+				return missing;
+			}
+			return *result;
+		}
+
+		/* True if a write to the field would copy it first. A field the instance owns is held by */
+		/* both fields and owned, so another instance shares it once the count is above 2 */
+		template<int I>
+		bool IsShared() const {
+			const auto& field = std::get<I>(fields);
+			const auto& own = std::get<I>(owned);
+			return own == nullptr || own.get() != field.get() || own.use_count() > 2;
+		}
+
+		/* Number of fields that point into the base */
+		int SharedFieldCount() const {
+			int count = 0;
+			ForEachIndex([&](auto index) {
+				constexpr int I = decltype(index)::value;
+				if (std::get<I>(fields).get() == &visit_struct::get<I>(*base)) ++count;
+			});
+			return count;
+		}
+
+		/* A full copy as a plain object */
+		T Materialize() const {
+			T value{};
+			ForEachIndex([&](auto index) {
+				constexpr int I = decltype(index)::value;
+				visit_struct::get<I>(value) = Copy(Get<I>());
+			});
+			return value;
+		}
+
+		/* Calls function(name, value) for every field, in VISITABLE_STRUCT order */
+		template<typename Function>
+		void ForEachField(Function&& function) const {
+			ForEachIndex([&](auto index) {
+				constexpr int I = decltype(index)::value;
+				function(visit_struct::get_name<I, T>(), Get<I>());
+			});
+		}
+
+		/* Writes only the fields in the patch, the others stay shared */
+		void ApplyPatch(const json& j) {
+			ForEachIndex([&](auto index) {
+				constexpr int I = decltype(index)::value;
+				auto it = j.find(visit_struct::get_name<I, T>());
+				if (it != j.end()) {
+					Overwrite::PathScope scope(PathElement::Kind::Field, I);
+					Overwrite::FromJson(it.value(), Mutable<I>());
+				}
+			});
+		}
+
+		void LoadJson(const json& j) {
+			ForEachIndex([&](auto index) {
+				constexpr int I = decltype(index)::value;
+				auto it = j.find(visit_struct::get_name<I, T>());
+				if (it != j.end()) {
+					Field<I> value{};
+					Deserializer::FromJson(it.value(), value);
+					std::get<I>(owned) = std::make_shared<Field<I>>(std::move(value));
+					std::get<I>(fields) = std::get<I>(owned);
+				}
+			});
+		}
+
+		/* Same format as Compare on T, fields that point to the same object are skipped */
+		static json GetChanges(const CowInstance& left, const CowInstance& right) {
+			json result;
+			ForEachIndex([&](auto index) {
+				constexpr int I = decltype(index)::value;
+				if (std::get<I>(left.fields) == std::get<I>(right.fields)) {
+					return;
+				}
+				auto changes = Compare::GetChanges(left.Get<I>(), right.Get<I>());
+				if (!changes.empty()) {
+					result[visit_struct::get_name<I, T>()] = changes;
+				}
+			});
+			return result;
+		}
+
+	private:
+		std::shared_ptr<const T> base;
+		/* What Get reads, either an alias into base or the same object as owned */
+		Fields fields;
+		/* Fields allocated by this instance or a copy of it, the only ones written through */
+		OwnedFields owned;
+
+		template<typename Function>
+		static void ForEachIndex(Function&& function) {
+			ForEachIndexImpl(function, std::make_integer_sequence<int, field_count>{});
+		}
+
+		template<typename Function, int... I>
+		static void ForEachIndexImpl(Function& function, std::integer_sequence<int, I...>) {
+			(function(std::integral_constant<int, I>{}), ...);
+		}
+
+		template<typename F>
+		static constexpr bool is_plain_copy_v = std::is_trivially_copyable_v<F> || is_string_v<F>;
+
+		/* Fields that can hold pointers are copied through json, so a write never reaches an object the base points to */
+		template<typename F>
+		static F Copy(const F& value) {
+			if constexpr (is_plain_copy_v<F>) {
+				return value;
+			} else if constexpr (is_std_vector_v<F>) {
+				if constexpr (is_plain_copy_v<typename F::value_type>) {
+					return value;
+				} else {
+					return CopyThroughJson(value);
+				}
+			} else {
+				return CopyThroughJson(value);
+			}
+		}
+
+		template<typename F>
+		static F CopyThroughJson(const F& value) {
+			F copy{};
+			Deserializer::FromJson(Serializer::ToJson(value), copy);
+			return copy;
+		}
+	};
+
+	/* Serialized like T */
+	template<typename T>
+	static inline json SerializeImpl(const CowInstance<T>& value) {
+		json result;
+		value.ForEachField([&](const char* name, const auto& field) {
+			result[name] = Serializer::ToJson(field);
+		});
+		return result;
+	}
+
+	template<typename T>
+	static inline void DeserializeImpl(const json& j, CowInstance<T>& value) {
+		value.LoadJson(j);
+	}
+
+	template<typename T>
+	static inline json CompareImpl(const CowInstance<T>& left, const CowInstance<T>& right) {
+		return CowInstance<T>::GetChanges(left, right);
+	}
+
+	template<typename T>
+	static inline void OverwriteImpl(const json& j, CowInstance<T>& value) {
+		value.ApplyPatch(j);
+	}
+}
@@ -118,8 +118,8 @@ namespace dtl {
             elemVec         seq;
             Ses< elem >     ses_ba   = diff_ba.getSes();
             Ses< elem >     ses_bc   = diff_bc.getSes();
-            sesElemVec      ses_ba_v = ses_ba.getSequence();
-            sesElemVec      ses_bc_v = ses_bc.getSequence();
+            sesElemVec      ses_ba_v(ses_ba.getSequence().begin(), ses_ba.getSequence().end());
+            sesElemVec      ses_bc_v(ses_bc.getSequence().begin(), ses_bc.getSequence().end());
             sesElemVec_iter ba_it    = ses_ba_v.begin();
             sesElemVec_iter bc_it    = ses_bc_v.begin();
             sesElemVec_iter ba_end   = ses_ba_v.end();
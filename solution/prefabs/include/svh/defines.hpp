@@ -1,6 +1,7 @@
 ﻿#pragma once
 #include <svh/visit_struct/visit_struct.hpp>
 #include <type_traits>
+#include <array>
 #include <set>
 #include <unordered_set>
 
@@ -297,6 +298,8 @@ namespace svh {
 	constexpr char VALUE[] = "value";
 	constexpr char FIRST[] = "first";
 	constexpr char SECOND[] = "second";
+	constexpr char REDO[] = "redo";
+	constexpr char UNDO[] = "undo";
 
 	/* Is sequence type*/
 	template<typename T>
@@ -309,6 +312,13 @@ namespace svh {
 	template<typename T>
 	inline constexpr bool is_std_vector_v = is_std_vector<std::remove_cv_t<std::remove_reference_t<T>>>::value;
 
+	/* Is std::array */
+	template<typename T> struct is_std_array : std::false_type {};
+	template<typename E, std::size_t N>
+	struct is_std_array<std::array<E, N>> : std::true_type {};
+	template<typename T>
+	inline constexpr bool is_std_array_v = is_std_array<std::remove_cv_t<std::remove_reference_t<T>>>::value;
+
 	/* convert to vector */
 	template<typename T>
 	auto to_std_vector(const T& x)
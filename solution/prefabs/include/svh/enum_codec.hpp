@@ -0,0 +1,124 @@
+#pragma once
+#include <svh/magic_enum/magic_enum.hpp>
+
+#include <array>			// for std::array
+#include <cstddef>			// for std::size_t
+#include <string_view>		// for std::string_view
+#include <type_traits>		// for std::underlying_type_t
+#include <utility>			// for std::declval
+
+namespace svh {
+
+	/* Specialize to write an enum as its underlying integer instead of its name: template<> struct svh::enum_as_integer<Layer> : std::true_type {}; */
+	/* Binary, views and replication always store the integer, this is for json and the MessagePack made from it */
+	template<typename E>
+	struct enum_as_integer : std::false_type {};
+
+	/* Converts enums without user-defined SerializeImpl/DeserializeImpl functions to their names and back. */
+	/* The tables are built at compile time from magic_enum, which only finds values between MAGIC_ENUM_RANGE_MIN and */
+	/* MAGIC_ENUM_RANGE_MAX (or the range from magic_enum::customize::enum_range<E>). Values without a name are written as integers */
+	template<typename E>
+	struct EnumCodec {
+		using Underlying = std::underlying_type_t<E>;
+		/* char sized enums are promoted so json stores a number */
+		using Integer = decltype(+std::declval<Underlying>());
+
+		static constexpr std::size_t Count() {
+			return magic_enum::enum_count<E>();
+		}
+
+		/* Name of value, empty if it has none */
+		static constexpr std::string_view Name(E value) {
+			if constexpr (Count() == 0) {
+				return {};
+			} else if constexpr (Contiguous()) {
+				const Integer index = ToInteger(value) - ToInteger(values[0]);
+				return index >= 0 && static_cast<std::size_t>(index) < Count() ? names[static_cast<std::size_t>(index)] : std::string_view();
+			} else {
+				/* enum_values is in ascending order */
+				std::size_t low = 0, high = Count();
+				while (low < high) {
+					const std::size_t middle = (low + high) / 2;
+					if (ToInteger(values[middle]) < ToInteger(value)) {
+						low = middle + 1;
+					} else {
+						high = middle;
+					}
+				}
+				return low < Count() && values[low] == value ? names[low] : std::string_view();
+			}
+		}
+
+		/* Binary search of the table sorted by name, returns false if name is not an enumerator of E */
+		static constexpr bool Decode(std::string_view name, E& value) {
+			std::size_t low = 0, high = Count();
+			while (low < high) {
+				const std::size_t middle = (low + high) / 2;
+				if (by_name[middle].name < name) {
+					low = middle + 1;
+				} else {
+					high = middle;
+				}
+			}
+			if (low < Count() && by_name[low].name == name) {
+				value = by_name[low].value;
+				return true;
+			}
+			return false;
+		}
+
+		static constexpr Integer ToInteger(E value) {
+			return static_cast<Integer>(static_cast<Underlying>(value));
+		}
+
+	private:
+		struct Entry {
+			std::string_view name;
+			E value;
+		};
+
+		/* magic_enum rejects enums it finds no values for, those are always written as integers */
+		static constexpr auto Names() {
+			if constexpr (Count() == 0) {
+				return std::array<std::string_view, 0>{};
+			} else {
+				return magic_enum::enum_names<E>();
+			}
+		}
+
+		static constexpr auto Values() {
+			if constexpr (Count() == 0) {
+				return std::array<E, 0>{};
+			} else {
+				return magic_enum::enum_values<E>();
+			}
+		}
+
+		static constexpr auto names = Names();
+		static constexpr auto values = Values();
+
+		static constexpr bool Contiguous() {
+			if constexpr (Count() == 0) {
+				return false;
+			} else {
+				return static_cast<std::size_t>(ToInteger(values[Count() - 1]) - ToInteger(values[0])) == Count() - 1;
+			}
+		}
+
+		/* Insertion sort, the tables are small and std::sort is not constexpr before C++20 */
+		static constexpr std::array<Entry, Count()> SortByName() {
+			std::array<Entry, Count()> table{};
+			for (std::size_t i = 0; i < Count(); ++i) {
+				Entry entry{ names[i], values[i] };
+				std::size_t j = i;
+				for (; j > 0 && entry.name < table[j - 1].name; --j) {
+					table[j] = table[j - 1];
+				}
+				table[j] = entry;
+			}
+			return table;
+		}
+
+		static constexpr std::array<Entry, Count()> by_name = SortByName();
+	};
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <filesystem>		// for std::filesystem
+#include <string>			// for std::string
+#include <unordered_map>	// for std::unordered_map
+#include <vector>			// for std::vector
+
+#if defined(__linux__)
+#include <sys/inotify.h>	// for inotify_init1, inotify_add_watch
+#include <unistd.h>			// for read, close
+#include <climits>			// for NAME_MAX
+#endif
+
+namespace svh {
+
+	/* Reports files that were written since the last Poll. */
+	/* Uses inotify on Linux, elsewhere the modification time and size are compared on every Poll */
+	class FileWatcher {
+	public:
+		FileWatcher() {
+#if defined(__linux__)
+			fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+		}
+
+		~FileWatcher() {
+#if defined(__linux__)
+			if (fd >= 0) {
+				close(fd);
+			}
+#endif
+		}
+
+		FileWatcher(const FileWatcher&) = delete;
+		FileWatcher& operator=(const FileWatcher&) = delete;
+
+		/* Returns false if the file can not be watched */
+		bool Watch(const std::string& path) {
+			std::error_code error;
+			auto absolute = std::filesystem::absolute(path, error);
+			if (error) {
+				return false;
+			}
+			const std::string key = absolute.lexically_normal().string();
+#if defined(__linux__)
+			if (fd >= 0) {
+				/* The directory is watched, editors often save by replacing the file */
+				const std::string directory = absolute.parent_path().string();
+				int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+				if (wd < 0) {
+					return false;
+				}
+				directories[wd] = directory;
+				files[key] = path;
+				return true;
+			}
+#endif
+			files[key] = path;
+			stamps[key] = Stamp(key);
+			return true;
+		}
+
+		void Unwatch(const std::string& path) {
+			std::error_code error;
+			auto absolute = std::filesystem::absolute(path, error);
+			const std::string key = absolute.lexically_normal().string();
+			files.erase(key);
+			stamps.erase(key);
+		}
+
+		/* Paths (as passed to Watch) written since the last call, never blocks */
+		std::vector<std::string> Poll() {
+			std::vector<std::string> changed;
+#if defined(__linux__)
+			if (fd >= 0) {
+				alignas(inotify_event) char buffer[16 * (sizeof(inotify_event) + NAME_MAX + 1)];
+				for (;;) {
+					ssize_t length = read(fd, buffer, sizeof(buffer));
+					if (length <= 0) {
+						break;
+					}
+					for (char* ptr = buffer; ptr < buffer + length;) {
+						auto* event = reinterpret_cast<inotify_event*>(ptr);
+						ptr += sizeof(inotify_event) + event->len;
+						auto directory = directories.find(event->wd);
+						if (directory == directories.end() || event->len == 0) {
+							continue;
+						}
+						auto key = (std::filesystem::path(directory->second) / event->name).lexically_normal().string();
+						auto file = files.find(key);
+						if (file != files.end() && !Contains(changed, file->second)) {
+							changed.push_back(file->second);
+						}
+					}
+				}
+				return changed;
+			}
+#endif
+			for (auto& [key, stamp] : stamps) {
+				auto current = Stamp(key);
+				if (current != stamp) {
+					stamp = current;
+					changed.push_back(files[key]);
+				}
+			}
+			return changed;
+		}
+
+	private:
+		/* Normalized absolute path to the path given by the user */
+		std::unordered_map<std::string, std::string> files;
+		/* Used without inotify */
+		std::unordered_map<std::string, std::string> stamps;
+#if defined(__linux__)
+		int fd = -1;
+		std::unordered_map<int, std::string> directories;
+#endif
+
+		static std::string Stamp(const std::string& path) {
+			std::error_code error;
+			auto time = std::filesystem::last_write_time(path, error);
+			if (error) {
+				return std::string();
+			}
+			auto size = std::filesystem::file_size(path, error);
+			return std::to_string(time.time_since_epoch().count()) + ":" + std::to_string(error ? 0 : size);
+		}
+
+		static bool Contains(const std::vector<std::string>& list, const std::string& value) {
+			for (const auto& item : list) {
+				if (item == value) return true;
+			}
+			return false;
+		}
+	};
+}
@@ -0,0 +1,154 @@
+#pragma once
+#include "svh/serializer.hpp"
+#include "svh/std_types.hpp"
+#include "svh/patch.hpp"
+#include "svh/file_watcher.hpp"
+#include "svh/published.hpp"
+
+#include <algorithm>		// for std::remove_if
+#include <fstream>			// for std::ifstream
+#include <memory>			// for std::shared_ptr
+#include <mutex>			// for std::unique_lock
+#include <shared_mutex>		// for std::shared_mutex, std::shared_lock
+#include <string>			// for std::string
+#include <unordered_map>	// for std::unordered_map
+#include <vector>			// for std::vector
+
+namespace svh {
+
+	/* Keeps live instances in sync with their prefab files. */
+	/* On a change only the file is parsed again, the difference with the previous version is applied to the instances */
+	/* without touching the values they override locally. */
+	/* Load, Track, Update and Reload belong to one thread, other threads read the prefabs through Snapshot. */
+	/* Load takes a lock to add to the map of prefabs, Snapshot a shared one to find in it */
+	template<typename T>
+	class HotReloader {
+	public:
+		/* Loads and watches a prefab file, returns false if it could not be read */
+		bool Load(const std::string& path) {
+			json j;
+			if (!ReadFile(path, j)) {
+				return false;
+			}
+			T value{};
+			Deserializer::FromJson(j, value);
+			Prefab* added;
+			{
+				std::unique_lock<std::shared_mutex> lock(prefabs_mutex);
+				added = &prefabs[path];
+			}
+			/* Elements of an unordered_map do not move when it grows */
+			Prefab& prefab = *added;
+			prefab.value = std::make_shared<const T>(std::move(value));
+			prefab.published.Publish(prefab.value);
+			watcher.Watch(path);
+			return true;
+		}
+
+		/* Valid until the next reload of path, for the thread that reloads */
+		const T& Get(const std::string& path) const {
+			return *prefabs.at(path).value;
+		}
+
+		/* The prefab at path as of the last reload, safe to call from any thread while loading and reloading */
+		std::shared_ptr<const T> Snapshot(const std::string& path) const {
+			const Published<T>* published;
+			{
+				std::shared_lock<std::shared_mutex> lock(prefabs_mutex);
+				published = &prefabs.at(path).published;
+			}
+			return published->Read();
+		}
+
+		/* Tracks a live instance of the prefab at path, its local overrides are what differs from the prefab right now */
+		void Track(const std::string& path, T* instance) {
+			Prefab& prefab = prefabs.at(path);
+			Track(path, instance, Compare::GetChanges(*prefab.value, *instance));
+		}
+
+		/* Tracks a live instance with known local overrides on top of the prefab */
+		void Track(const std::string& path, T* instance, json local) {
+			Prefab& prefab = prefabs.at(path);
+			if (local.is_null() || local.empty()) {
+				prefab.plain.push_back(instance);
+			} else {
+				prefab.overridden.push_back({ instance, std::move(local) });
+			}
+		}
+
+		void Untrack(const std::string& path, T* instance) {
+			Prefab& prefab = prefabs.at(path);
+			prefab.plain.erase(std::remove(prefab.plain.begin(), prefab.plain.end(), instance), prefab.plain.end());
+			prefab.overridden.erase(std::remove_if(prefab.overridden.begin(), prefab.overridden.end(),
+				[&](const Overridden& item) { return item.instance == instance; }), prefab.overridden.end());
+		}
+
+		/* Reloads the files that changed on disk, returns the paths that were reloaded */
+		std::vector<std::string> Update() {
+			std::vector<std::string> reloaded;
+			for (const auto& path : watcher.Poll()) {
+				if (prefabs.find(path) != prefabs.end() && Reload(path)) {
+					reloaded.push_back(path);
+				}
+			}
+			return reloaded;
+		}
+
+		/* Reads path again and applies the difference to its instances, returns false if the file could not be read */
+		bool Reload(const std::string& path) {
+			auto it = prefabs.find(path);
+			json j;
+			if (it == prefabs.end() || !ReadFile(path, j)) {
+				return false;
+			}
+			Prefab& prefab = it->second;
+			T next{};
+			Deserializer::FromJson(j, next);
+			json delta = Compare::GetChanges(*prefab.value, next);
+			prefab.value = std::make_shared<const T>(std::move(next));
+			prefab.published.Publish(prefab.value);
+			if (delta.is_null() || delta.empty()) {
+				return true;
+			}
+
+			/* Instances without overrides all get the same patch */
+			Overwrite::FromJsonBatch(delta, prefab.plain);
+			for (auto& item : prefab.overridden) {
+				Overwrite::FromJson(MaskPatch<T>(delta, item.local), *item.instance);
+			}
+			return true;
+		}
+
+	private:
+		struct Overridden {
+			T* instance;
+			json local;
+		};
+
+		struct Prefab {
+			std::shared_ptr<const T> value;
+			/* The same value, for readers on other threads */
+			Published<T> published;
+			std::vector<T*> plain;
+			std::vector<Overridden> overridden;
+		};
+
+		std::unordered_map<std::string, Prefab> prefabs;
+		/* Only guards adding to prefabs against Snapshot, the reload thread reads it without the lock */
+		mutable std::shared_mutex prefabs_mutex;
+		FileWatcher watcher;
+
+		static bool ReadFile(const std::string& path, json& j) {
+			std::ifstream file(path);
+			if (!file) {
+				return false;
+			}
+			j = json::parse(file, nullptr, false);
+			if (j.is_discarded()) {
+				/* Usually the file is still being written, the next change reloads it */
+				return false;
+			}
+			return true;
+		}
+	};
+}
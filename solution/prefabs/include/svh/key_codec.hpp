@@ -0,0 +1,120 @@
+#pragma once
+#include "svh/serializer.hpp"
+#include "svh/defines.hpp"
+
+#include <charconv>		// for std::to_chars, std::from_chars
+#include <string>		// for std::string
+#include <string_view>	// for std::string_view
+
+namespace svh {
+
+	/* Integral and plain enum keys are formatted with to_chars/from_chars */
+	template<typename K>
+	constexpr bool is_fast_key_v =
+		(std::is_integral<K>::value && !std::is_same<K, bool>::value) ||
+		(std::is_enum<K>::value && !has_serialize_v<K>);
+
+	/* Converts map keys to json object keys and back. */
+	/* Shared by Serialize, Deserialize, Compare and Overwrite so they always agree on the format */
+	template<typename K>
+	struct KeyCodec {
+
+		/* Key as it is written as an object key */
+		static std::string Encode(const K& key) {
+			if constexpr (is_string_v<K>) {
+				return key;
+			} else if constexpr (std::is_same_v<K, bool>) {
+				return key ? "true" : "false";
+			} else if constexpr (is_fast_key_v<K>) {
+				char buffer[24];
+				auto result = std::to_chars(buffer, buffer + sizeof(buffer), ToInteger(key));
+				return std::string(buffer, result.ptr);
+			} else {
+				return Serializer::ToJson(key).dump();
+			}
+		}
+
+		/* Key as it is written as a value, used by the "removed" list */
+		static json ToValue(const K& key) {
+			if constexpr (is_string_v<K> || std::is_same_v<K, bool>) {
+				return key;
+			} else if constexpr (is_fast_key_v<K>) {
+				return ToInteger(key);
+			} else {
+				return Serializer::ToJson(key);
+			}
+		}
+
+		/* Parses an object key, returns false if it could not be decoded */
+		static bool Decode(std::string_view str, K& key) {
+			if constexpr (is_string_v<K>) {
+				key.assign(str.data(), str.size());
+				return true;
+			} else if constexpr (std::is_same_v<K, bool>) {
+				if (str == "true") { key = true; return true; }
+				if (str == "false") { key = false; return true; }
+			} else if constexpr (is_fast_key_v<K>) {
+				decltype(ToInteger(key)) value{};
+				auto result = std::from_chars(str.data(), str.data() + str.size(), value);
+				if (result.ec == std::errc() && result.ptr == str.data() + str.size()) {
+					key = static_cast<K>(value);
+					return true;
+				}
+			}
+			return DecodeGeneric(str, key);
+		}
+
+		/* Parses a key written by ToValue (or as an object key string) */
+		static bool FromValue(const json& j, K& key) {
+			if (j.is_string()) {
+				return Decode(j.get_ref<const std::string&>(), key);
+			}
+			if constexpr (is_fast_key_v<K>) {
+				if (j.is_number_integer()) {
+					key = static_cast<K>(j.get<decltype(ToInteger(key))>());
+					return true;
+				}
+				return false;
+			} else {
+				Deserializer::FromJson(j, key);
+				return true;
+			}
+		}
+
+	private:
+		template<typename T>
+		static auto ToInteger(const T& key) {
+			if constexpr (std::is_enum<T>::value) {
+				return static_cast<std::underlying_type_t<T>>(key);
+			} else {
+				return key;
+			}
+		}
+
+		/* Anything else was written with dump(), parse it back without throwing */
+		static bool DecodeGeneric(std::string_view str, K& key) {
+			if constexpr (is_fast_key_v<K>) {
+				return false;
+			} else {
+				json keyJ = json::parse(str.begin(), str.end(), nullptr, false);
+				if (keyJ.is_discarded()) {
+					/* Not json, so it was a plain string key */
+					keyJ = json(std::string(str));
+				}
+				Deserializer::FromJson(keyJ, key);
+				return true;
+			}
+		}
+	};
+
+	/* Map keys are unique so they can be appended directly, */
+	/* ordered_json would otherwise do a linear search for every insert */
+	inline void EmplaceUniqueKey(json& object, std::string key, json value) {
+		auto& items = object.get_ref<json::object_t&>();
+		if constexpr (has_emplace_back_v<json::object_t>) {
+			items.emplace_back(std::move(key), std::move(value));
+		} else {
+			items.emplace(std::move(key), std::move(value));
+		}
+	}
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>			// for std::size_t
+#include <cstdint>			// for std::uint8_t
+#include <string>			// for std::string
+#include <utility>			// for std::exchange
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>		// for CreateFileMapping, MapViewOfFile
+#else
+#include <fcntl.h>			// for open
+#include <sys/mman.h>		// for mmap, munmap, madvise
+#include <sys/stat.h>		// for fstat
+#include <unistd.h>			// for close
+#endif
+
+namespace svh {
+
+	/* Read-only memory mapping of a whole file. */
+	/* Pages are loaded on first access and shared through the page cache with every process that maps the same file */
+	class MappedFile {
+	public:
+		MappedFile() = default;
+
+		~MappedFile() {
+			Close();
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		MappedFile(MappedFile&& other) noexcept
+			: bytes(std::exchange(other.bytes, nullptr)), length(std::exchange(other.length, 0)) {
+		}
+
+		MappedFile& operator=(MappedFile&& other) noexcept {
+			if (this != &other) {
+				Close();
+				bytes = std::exchange(other.bytes, nullptr);
+				length = std::exchange(other.length, 0);
+			}
+			return *this;
+		}
+
+		/* Returns false if the file can not be opened or mapped. An empty file opens with no data */
+		bool Open(const std::string& path) {
+			Close();
+#if defined(_WIN32)
+			HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE) {
+				return false;
+			}
+			LARGE_INTEGER size{};
+			if (!GetFileSizeEx(file, &size)) {
+				CloseHandle(file);
+				return false;
+			}
+			length = static_cast<std::size_t>(size.QuadPart);
+			if (length != 0) {
+				HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (mapping != nullptr) {
+					bytes = static_cast<const std::uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+					/* The view keeps the mapping alive */
+					CloseHandle(mapping);
+				}
+			}
+			CloseHandle(file);
+#else
+			int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			if (fd < 0) {
+				return false;
+			}
+			struct stat info {};
+			if (fstat(fd, &info) != 0) {
+				close(fd);
+				return false;
+			}
+			length = static_cast<std::size_t>(info.st_size);
+			if (length != 0) {
+				void* mapped = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+				if (mapped != MAP_FAILED) {
+					bytes = static_cast<const std::uint8_t*>(mapped);
+					/* Entries are read in any order, read-ahead would only load pages nobody asked for */
+					madvise(mapped, length, MADV_RANDOM);
+				}
+			}
+			/* The mapping stays valid after the descriptor is closed */
+			close(fd);
+#endif
+			if (length != 0 && bytes == nullptr) {
+				length = 0;
+				return false;
+			}
+			return true;
+		}
+
+		void Close() {
+			if (bytes != nullptr) {
+#if defined(_WIN32)
+				UnmapViewOfFile(bytes);
+#else
+				munmap(const_cast<std::uint8_t*>(bytes), length);
+#endif
+			}
+			bytes = nullptr;
+			length = 0;
+		}
+
+		const std::uint8_t* Data() const {
+			return bytes;
+		}
+
+		std::size_t Size() const {
+			return length;
+		}
+
+		bool IsOpen() const {
+			return bytes != nullptr;
+		}
+
+	private:
+		const std::uint8_t* bytes = nullptr;
+		std::size_t length = 0;
+	};
+}
@@ -0,0 +1,291 @@
+#pragma once
+#include "svh/serializer.hpp"
+#include "svh/std_types.hpp"
+#include "svh/key_codec.hpp"
+
+#include <cstddef>			// for std::size_t
+#include <map>				// for std::map
+#include <memory>			// for std::unique_ptr
+#include <string>			// for std::string
+#include <type_traits>		// for std::is_same
+#include <vector>			// for std::vector
+
+namespace svh {
+
+	/* Trie of the values a Compare patch overrides, with the same paths Overwrite reports to its observer. */
+	/* A value is overridden when the patch writes it as a whole: a leaf, a vector that gains or loses elements, */
+	/* or a map key that is added or removed. Lookups walk one node per path element */
+	class OverrideIndex {
+	public:
+		OverrideIndex() : root(std::make_unique<Node>()) {}
+
+		/* Replaces the index with the overrides in patch */
+		template<typename T>
+		void Assign(const json& patch) {
+			root = std::make_unique<Node>();
+			Insert<T>(*root, patch);
+		}
+
+		template<typename T>
+		static OverrideIndex Build(const json& patch) {
+			OverrideIndex index;
+			index.Assign<T>(patch);
+			return index;
+		}
+
+		/* Same result as Assign(next), only the struct fields that differ between the two patches are rebuilt */
+		template<typename T>
+		void Update(const json& previous, const json& next) {
+			UpdateImpl<T>(*root, previous, next);
+		}
+
+		/* True if the value at path, or a value that contains it, is overridden */
+		bool IsOverridden(const FieldPath& path) const {
+			const Node* node = root.get();
+			for (const auto& element : path) {
+				if (node->overridden) {
+					return true;
+				}
+				node = node->Find(element);
+				if (node == nullptr) {
+					return false;
+				}
+			}
+			return node->overridden;
+		}
+
+		/* True if anything at or under path is overridden, for example a single key of a map field */
+		bool HasOverrides(const FieldPath& path) const {
+			const Node* node = root.get();
+			for (const auto& element : path) {
+				if (node->overridden) {
+					return true;
+				}
+				node = node->Find(element);
+				if (node == nullptr) {
+					return false;
+				}
+			}
+			return node->overridden || !node->Empty();
+		}
+
+		bool Empty() const {
+			return !root->overridden && root->Empty();
+		}
+
+		/* Every overridden path, in index and key order */
+		std::vector<FieldPath> Paths() const {
+			std::vector<FieldPath> paths;
+			FieldPath path;
+			Collect(*root, path, paths);
+			return paths;
+		}
+
+		/* Index of the field called name in VISITABLE_STRUCT order, to build paths by name */
+		template<typename T>
+		static std::size_t FieldIndex(const std::string& name) {
+			std::size_t index = 0;
+			std::size_t found = visit_struct::field_count<T>();
+			visit_struct::visit_types<T>([&](const char* field, auto) {
+				if (name == field) found = index;
+				++index;
+			});
+			return found;
+		}
+
+	private:
+		struct Node {
+			/* Written as a whole, everything below is overridden too */
+			bool overridden = false;
+			/* Field or Index, for the edge from the parent */
+			PathElement::Kind kind = PathElement::Kind::Field;
+			/* Struct fields, vector indices and pair members */
+			std::map<std::size_t, std::unique_ptr<Node>> indices;
+			/* Map keys, encoded like the json object keys */
+			std::map<std::string, std::unique_ptr<Node>> keys;
+
+			const Node* Find(const PathElement& element) const {
+				if (element.kind == PathElement::Kind::Key) {
+					auto it = keys.find(element.key);
+					return it == keys.end() ? nullptr : it->second.get();
+				}
+				auto it = indices.find(element.index);
+				return it == indices.end() ? nullptr : it->second.get();
+			}
+
+			Node& Child(std::size_t index, PathElement::Kind kind) {
+				auto& child = indices[index];
+				if (!child) {
+					child = std::make_unique<Node>();
+					child->kind = kind;
+				}
+				return *child;
+			}
+
+			Node& Child(const std::string& key) {
+				auto& child = keys[key];
+				if (!child) child = std::make_unique<Node>();
+				return *child;
+			}
+
+			bool Empty() const {
+				return indices.empty() && keys.empty();
+			}
+		};
+
+		std::unique_ptr<Node> root;
+
+		/* Inserts into a new or existing child, a child that ends up without overrides is dropped again */
+		template<typename T, typename Key>
+		static void InsertChild(Node& node, const Key& key, PathElement::Kind kind, const json& patch) {
+			if constexpr (std::is_same_v<Key, std::string>) {
+				Insert<T>(node.Child(key), patch);
+				if (!node.keys[key]->overridden && node.keys[key]->Empty()) node.keys.erase(key);
+			} else {
+				Insert<T>(node.Child(key, kind), patch);
+				if (!node.indices[key]->overridden && node.indices[key]->Empty()) node.indices.erase(key);
+			}
+		}
+
+		template<typename T>
+		static void Insert(Node& node, const json& patch) {
+			if (patch.is_null()) {
+				return;
+			}
+			if constexpr (is_visitable_v<T> && !has_compare_v<T>) {
+				if (!patch.is_object()) {
+					node.overridden = true;
+					return;
+				}
+				std::size_t index = 0;
+				visit_struct::visit_types<T>([&](const char* name, auto type) {
+					using Field = typename decltype(type)::type;
+					auto it = patch.find(name);
+					if (it != patch.end()) {
+						InsertChild<Field>(node, index, PathElement::Kind::Field, *it);
+					}
+					++index;
+				});
+			} else if constexpr (is_associative_map_v<T>) {
+				InsertMap<T>(node, patch);
+			} else if constexpr (is_std_vector_v<T>) {
+				InsertVector<T>(node, patch);
+			} else if constexpr (is_pointer_like_v<T>) {
+				Insert<typename T::element_type>(node, patch);
+			} else if constexpr (is_std_pair_v<T>) {
+				if (!patch.is_object()) {
+					node.overridden = true;
+					return;
+				}
+				if (patch.contains(FIRST)) InsertChild<typename T::first_type>(node, std::size_t(0), PathElement::Kind::Index, patch[FIRST]);
+				if (patch.contains(SECOND)) InsertChild<typename T::second_type>(node, std::size_t(1), PathElement::Kind::Index, patch[SECOND]);
+			} else {
+				node.overridden = true;
+			}
+		}
+
+		template<typename Vector>
+		static void InsertVector(Node& node, const json& patch) {
+			using Elem = typename Vector::value_type;
+			if (!patch.is_object()) {
+				node.overridden = true;
+				return;
+			}
+			/* Added or removed elements shift the indices, the vector is overridden as a whole */
+			if (patch.contains(REMOVED) || patch.contains(ADDED_VALUES)) {
+				node.overridden = true;
+			}
+			if (patch.contains(CHANGED_VALUES)) {
+				for (const auto& change : patch[CHANGED_VALUES]) {
+					const auto& index = change[INDEX];
+					const std::size_t i = index.is_array() ? index[0].get<std::size_t>() : index.get<std::size_t>();
+					InsertChild<Elem>(node, i, PathElement::Kind::Index, change[VALUE]);
+				}
+			}
+		}
+
+		template<typename Map>
+		static void InsertMap(Node& node, const json& patch) {
+			using Key = typename Map::key_type;
+			using Value = typename Map::mapped_type;
+			if (!patch.is_object()) {
+				node.overridden = true;
+				return;
+			}
+			if (patch.contains(REMOVED)) {
+				for (const auto& keyJ : patch[REMOVED]) {
+					Key k{};
+					if (KeyCodec<Key>::FromValue(keyJ, k)) {
+						node.Child(KeyCodec<Key>::Encode(k)).overridden = true;
+					}
+				}
+			}
+			if (patch.contains(ADDED_VALUES)) {
+				for (const auto& item : patch[ADDED_VALUES]) {
+					for (auto it = item.begin(); it != item.end(); ++it) {
+						node.Child(it.key()).overridden = true;
+					}
+				}
+			}
+			if (patch.contains(CHANGED_VALUES)) {
+				for (const auto& item : patch[CHANGED_VALUES]) {
+					for (auto it = item.begin(); it != item.end(); ++it) {
+						InsertChild<Value>(node, it.key(), PathElement::Kind::Key, it.value());
+					}
+				}
+			}
+		}
+
+		template<typename T>
+		static void UpdateImpl(Node& node, const json& previous, const json& next) {
+			if constexpr (is_visitable_v<T> && !has_compare_v<T>) {
+				if (previous.is_object() && next.is_object() && !node.overridden) {
+					std::size_t index = 0;
+					visit_struct::visit_types<T>([&](const char* name, auto type) {
+						using Field = typename decltype(type)::type;
+						auto before = previous.find(name);
+						auto after = next.find(name);
+						const std::size_t field = index++;
+						if (before == previous.end() && after == next.end()) {
+							return;
+						}
+						if (before != previous.end() && after != next.end()) {
+							if (*before == *after) return;
+							UpdateImpl<Field>(node.Child(field, PathElement::Kind::Field), *before, *after);
+							if (!node.indices[field]->overridden && node.indices[field]->Empty()) node.indices.erase(field);
+							return;
+						}
+						/* Field added to or dropped from the patch */
+						node.indices.erase(field);
+						if (after != next.end()) {
+							InsertChild<Field>(node, field, PathElement::Kind::Field, *after);
+						}
+					});
+					return;
+				}
+			}
+			/* Anything else is rebuilt from the next patch */
+			node.overridden = false;
+			node.indices.clear();
+			node.keys.clear();
+			Insert<T>(node, next);
+		}
+
+		static void Collect(const Node& node, FieldPath& path, std::vector<FieldPath>& paths) {
+			if (node.overridden) {
+				paths.push_back(path);
+				return;
+			}
+			for (const auto& [index, child] : node.indices) {
+				path.push_back({ child->kind, index, {} });
+				Collect(*child, path, paths);
+				path.pop_back();
+			}
+			for (const auto& [key, child] : node.keys) {
+				path.push_back({ PathElement::Kind::Key, 0, key });
+				Collect(*child, path, paths);
+				path.pop_back();
+			}
+		}
+	};
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <algorithm>		// for std::min
+#include <atomic>			// for std::atomic
+#include <cstddef>			// for std::size_t
+#include <exception>		// for std::exception_ptr
+#include <mutex>			// for std::mutex
+#include <thread>			// for std::thread
+#include <vector>			// for std::vector
+
+namespace svh {
+
+	/* Calls function(i) for every i below count on up to thread_count threads (0 = hardware concurrency). */
+	/* The calling thread takes part, the first exception is rethrown once all threads stopped */
+	template<typename Function>
+	void ParallelFor(std::size_t count, unsigned thread_count, Function&& function) {
+		if (thread_count == 0) {
+			thread_count = std::max(1u, std::thread::hardware_concurrency());
+		}
+		thread_count = static_cast<unsigned>(std::min<std::size_t>(thread_count, count));
+		std::atomic<std::size_t> next{ 0 };
+		std::exception_ptr error;
+		std::mutex error_mutex;
+
+		auto worker = [&]() {
+			try {
+				for (std::size_t i = next++; i < count; i = next++) {
+					function(i);
+				}
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if (!error) error = std::current_exception();
+				next = count;
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (unsigned t = 1; t < thread_count; ++t) {
+			threads.emplace_back(worker);
+		}
+		worker();
+		for (auto& thread : threads) {
+			thread.join();
+		}
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+}
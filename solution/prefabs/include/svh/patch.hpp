@@ -0,0 +1,978 @@
+#pragma once
+#include "svh/serializer.hpp"
+#include "svh/std_types.hpp"
+#include "svh/key_codec.hpp"
+
+#include <algorithm>		// for std::sort
+#include <unordered_map>	// for std::unordered_map
+#include <vector>			// for std::vector
+
+/* Operations on the patches produced by svh::Compare::GetChanges */
+
+namespace svh {
+
+	class Composer {
+	public:
+		/* For users */
+		/* Returns a patch that has the same effect as applying first and then second */
+		template<typename T>
+		static json Merge(const json& first, const json& second) {
+			if (first.is_null()) return second;
+			if (second.is_null()) return first;
+			return MergeImpl<T>(first, second);
+		}
+
+		/* For visitable struct */
+		template<typename T>
+		void operator()(const char* name, visit_struct::type_c<T>) {
+			auto left = first.find(name);
+			auto right = second.find(name);
+			if (left == first.end() && right == second.end()) {
+				return;
+			}
+			json merged = Merge<T>(
+				left != first.end() ? *left : json(),
+				right != second.end() ? *right : json());
+			if (!merged.is_null()) {
+				result[name] = std::move(merged);
+			}
+		}
+
+	private: /* Variables */
+		const json& first;
+		const json& second;
+		json result;
+
+	private: /* Functions */
+		Composer(const json& f, const json& s) : first(f), second(s), result(json()) {}
+
+		/* Applies a patch to a full value, used once a value is no longer relative to the base */
+		template<typename T>
+		static json ApplyToValue(const json& value, const json& patch) {
+			T tmp{};
+			Overwrite::FromJson(value, tmp);
+			Overwrite::FromJson(patch, tmp);
+			return Serializer::ToJson(tmp);
+		}
+
+		template<typename T>
+		static json MergeImpl(const json& first, const json& second) {
+			if constexpr (is_visitable_v<T>) {
+				if (!first.is_object() || !second.is_object()) {
+					return second;
+				}
+				Composer composer(first, second);
+				visit_struct::visit_types<T>(composer);
+				return composer.result;
+			} else if constexpr (is_std_vector_v<T>) {
+				return MergeVector<T>(first, second);
+			} else if constexpr (is_associative_map_v<T>) {
+				return MergeMap<T>(first, second);
+			} else if constexpr (is_std_pair_v<T>) {
+				return MergePair<T>(first, second);
+			} else if constexpr (is_std_tuple_v<T>) {
+				return MergeTuple<T>(first, second, std::make_index_sequence<std::tuple_size<T>::value>{});
+			} else if constexpr (is_pointer_like_v<T> || is_specialization<T, std::weak_ptr>::value) {
+				/* Pointers are compared and overwritten through the object they point to */
+				return Merge<typename T::element_type>(first, second);
+			} else if constexpr (is_sequence_v<T>) {
+				/* Compare and Overwrite handle other sequences as (nested) std::vectors */
+				using Vector = decltype(to_std_vector(std::declval<const T&>()));
+				return Merge<Vector>(first, second);
+			} else if constexpr (has_compare_v<T>) {
+				/* User defined patches are assumed to be partial objects */
+				if (first.is_object() && second.is_object()) {
+					json merged = first;
+					for (auto it = second.begin(); it != second.end(); ++it) {
+						merged[it.key()] = it.value();
+					}
+					return merged;
+				}
+				return second;
+			} else {
+				/* Anything else is written as a full value */
+				return second;
+			}
+		}
+
+		/* A slot of the sequence while replaying the patches on an unknown base */
+		struct VectorSlot {
+			bool added;			/* value is a full value instead of a patch on the base */
+			long long index;	/* index in the base, when not added */
+			json value;
+		};
+
+		template<typename Vector>
+		static json MergeVector(const json& first, const json& second) {
+			using Elem = typename Vector::value_type;
+
+			/* A full replace makes the rest of the chain independent of the base */
+			if (second.is_array()) {
+				return second;
+			}
+			if (first.is_array()) {
+				return ApplyToValue<Vector>(first, second);
+			}
+
+			std::vector<VectorSlot> slots;
+			std::vector<long long> removed;
+			long long next_index = 0;
+
+			/* Base elements are only materialized once a patch refers to them */
+			auto reserve = [&](std::size_t size) {
+				while (slots.size() < size) {
+					slots.push_back({ false, next_index++, json() });
+				}
+			};
+
+			auto apply = [&](const json& patch) {
+				if (!patch.is_object()) {
+					return Deserializer::HandleError("vector patch", patch);
+				}
+				if (patch.contains(REMOVED)) {
+					std::size_t offset = 0;
+					for (auto const& idx : patch[REMOVED]) {
+						std::size_t i = std::getIndex(idx) - offset;
+						reserve(i + 1);
+						if (!slots[i].added) {
+							removed.push_back(slots[i].index);
+						}
+						slots.erase(slots.begin() + i);
+						++offset;
+					}
+				}
+				if (patch.contains(ADDED_VALUES)) {
+					for (auto const& item : patch[ADDED_VALUES]) {
+						std::size_t i = std::getIndex(item[INDEX]);
+						reserve(i);
+						slots.insert(slots.begin() + i, { true, -1, item[VALUE] });
+					}
+				}
+				if (patch.contains(CHANGED_VALUES)) {
+					for (auto const& item : patch[CHANGED_VALUES]) {
+						std::size_t i = std::getIndex(item[INDEX]);
+						reserve(i + 1);
+						auto& slot = slots[i];
+						if (slot.added) {
+							slot.value = ApplyToValue<Elem>(slot.value, item[VALUE]);
+						} else {
+							slot.value = Merge<Elem>(slot.value, item[VALUE]);
+						}
+					}
+				}
+			};
+
+			apply(first);
+			apply(second);
+
+			/* Removals use base indices, additions and changes use indices in the result */
+			std::sort(removed.begin(), removed.end());
+			json removed_json = json::array();
+			json added_json = json::array();
+			json changed_json = json::array();
+			for (auto idx : removed) {
+				removed_json.push_back(json::array({ idx }));
+			}
+			for (std::size_t i = 0; i < slots.size(); ++i) {
+				auto& slot = slots[i];
+				if (slot.added) {
+					added_json.push_back(json::object({
+						{ INDEX, json::array({ i }) },
+						{ VALUE, std::move(slot.value) }
+						}));
+				} else if (!slot.value.is_null()) {
+					changed_json.push_back(json::object({
+						{ INDEX, json::array({ i }) },
+						{ VALUE, std::move(slot.value) }
+						}));
+				}
+			}
+
+			json result = json::object();
+			if (!removed_json.empty()) result[REMOVED] = std::move(removed_json);
+			if (!added_json.empty())   result[ADDED_VALUES] = std::move(added_json);
+			if (!changed_json.empty()) result[CHANGED_VALUES] = std::move(changed_json);
+			return result.empty() ? json() : result;
+		}
+
+		/* What the chain did to a single key of the base */
+		struct MapEntry {
+			enum Kind { Absent, Removed, Set, Changed } kind;
+			bool remove_first;	/* Set replaces a key that may exist in the base */
+			json value;
+		};
+
+		template<typename Map>
+		static json MergeMap(const json& first, const json& second) {
+			using Key = typename Map::key_type;
+			using Value = typename Map::mapped_type;
+
+			if (second.is_array()) {
+				return second;
+			}
+			if (first.is_array()) {
+				Map values;
+				Overwrite::FromJson(first, values);
+				Overwrite::FromJson(second, values);
+				json result = json::array();
+				for (auto const& [k, v] : values) {
+					json entry = json::object();
+					EmplaceUniqueKey(entry, KeyCodec<Key>::Encode(k), Serializer::ToJson(v));
+					result.push_back(std::move(entry));
+				}
+				return result;
+			}
+
+			/* Keys are normalized through the codec so "removed" values and object keys match */
+			std::vector<std::pair<std::string, Key>> order;
+			std::unordered_map<std::string, MapEntry> entries;
+
+			auto find = [&](const Key& k, std::string& encoded) {
+				encoded = KeyCodec<Key>::Encode(k);
+				auto it = entries.find(encoded);
+				if (it == entries.end()) {
+					order.emplace_back(encoded, k);
+				}
+				return it;
+			};
+
+			auto apply = [&](const json& patch) {
+				if (!patch.is_object()) {
+					return Deserializer::HandleError("map patch", patch);
+				}
+				std::string encoded;
+				if (patch.contains(REMOVED)) {
+					for (auto const& keyJ : patch[REMOVED]) {
+						Key k{};
+						if (!KeyCodec<Key>::FromValue(keyJ, k)) {
+							Deserializer::HandleError("map key", keyJ);
+							continue;
+						}
+						auto it = find(k, encoded);
+						if (it != entries.end() && it->second.kind == MapEntry::Set && !it->second.remove_first) {
+							/* Added and removed again, the base never had it */
+							it->second = { MapEntry::Absent, false, json() };
+						} else {
+							entries[encoded] = { MapEntry::Removed, false, json() };
+						}
+					}
+				}
+				if (patch.contains(ADDED_VALUES)) {
+					for (auto const& item : patch[ADDED_VALUES]) {
+						for (auto it = item.begin(); it != item.end(); ++it) {
+							Key k{};
+							if (!KeyCodec<Key>::Decode(it.key(), k)) {
+								Deserializer::HandleError("map key", item);
+								continue;
+							}
+							auto entry = find(k, encoded);
+							if (entry == entries.end() || entry->second.kind == MapEntry::Absent) {
+								entries[encoded] = { MapEntry::Set, false, it.value() };
+							} else if (entry->second.kind == MapEntry::Removed) {
+								entry->second = { MapEntry::Set, true, it.value() };
+							}
+							/* Otherwise the key exists and emplace would not replace it */
+						}
+					}
+				}
+				if (patch.contains(CHANGED_VALUES)) {
+					for (auto const& item : patch[CHANGED_VALUES]) {
+						for (auto it = item.begin(); it != item.end(); ++it) {
+							Key k{};
+							if (!KeyCodec<Key>::Decode(it.key(), k)) {
+								Deserializer::HandleError("map key", item);
+								continue;
+							}
+							auto entry = find(k, encoded);
+							if (entry == entries.end()) {
+								entries[encoded] = { MapEntry::Changed, false, it.value() };
+							} else if (entry->second.kind == MapEntry::Set) {
+								entry->second.value = ApplyToValue<Value>(entry->second.value, it.value());
+							} else if (entry->second.kind == MapEntry::Changed) {
+								entry->second.value = Merge<Value>(entry->second.value, it.value());
+							}
+						}
+					}
+				}
+			};
+
+			apply(first);
+			apply(second);
+
+			json removed_json = json::array();
+			json added_json = json::array();
+			json changed_json = json::array();
+			for (auto& [encoded, k] : order) {
+				auto& entry = entries[encoded];
+				if (entry.kind == MapEntry::Removed || (entry.kind == MapEntry::Set && entry.remove_first)) {
+					removed_json.push_back(KeyCodec<Key>::ToValue(k));
+				}
+				if (entry.kind == MapEntry::Set) {
+					json item = json::object();
+					EmplaceUniqueKey(item, encoded, std::move(entry.value));
+					added_json.push_back(std::move(item));
+				} else if (entry.kind == MapEntry::Changed && !entry.value.is_null()) {
+					json item = json::object();
+					EmplaceUniqueKey(item, encoded, std::move(entry.value));
+					changed_json.push_back(std::move(item));
+				}
+			}
+
+			/* Same key order as Compare */
+			json result = json::object();
+			if (!removed_json.empty()) result[REMOVED] = std::move(removed_json);
+			if (!changed_json.empty()) result[CHANGED_VALUES] = std::move(changed_json);
+			if (!added_json.empty()) result[ADDED_VALUES] = std::move(added_json);
+			return result.empty() ? json() : result;
+		}
+
+		template<typename Pair>
+		static json MergePair(const json& first, const json& second) {
+			if (!first.is_object() || !second.is_object()) {
+				return second;
+			}
+			auto get = [](const json& j, const char* key) {
+				auto it = j.find(key);
+				return it != j.end() ? *it : json();
+			};
+			json result = json::object();
+			json merged_first = Merge<typename Pair::first_type>(get(first, FIRST), get(second, FIRST));
+			json merged_second = Merge<typename Pair::second_type>(get(first, SECOND), get(second, SECOND));
+			if (!merged_first.is_null()) result[FIRST] = std::move(merged_first);
+			if (!merged_second.is_null()) result[SECOND] = std::move(merged_second);
+			return result.empty() ? json() : result;
+		}
+
+		/* Tuples are only ever patched per index through "changed" */
+		template<typename Tuple, std::size_t... I>
+		static json MergeTuple(const json& first, const json& second, std::index_sequence<I...>) {
+			json per_index[sizeof...(I) + 1];
+			auto collect = [&](const json& patch, bool is_second) {
+				auto it = patch.find(CHANGED_VALUES);
+				if (it == patch.end() || !it->is_array()) {
+					return;
+				}
+				for (auto const& change : *it) {
+					std::size_t i = std::getIndex(change[INDEX]);
+					if (i >= sizeof...(I)) {
+						continue;
+					}
+					json& slot = per_index[i];
+					/* Merged per index below, keep both sides apart until then */
+					if (is_second) {
+						slot[SECOND] = change[VALUE];
+					} else {
+						slot[FIRST] = change[VALUE];
+					}
+				}
+			};
+			if (!first.is_object() || !second.is_object()) {
+				return second;
+			}
+			collect(first, false);
+			collect(second, true);
+
+			json changed = json::array();
+			auto merge_index = [&](auto index) {
+				constexpr std::size_t i = decltype(index)::value;
+				const json& slot = per_index[i];
+				if (slot.is_null()) {
+					return;
+				}
+				json merged = Merge<std::tuple_element_t<i, Tuple>>(
+					slot.contains(FIRST) ? slot[FIRST] : json(),
+					slot.contains(SECOND) ? slot[SECOND] : json());
+				if (!merged.is_null()) {
+					changed.push_back(json::object({
+						{ INDEX, json::array({ i }) },
+						{ VALUE, std::move(merged) }
+						}));
+				}
+			};
+			(merge_index(std::integral_constant<std::size_t, I>{}), ...);
+
+			if (changed.empty()) {
+				return json();
+			}
+			json result = json::object();
+			result[CHANGED_VALUES] = std::move(changed);
+			return result;
+		}
+	};
+
+	class Inverter {
+	public:
+		/* For users */
+		/* Returns the patch that turns right back into left, given the changes from left to right */
+		template<typename T>
+		static json GetUndo(const json& redo, const T& left, const T& right) {
+			if (redo.is_null()) {
+				return json();
+			}
+			return GetUndoImpl(redo, left, right);
+		}
+
+		/* For visitable struct */
+		template<typename T>
+		void operator()(const char* name, const T& left, const T& right) {
+			auto it = redo.find(name);
+			if (it == redo.end()) {
+				return;
+			}
+			auto undo = GetUndo(*it, left, right);
+			if (!undo.is_null()) {
+				result[name] = std::move(undo);
+			}
+		}
+
+	private: /* Variables */
+		const json& redo;
+		json result;
+
+	private: /* Functions */
+		Inverter(const json& r) : redo(r), result(json()) {}
+
+		/* Only the fields and keys that appear in the redo patch are visited */
+		template<typename T>
+		static json GetUndoImpl(const json& redo, const T& left, const T& right) {
+			if constexpr (is_visitable_v<T> && !has_compare_v<T>) {
+				if (!redo.is_object()) {
+					return Compare::GetChanges(right, left);
+				}
+				Inverter inverter(redo);
+				visit_struct::for_each(left, right, inverter);
+				return inverter.result;
+			} else if constexpr (is_associative_map_v<T>) {
+				return GetUndoMap(redo, left, right);
+			} else if constexpr (is_pointer_like_v<T>) {
+				if (left && right) {
+					return GetUndo(redo, *left, *right);
+				}
+				return Compare::GetChanges(right, left);
+			} else {
+				return Compare::GetChanges(right, left);
+			}
+		}
+
+		template<typename Map>
+		static json GetUndoMap(const json& redo, const Map& left, const Map& right) {
+			using Key = typename Map::key_type;
+			if (!redo.is_object()) {
+				return Compare::GetChanges(right, left);
+			}
+
+			json removed_keys = json::array();
+			json changed = json::array();
+			json added_entries = json::array();
+
+			/* Keys added by redo are removed again */
+			if (redo.contains(ADDED_VALUES)) {
+				for (auto const& item : redo[ADDED_VALUES]) {
+					for (auto it = item.begin(); it != item.end(); ++it) {
+						Key k{};
+						if (KeyCodec<Key>::Decode(it.key(), k)) {
+							removed_keys.push_back(KeyCodec<Key>::ToValue(k));
+						}
+					}
+				}
+			}
+
+			/* Changed keys are inverted recursively */
+			if (redo.contains(CHANGED_VALUES)) {
+				for (auto const& item : redo[CHANGED_VALUES]) {
+					for (auto it = item.begin(); it != item.end(); ++it) {
+						Key k{};
+						if (!KeyCodec<Key>::Decode(it.key(), k)) {
+							continue;
+						}
+						auto lit = left.find(k);
+						auto rit = right.find(k);
+						if (lit == left.end() || rit == right.end()) {
+							continue;
+						}
+						auto undo = GetUndo(it.value(), lit->second, rit->second);
+						if (!undo.is_null()) {
+							json entry = json::object();
+							EmplaceUniqueKey(entry, it.key(), std::move(undo));
+							changed.push_back(std::move(entry));
+						}
+					}
+				}
+			}
+
+			/* Removed keys are added back with their previous value */
+			if (redo.contains(REMOVED)) {
+				for (auto const& keyJ : redo[REMOVED]) {
+					Key k{};
+					if (!KeyCodec<Key>::FromValue(keyJ, k)) {
+						continue;
+					}
+					auto lit = left.find(k);
+					if (lit != left.end()) {
+						json entry = json::object();
+						EmplaceUniqueKey(entry, KeyCodec<Key>::Encode(k), Serializer::ToJson(lit->second));
+						added_entries.push_back(std::move(entry));
+					}
+				}
+			}
+
+			json result = json::object();
+			if (!removed_keys.empty()) result[REMOVED] = std::move(removed_keys);
+			if (!changed.empty()) result[CHANGED_VALUES] = std::move(changed);
+			if (!added_entries.empty()) result[ADDED_VALUES] = std::move(added_entries);
+			return result.empty() ? json() : result;
+		}
+	};
+
+	/* Changes from left to right that also carry what is needed to go back. */
+	/* Returns {"redo": changes, "undo": inverse changes}, or null when nothing changed */
+	template<typename T>
+	json GetInvertibleChanges(const T& left, const T& right) {
+		json redo = Compare::GetChanges(left, right);
+		if (redo.is_null() || redo.empty()) {
+			return json();
+		}
+		json undo = Inverter::GetUndo(redo, left, right);
+		json result = json::object();
+		result[REDO] = std::move(redo);
+		result[UNDO] = std::move(undo);
+		return result;
+	}
+
+	/* Swaps the direction of an invertible patch */
+	inline json Invert(const json& patch) {
+		if (!patch.is_object() || !patch.contains(REDO) || !patch.contains(UNDO)) {
+			Deserializer::HandleError("invertible patch", patch);
+			return json();
+		}
+		json result = json::object();
+		result[REDO] = patch[UNDO];
+		result[UNDO] = patch[REDO];
+		return result;
+	}
+
+	/* Rough number of bytes a json value keeps alive, used for memory budgets */
+	inline std::size_t EstimateSize(const json& j) {
+		std::size_t size = sizeof(json);
+		switch (j.type()) {
+		case json::value_t::object:
+			size += sizeof(json::object_t);
+			for (auto it = j.begin(); it != j.end(); ++it) {
+				size += sizeof(json::string_t) + it.key().capacity() + EstimateSize(it.value());
+			}
+			break;
+		case json::value_t::array:
+			size += sizeof(json::array_t);
+			for (const auto& item : j) {
+				size += EstimateSize(item);
+			}
+			break;
+		case json::value_t::string:
+			size += sizeof(json::string_t) + j.get_ref<const json::string_t&>().capacity();
+			break;
+		case json::value_t::binary:
+			size += sizeof(json::binary_t) + j.get_binary().capacity();
+			break;
+		default:
+			break;
+		}
+		return size;
+	}
+
+	/* Squashes a chain of Compare patches (applied in order) into a single equivalent patch */
+	template<typename T>
+	json ComposePatches(const std::vector<json>& chain) {
+		json result;
+		for (const auto& patch : chain) {
+			result = Composer::Merge<T>(result, patch);
+		}
+		return result;
+	}
+
+	template<typename T, typename... Patches>
+	json ComposePatches(const json& first, const Patches&... rest) {
+		json result = first;
+		((result = Composer::Merge<T>(result, rest)), ...);
+		return result;
+	}
+
+	class Masker {
+	public:
+		/* For users */
+		/* Removes from patch every value that mask also changes */
+		template<typename T>
+		static json Mask(const json& patch, const json& mask) {
+			if (patch.is_null() || mask.is_null()) {
+				return patch;
+			}
+			return MaskImpl<T>(patch, mask);
+		}
+
+		/* For visitable struct */
+		template<typename T>
+		void operator()(const char* name, visit_struct::type_c<T>) {
+			auto it = patch.find(name);
+			if (it == patch.end()) {
+				return;
+			}
+			auto mask_it = mask.find(name);
+			auto masked = mask_it == mask.end() ? *it : Mask<T>(*it, *mask_it);
+			if (!masked.is_null()) {
+				result[name] = std::move(masked);
+			}
+		}
+
+	private: /* Variables */
+		const json& patch;
+		const json& mask;
+		json result;
+
+	private: /* Functions */
+		Masker(const json& p, const json& m) : patch(p), mask(m), result(json()) {}
+
+		template<typename T>
+		static json MaskImpl(const json& patch, const json& mask) {
+			if constexpr (is_visitable_v<T> && !has_compare_v<T>) {
+				if (!patch.is_object() || !mask.is_object()) {
+					return json();
+				}
+				Masker masker(patch, mask);
+				visit_struct::visit_types<T>(masker);
+				return masker.result;
+			} else if constexpr (is_associative_map_v<T>) {
+				return MaskMap<T>(patch, mask);
+			} else if constexpr (is_pointer_like_v<T>) {
+				return MaskImpl<typename T::element_type>(patch, mask);
+			} else {
+				/* Vectors and leaves are owned by whoever changed them */
+				return json();
+			}
+		}
+
+		template<typename Map>
+		static json MaskMap(const json& patch, const json& mask) {
+			using Key = typename Map::key_type;
+			using Value = typename Map::mapped_type;
+			if (!patch.is_object() || !mask.is_object()) {
+				return json();
+			}
+
+			/* Keys the mask adds or removes are owned by it, changed keys are masked per value */
+			std::unordered_map<std::string, const json*> owned;
+			if (mask.contains(REMOVED)) {
+				for (auto const& keyJ : mask[REMOVED]) {
+					Key k{};
+					if (KeyCodec<Key>::FromValue(keyJ, k)) {
+						owned.emplace(KeyCodec<Key>::Encode(k), nullptr);
+					}
+				}
+			}
+			for (const char* section : { ADDED_VALUES, CHANGED_VALUES }) {
+				if (!mask.contains(section)) {
+					continue;
+				}
+				const bool added = section == ADDED_VALUES;
+				for (auto const& item : mask[section]) {
+					for (auto it = item.begin(); it != item.end(); ++it) {
+						owned.emplace(it.key(), added ? nullptr : &it.value());
+					}
+				}
+			}
+
+			json result = json::object();
+			if (patch.contains(REMOVED)) {
+				json removed_keys = json::array();
+				for (auto const& keyJ : patch[REMOVED]) {
+					Key k{};
+					if (KeyCodec<Key>::FromValue(keyJ, k) && owned.find(KeyCodec<Key>::Encode(k)) == owned.end()) {
+						removed_keys.push_back(keyJ);
+					}
+				}
+				if (!removed_keys.empty()) result[REMOVED] = std::move(removed_keys);
+			}
+			for (const char* section : { CHANGED_VALUES, ADDED_VALUES }) {
+				if (!patch.contains(section)) {
+					continue;
+				}
+				json entries = json::array();
+				for (auto const& item : patch[section]) {
+					for (auto it = item.begin(); it != item.end(); ++it) {
+						auto owner = owned.find(it.key());
+						json value;
+						if (owner == owned.end()) {
+							value = it.value();
+						} else if (owner->second != nullptr && section == CHANGED_VALUES) {
+							value = Mask<Value>(it.value(), *owner->second);
+						}
+						if (!value.is_null()) {
+							json entry = json::object();
+							EmplaceUniqueKey(entry, it.key(), std::move(value));
+							entries.push_back(std::move(entry));
+						}
+					}
+				}
+				if (!entries.empty()) result[section] = std::move(entries);
+			}
+			return result.empty() ? json() : result;
+		}
+	};
+
+	/* Removes from patch every value that mask also changes, for example a prefab edit minus an instance's own overrides */
+	template<typename T>
+	json MaskPatch(const json& patch, const json& mask) {
+		return Masker::Mask<T>(patch, mask);
+	}
+
+	/* A value changed by both the base edit and the instance, the instance value is kept */
+	struct RebaseConflict {
+		FieldPath path;
+		/* Value in the new base, null if the base removed it */
+		json base;
+		/* Value the instance keeps, null if the instance removed it */
+		json instance;
+	};
+
+	struct RebaseResult {
+		/* The instance patch, now relative to the new base */
+		json patch;
+		std::vector<RebaseConflict> conflicts;
+	};
+
+	class Rebaser {
+	public:
+		/* For users */
+		template<typename T>
+		static RebaseResult Rebase(const T& old_base, const T& new_base, const json& patch) {
+			Rebaser rebaser;
+			RebaseResult result;
+			result.patch = rebaser.RebaseImpl(old_base, new_base, patch);
+			result.conflicts = std::move(rebaser.conflicts);
+			return result;
+		}
+
+	private: /* Variables */
+		FieldPath path;
+		std::vector<RebaseConflict> conflicts;
+
+	private: /* Functions */
+		/* Visits the fields of the old and new base together */
+		struct FieldVisitor {
+			Rebaser& rebaser;
+			const json& patch;
+			json result = json::object();
+			std::size_t index = 0;
+
+			template<typename T>
+			void operator()(const char* name, const T& old_base, const T& new_base) {
+				const std::size_t field = index++;
+				auto it = patch.find(name);
+				if (it == patch.end()) {
+					return;
+				}
+				rebaser.path.push_back({ PathElement::Kind::Field, field, {} });
+				auto rebased = rebaser.RebaseImpl(old_base, new_base, *it);
+				rebaser.path.pop_back();
+				if (!rebased.is_null()) {
+					result[name] = std::move(rebased);
+				}
+			}
+		};
+
+		/* Only the parts touched by the instance patch are visited */
+		template<typename T>
+		json RebaseImpl(const T& old_base, const T& new_base, const json& patch) {
+			if (patch.is_null()) {
+				return json();
+			}
+			if constexpr (is_visitable_v<T> && !has_compare_v<T>) {
+				if (!patch.is_object()) {
+					return RebaseValue(old_base, new_base, patch);
+				}
+				FieldVisitor visitor{ *this, patch };
+				visit_struct::for_each(old_base, new_base, visitor);
+				return visitor.result.empty() ? json() : std::move(visitor.result);
+			} else if constexpr (is_associative_map_v<T>) {
+				return RebaseMap(old_base, new_base, patch);
+			} else if constexpr (is_std_vector_v<T>) {
+				return RebaseVector(old_base, new_base, patch);
+			} else if constexpr (is_pointer_like_v<T>) {
+				if (old_base && new_base) {
+					return RebaseImpl(*old_base, *new_base, patch);
+				}
+				return RebaseValue(old_base, new_base, patch);
+			} else {
+				return RebaseValue(old_base, new_base, patch);
+			}
+		}
+
+		/* The instance overrides this value as a whole */
+		template<typename T>
+		json RebaseValue(const T& old_base, const T& new_base, const json& patch) {
+			if (Compare::GetChanges(old_base, new_base).empty()) {
+				return patch;
+			}
+			T instance = Materialize(old_base, patch);
+			json rebased = Compare::GetChanges(new_base, instance);
+			if (rebased.empty()) {
+				/* The base now has the same value, the override is no longer needed */
+				return json();
+			}
+			AddConflict(Serializer::ToJson(new_base), Serializer::ToJson(instance));
+			return rebased;
+		}
+
+		/* Three way merge of the element sequences */
+		template<typename Vector>
+		json RebaseVector(const Vector& old_base, const Vector& new_base, const json& patch) {
+			using Elem = typename Vector::value_type;
+			if (Compare::GetChanges(old_base, new_base).empty()) {
+				return patch;
+			}
+			Vector instance = Materialize(old_base, patch);
+
+			dtl::Diff3<Elem, Vector, std::CustomCompare<Elem>> merge(instance, old_base, new_base);
+			merge.compose();
+			Vector merged;
+			if (merge.merge()) {
+				merged = merge.getMergedSequence();
+			} else {
+				AddConflict(Serializer::ToJson(new_base), Serializer::ToJson(instance));
+				merged = std::move(instance);
+			}
+			json rebased = Compare::GetChanges(new_base, merged);
+			return rebased.empty() ? json() : rebased;
+		}
+
+		template<typename Map>
+		json RebaseMap(const Map& old_base, const Map& new_base, const json& patch) {
+			using Key = typename Map::key_type;
+			using Value = typename Map::mapped_type;
+
+			if (!patch.is_object()) {
+				/* Full replace, keeps replacing whatever the base became */
+				if (!Compare::GetChanges(old_base, new_base).empty()) {
+					AddConflict(Serializer::ToJson(new_base), patch);
+				}
+				return patch;
+			}
+
+			json removed_keys = json::array();
+			json changed = json::array();
+			json added_entries = json::array();
+
+			/* Removed by the instance */
+			if (patch.contains(REMOVED)) {
+				for (auto const& keyJ : patch[REMOVED]) {
+					Key k{};
+					if (!KeyCodec<Key>::FromValue(keyJ, k)) {
+						continue;
+					}
+					auto new_it = new_base.find(k);
+					if (new_it == new_base.end()) {
+						/* The base removed it as well */
+						continue;
+					}
+					auto old_it = old_base.find(k);
+					if (old_it != old_base.end() && !Compare::GetChanges(old_it->second, new_it->second).empty()) {
+						path.push_back({ PathElement::Kind::Key, 0, KeyCodec<Key>::Encode(k) });
+						AddConflict(Serializer::ToJson(new_it->second), json());
+						path.pop_back();
+					}
+					removed_keys.push_back(keyJ);
+				}
+			}
+
+			/* Changed by the instance */
+			if (patch.contains(CHANGED_VALUES)) {
+				for (auto const& item : patch[CHANGED_VALUES]) {
+					for (auto it = item.begin(); it != item.end(); ++it) {
+						Key k{};
+						if (!KeyCodec<Key>::Decode(it.key(), k)) {
+							continue;
+						}
+						auto old_it = old_base.find(k);
+						if (old_it == old_base.end()) {
+							continue;
+						}
+						path.push_back({ PathElement::Kind::Key, 0, it.key() });
+						auto new_it = new_base.find(k);
+						if (new_it == new_base.end()) {
+							/* The base removed a key the instance changed, add it back */
+							json value = Serializer::ToJson(Materialize(old_it->second, it.value()));
+							AddConflict(json(), value);
+							json entry = json::object();
+							EmplaceUniqueKey(entry, it.key(), std::move(value));
+							added_entries.push_back(std::move(entry));
+						} else {
+							auto rebased = RebaseImpl(old_it->second, new_it->second, it.value());
+							if (!rebased.is_null()) {
+								json entry = json::object();
+								EmplaceUniqueKey(entry, it.key(), std::move(rebased));
+								changed.push_back(std::move(entry));
+							}
+						}
+						path.pop_back();
+					}
+				}
+			}
+
+			/* Added by the instance */
+			if (patch.contains(ADDED_VALUES)) {
+				for (auto const& item : patch[ADDED_VALUES]) {
+					for (auto it = item.begin(); it != item.end(); ++it) {
+						Key k{};
+						if (!KeyCodec<Key>::Decode(it.key(), k)) {
+							continue;
+						}
+						auto new_it = new_base.find(k);
+						if (new_it == new_base.end()) {
+							json entry = json::object();
+							EmplaceUniqueKey(entry, it.key(), it.value());
+							added_entries.push_back(std::move(entry));
+							continue;
+						}
+						/* The base added the same key */
+						Value value{};
+						Overwrite::FromJson(it.value(), value);
+						auto difference = Compare::GetChanges(new_it->second, value);
+						if (!difference.empty()) {
+							path.push_back({ PathElement::Kind::Key, 0, it.key() });
+							AddConflict(Serializer::ToJson(new_it->second), it.value());
+							path.pop_back();
+							json entry = json::object();
+							EmplaceUniqueKey(entry, it.key(), std::move(difference));
+							changed.push_back(std::move(entry));
+						}
+					}
+				}
+			}
+
+			json result = json::object();
+			if (!removed_keys.empty()) result[REMOVED] = std::move(removed_keys);
+			if (!changed.empty()) result[CHANGED_VALUES] = std::move(changed);
+			if (!added_entries.empty()) result[ADDED_VALUES] = std::move(added_entries);
+			return result.empty() ? json() : result;
+		}
+
+		/* The value the instance had on top of the old base. */
+		/* Copied through json so shared pointers in the base are not written to */
+		template<typename T>
+		static T Materialize(const T& old_base, const json& patch) {
+			T value{};
+			Deserializer::FromJson(Serializer::ToJson(old_base), value);
+			Overwrite::FromJson(patch, value);
+			return value;
+		}
+
+		void AddConflict(json base, json instance) {
+			conflicts.push_back({ path, std::move(base), std::move(instance) });
+		}
+	};
+
+	/* Moves an instance patch from old_base onto new_base without materializing the whole object. */
+	/* Where both changed the same value the instance wins and a conflict is reported */
+	template<typename T>
+	RebaseResult Rebase(const T& old_base, const T& new_base, const json& instance_patch) {
+		return Rebaser::Rebase(old_base, new_base, instance_patch);
+	}
+}
@@ -0,0 +1,276 @@
+#pragma once
+#include "svh/serializer.hpp"
+#include "svh/cooked.hpp"
+
+#include <chrono>			// for std::chrono::seconds
+#include <cstdint>			// for std::uint8_t, std::uint32_t, std::uint64_t
+#include <cstring>			// for std::memcpy, std::memcmp
+#include <filesystem>		// for std::filesystem
+#include <fstream>			// for std::ifstream, std::ofstream
+#include <future>			// for std::async, std::future
+#include <memory>			// for std::shared_ptr
+#include <string>			// for std::string
+#include <vector>			// for std::vector
+
+namespace svh {
+
+	/* Journal layout: "SVHJ", version, 3 reserved bytes, then frames. */
+	/* Frame: kind, 3 reserved bytes, payload length, checksum of the payload, MessagePack payload */
+	constexpr char JOURNAL_MAGIC[] = { 'S', 'V', 'H', 'J' };
+	constexpr std::uint8_t JOURNAL_VERSION = 1;
+	constexpr std::size_t JOURNAL_HEADER_SIZE = 8;
+	constexpr std::size_t JOURNAL_FRAME_SIZE = 16;
+
+	enum class JournalFrame : std::uint8_t { Delta = 1, Checkpoint = 2 };
+
+	/* Persists a value as a checkpoint followed by the Compare::GetChanges deltas recorded after it. */
+	/* A record only appends its delta, and every checkpoint_interval records the journal is compacted in the background: */
+	/* a copy of the value is written as the checkpoint of a new file, the records made meanwhile are appended to it, */
+	/* and it replaces the old file. A torn or corrupt frame at the end, left by a crash, is cut off when the journal is opened. */
+	/* Frames are handed to the operating system every flush_interval records (0 = only on Flush and Close), */
+	/* so a crash of the process loses at most the records since the last flush */
+	template<typename T>
+	class PatchJournal {
+	public:
+		explicit PatchJournal(std::string path, std::size_t checkpoint_interval = 1024, std::size_t flush_interval = 1)
+			: path(std::move(path)), interval(checkpoint_interval), flush_interval(flush_interval) {
+		}
+
+		~PatchJournal() {
+			Close();
+		}
+
+		PatchJournal(const PatchJournal&) = delete;
+		PatchJournal& operator=(const PatchJournal&) = delete;
+
+		/* Replays an existing journal into value, or starts a new one with value as its checkpoint. */
+		/* Returns false if the file can not be read or written */
+		bool Open(T& value) {
+			Close();
+			records = 0;
+			std::error_code error;
+			if (std::filesystem::exists(path, error)) {
+				std::uint64_t valid = 0;
+				if (!Replay(path, value, valid, records)) {
+					return false;
+				}
+				if (valid < std::filesystem::file_size(path, error)) {
+					std::filesystem::resize_file(path, valid, error);
+					if (error) {
+						return false;
+					}
+				}
+				state = value;
+			} else {
+				state = value;
+				if (!WriteCheckpoint(path, Serializer::ToJson(state))) {
+					return false;
+				}
+			}
+			file.open(path, std::ios::binary | std::ios::app);
+			return static_cast<bool>(file);
+		}
+
+		/* Appends the changes from the last recorded value to value, returns false if nothing changed */
+		bool Record(const T& value) {
+			json delta = Compare::GetChanges(state, value);
+			if (delta.is_null()) {
+				return false;
+			}
+			Append(delta);
+			return true;
+		}
+
+		/* Appends a delta made by Compare::GetChanges and applies it to the journal's copy of the value */
+		void Append(const json& delta) {
+			Overwrite::FromJson(delta, state);
+			std::string frame = EncodeFrame(JournalFrame::Delta, delta);
+			file.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+			++records;
+			if (flush_interval != 0 && ++unflushed >= flush_interval) {
+				Flush();
+			}
+			if (compaction.valid()) {
+				pending.push_back(std::move(frame));
+				if (compaction.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+					FinishCompaction();
+				}
+			} else if (interval != 0 && records >= interval) {
+				Compact();
+			}
+		}
+
+		/* Starts a compaction now, does nothing if one is running */
+		void Compact() {
+			if (compaction.valid() || !file.is_open()) {
+				return;
+			}
+			/* The copy is the only part that runs on the caller's thread */
+			auto snapshot = std::make_shared<const T>(state);
+			compaction = std::async(std::launch::async, [snapshot, target = CompactPath()] {
+				return WriteCheckpoint(target, Serializer::ToJson(*snapshot));
+			});
+		}
+
+		/* Blocks until a running compaction has replaced the file */
+		void WaitForCompaction() {
+			if (compaction.valid()) {
+				compaction.wait();
+				FinishCompaction();
+			}
+		}
+
+		void Flush() {
+			file.flush();
+			unflushed = 0;
+		}
+
+		void Close() {
+			WaitForCompaction();
+			if (file.is_open()) {
+				file.close();
+			}
+		}
+
+		/* The value as of the last record */
+		const T& Value() const {
+			return state;
+		}
+
+		/* Records since the last checkpoint */
+		std::size_t RecordCount() const {
+			return records;
+		}
+
+		std::size_t CompactionCount() const {
+			return compactions;
+		}
+
+		bool Good() const {
+			return static_cast<bool>(file);
+		}
+
+		/* Rebuilds value from the last checkpoint in the journal and the deltas after it. */
+		/* Stops at the first frame that is torn or fails its checksum, returns false if there is no valid checkpoint */
+		static bool Load(const std::string& path, T& value) {
+			std::uint64_t valid = 0;
+			std::size_t deltas = 0;
+			return Replay(path, value, valid, deltas);
+		}
+
+	private:
+		std::string path;
+		std::size_t interval;
+		std::size_t flush_interval;
+		/* Records written since the last flush */
+		std::size_t unflushed = 0;
+		T state{};
+		std::ofstream file;
+		std::size_t records = 0;
+		std::size_t compactions = 0;
+		std::future<bool> compaction;
+		/* Frames appended while the compaction runs, copied into the new file when it is done */
+		std::vector<std::string> pending;
+
+		std::string CompactPath() const {
+			return path + ".compact";
+		}
+
+		void FinishCompaction() {
+			const bool written = compaction.get();
+			std::vector<std::string> frames = std::move(pending);
+			pending.clear();
+			if (!written) {
+				return;
+			}
+			{
+				std::ofstream target(CompactPath(), std::ios::binary | std::ios::app);
+				for (const auto& frame : frames) {
+					target.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+				}
+				if (!target.flush()) {
+					return;
+				}
+			}
+			file.close();
+			std::error_code error;
+			std::filesystem::rename(CompactPath(), path, error);
+			file.open(path, std::ios::binary | std::ios::app);
+			if (!error) {
+				records = frames.size();
+				++compactions;
+			}
+		}
+
+		static std::string EncodeFrame(JournalFrame kind, const json& j) {
+			std::string payload;
+			json::to_msgpack(j, payload);
+			const std::uint32_t length = static_cast<std::uint32_t>(payload.size());
+			const std::uint64_t checksum = HashContent(payload);
+			std::string frame(JOURNAL_FRAME_SIZE, '\0');
+			frame[0] = static_cast<char>(kind);
+			std::memcpy(&frame[4], &length, sizeof(length));
+			std::memcpy(&frame[8], &checksum, sizeof(checksum));
+			return frame + payload;
+		}
+
+		static bool WriteCheckpoint(const std::string& target, const json& j) {
+			std::ofstream out(target, std::ios::binary | std::ios::trunc);
+			const char header[JOURNAL_HEADER_SIZE] = { JOURNAL_MAGIC[0], JOURNAL_MAGIC[1], JOURNAL_MAGIC[2], JOURNAL_MAGIC[3], static_cast<char>(JOURNAL_VERSION) };
+			out.write(header, sizeof(header));
+			std::string frame = EncodeFrame(JournalFrame::Checkpoint, j);
+			out.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+			return static_cast<bool>(out.flush());
+		}
+
+		/* valid is set to the end of the last intact frame, deltas to the number of deltas after the last checkpoint */
+		static bool Replay(const std::string& source, T& value, std::uint64_t& valid, std::size_t& deltas) {
+			std::ifstream in(source, std::ios::binary | std::ios::ate);
+			const std::uint64_t size = in ? static_cast<std::uint64_t>(in.tellg()) : 0;
+			in.seekg(0);
+			char header[JOURNAL_HEADER_SIZE];
+			if (!in.read(header, sizeof(header)) || std::memcmp(header, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 ||
+				static_cast<std::uint8_t>(header[4]) != JOURNAL_VERSION) {
+				return false;
+			}
+			std::uint64_t end = JOURNAL_HEADER_SIZE;
+			bool checkpoint = false;
+			std::string payload;
+			char frame[JOURNAL_FRAME_SIZE];
+			while (in.read(frame, sizeof(frame))) {
+				const auto kind = static_cast<JournalFrame>(frame[0]);
+				std::uint32_t length = 0;
+				std::uint64_t checksum = 0;
+				std::memcpy(&length, frame + 4, sizeof(length));
+				std::memcpy(&checksum, frame + 8, sizeof(checksum));
+				if (kind != JournalFrame::Delta && kind != JournalFrame::Checkpoint) {
+					break;
+				}
+				/* A corrupt length in the torn tail must not allocate, the frame has to fit in the file */
+				if (length > size - end - JOURNAL_FRAME_SIZE) {
+					break;
+				}
+				payload.resize(length);
+				if (!in.read(&payload[0], length) || HashContent(payload) != checksum) {
+					break;
+				}
+				json j = json::from_msgpack(payload, true, false);
+				if (j.is_discarded()) {
+					break;
+				}
+				if (kind == JournalFrame::Checkpoint) {
+					value = T{};
+					Deserializer::FromJson(j, value);
+					checkpoint = true;
+					deltas = 0;
+				} else if (checkpoint) {
+					Overwrite::FromJson(j, value);
+					++deltas;
+				}
+				end += JOURNAL_FRAME_SIZE + length;
+			}
+			valid = end;
+			return checkpoint;
+		}
+	};
+}
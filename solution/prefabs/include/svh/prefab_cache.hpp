@@ -0,0 +1,210 @@
+#pragma once
+#include "svh/serializer.hpp"
+#include "svh/patch.hpp"
+#include "svh/cooked.hpp"
+#include "svh/binary.hpp"
+
+#include <atomic>			// for std::atomic
+#include <cstddef>			// for std::size_t
+#include <cstdint>			// for std::uint64_t
+#include <fstream>			// for std::ifstream
+#include <memory>			// for std::shared_ptr, std::unique_ptr
+#include <mutex>			// for std::unique_lock
+#include <shared_mutex>		// for std::shared_mutex, std::shared_lock
+#include <sstream>			// for std::stringstream
+#include <string>			// for std::string
+#include <unordered_map>	// for std::unordered_map
+#include <vector>			// for std::vector
+
+namespace svh {
+
+	struct PrefabCacheStats {
+		std::size_t hits = 0;
+		std::size_t misses = 0;
+		std::size_t evictions = 0;
+	};
+
+	/* Parsed and deserialized prefabs by path, bounded by a memory budget. */
+	/* An entry is only served for the content it was parsed from, a file that changed is parsed again. */
+	/* Eviction uses the CLOCK algorithm: a hit marks the entry, the hand clears marks and evicts the first unmarked entry. */
+	/* Hits only take a shared lock, any number of threads can read at the same time */
+	template<typename T>
+	class PrefabCache {
+	public:
+		explicit PrefabCache(std::size_t memory_budget) : budget(memory_budget) {}
+
+		/* Reads path and returns the cached prefab for its content, null if the file can not be read or parsed */
+		std::shared_ptr<const T> Load(const std::string& path) {
+			std::ifstream file(path, std::ios::binary);
+			if (!file) {
+				Deserializer::HandleError("prefab file", json(path));
+				return nullptr;
+			}
+			std::stringstream buffer;
+			buffer << file.rdbuf();
+			return Get(path, buffer.str());
+		}
+
+		/* Same as above for content that was already read */
+		std::shared_ptr<const T> Get(const std::string& path, const std::string& content) {
+			const std::uint64_t hash = HashContent(content);
+			{
+				std::shared_lock<std::shared_mutex> lock(mutex);
+				auto it = index.find(path);
+				if (it != index.end() && slots[it->second]->hash == hash) {
+					Slot& slot = *slots[it->second];
+					slot.referenced.store(true, std::memory_order_relaxed);
+					hits.fetch_add(1, std::memory_order_relaxed);
+					return slot.value;
+				}
+			}
+			misses.fetch_add(1, std::memory_order_relaxed);
+
+			/* Parsed without the lock, two threads missing the same file both parse it */
+			auto value = std::make_shared<T>();
+			std::size_t bytes = sizeof(T);
+			if (IsBinary(content)) {
+				if (!Binary::Read(content, *value)) {
+					return nullptr;
+				}
+				bytes += content.size();
+			} else {
+				json j;
+				if (!ParsePrefabContent(content, j)) {
+					Deserializer::HandleError("prefab file", json(path));
+					return nullptr;
+				}
+				Deserializer::FromJson(j, *value);
+				bytes += EstimateSize(j);
+			}
+
+			std::unique_lock<std::shared_mutex> lock(mutex);
+			Insert(path, hash, value, bytes);
+			return value;
+		}
+
+		bool Contains(const std::string& path) const {
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			return index.find(path) != index.end();
+		}
+
+		/* Drops the entry of path, returns false if it was not cached */
+		bool Remove(const std::string& path) {
+			std::unique_lock<std::shared_mutex> lock(mutex);
+			auto it = index.find(path);
+			if (it == index.end()) {
+				return false;
+			}
+			Release(it->second);
+			return true;
+		}
+
+		void Clear() {
+			std::unique_lock<std::shared_mutex> lock(mutex);
+			index.clear();
+			slots.clear();
+			free_slots.clear();
+			usage = 0;
+			hand = 0;
+		}
+
+		PrefabCacheStats Stats() const {
+			PrefabCacheStats stats;
+			stats.hits = hits.load(std::memory_order_relaxed);
+			stats.misses = misses.load(std::memory_order_relaxed);
+			stats.evictions = evictions.load(std::memory_order_relaxed);
+			return stats;
+		}
+
+		std::size_t Size() const {
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			return index.size();
+		}
+
+		std::size_t MemoryUsage() const {
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			return usage;
+		}
+
+		std::size_t MemoryBudget() const {
+			return budget;
+		}
+
+	private:
+		struct Slot {
+			std::string path;
+			std::uint64_t hash = 0;
+			/* Handed out to callers, an evicted prefab lives until they release it */
+			std::shared_ptr<const T> value;
+			std::size_t bytes = 0;
+			/* Set by hits under the shared lock, cleared by the clock hand */
+			std::atomic<bool> referenced{ false };
+		};
+
+		mutable std::shared_mutex mutex;
+		std::unordered_map<std::string, std::size_t> index;
+		/* Null slots are free, their positions are in free_slots */
+		std::vector<std::unique_ptr<Slot>> slots;
+		std::vector<std::size_t> free_slots;
+		std::size_t hand = 0;
+		std::size_t usage = 0;
+		std::size_t budget;
+
+		std::atomic<std::size_t> hits{ 0 };
+		std::atomic<std::size_t> misses{ 0 };
+		std::atomic<std::size_t> evictions{ 0 };
+
+		/* Called with the exclusive lock */
+		void Insert(const std::string& path, std::uint64_t hash, std::shared_ptr<const T> value, std::size_t bytes) {
+			auto it = index.find(path);
+			if (it != index.end()) {
+				/* Older content of the same file, or another thread was first */
+				Release(it->second);
+			}
+			std::size_t position;
+			if (free_slots.empty()) {
+				position = slots.size();
+				slots.emplace_back();
+			} else {
+				position = free_slots.back();
+				free_slots.pop_back();
+			}
+			auto slot = std::make_unique<Slot>();
+			slot->path = path;
+			slot->hash = hash;
+			slot->value = std::move(value);
+			slot->bytes = bytes;
+			slots[position] = std::move(slot);
+			index[path] = position;
+			usage += bytes;
+			Evict(position);
+		}
+
+		/* Advances the clock hand until the usage fits, keeps the new entry even if it alone is over budget */
+		void Evict(std::size_t keep) {
+			while (usage > budget && index.size() > 1) {
+				if (hand >= slots.size()) {
+					hand = 0;
+				}
+				const std::size_t position = hand++;
+				Slot* slot = slots[position].get();
+				if (slot == nullptr || position == keep) {
+					continue;
+				}
+				if (slot->referenced.exchange(false, std::memory_order_relaxed)) {
+					continue;
+				}
+				Release(position);
+				evictions.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		void Release(std::size_t position) {
+			Slot& slot = *slots[position];
+			usage -= slot.bytes;
+			index.erase(slot.path);
+			slots[position].reset();
+			free_slots.push_back(position);
+		}
+	};
+}
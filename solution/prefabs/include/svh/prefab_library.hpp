@@ -0,0 +1,287 @@
+#pragma once
+#include "svh/serializer.hpp"
+#include "svh/std_types.hpp"
+#include "svh/cow_instance.hpp"
+#include "svh/parallel.hpp"
+
+#include <algorithm>		// for std::find, std::max
+#include <memory>			// for std::shared_ptr
+#include <optional>			// for std::optional
+#include <string>			// for std::string
+#include <thread>			// for std::thread
+#include <unordered_map>	// for std::unordered_map
+#include <unordered_set>	// for std::unordered_set
+#include <vector>			// for std::vector
+
+namespace svh {
+
+	/* Owns prefabs by id. A prefab is either a base object or a parent prefab plus an override patch. */
+	/* The resolved object is cached per prefab, so spawning is a copy instead of a json round trip. */
+	/* Parents and their dependents form a graph, a change only clears the prefabs that derive from it. */
+	/* Not thread safe, resolving fills the cache */
+	template<typename T, typename Id = std::string>
+	class PrefabLibrary {
+	public:
+		/* Adds or replaces a base object */
+		void SetBase(const Id& id, T base) {
+			Entry& entry = entries[id];
+			Unlink(id, entry);
+			entry.base = std::move(base);
+			entry.patch = json();
+			Invalidate(id);
+		}
+
+		/* Adds or replaces a base object from its serialized json */
+		void SetBaseJson(const Id& id, const json& j) {
+			T base{};
+			Deserializer::FromJson(j, base);
+			SetBase(id, std::move(base));
+		}
+
+		/* Adds or replaces a prefab that applies patch on top of parent. */
+		/* A parent that is id itself or derives from id would form a cycle, it is reported and nothing changes */
+		void SetOverride(const Id& id, const Id& parent, json patch) {
+			if (DerivesFrom(parent, id)) {
+				Deserializer::HandleError("prefab parent cycle", Serializer::ToJson(id));
+				return;
+			}
+			Entry& entry = entries[id];
+			Unlink(id, entry);
+			entry.base.reset();
+			entry.parent = parent;
+			entry.patch = std::move(patch);
+			dependents[parent].push_back(id);
+			Invalidate(id);
+		}
+
+		/* Prefabs that derive from id keep pointing to it, they resolve again once it is added back */
+		bool Remove(const Id& id) {
+			auto it = entries.find(id);
+			if (it == entries.end()) {
+				return false;
+			}
+			Invalidate(id);
+			Unlink(id, it->second);
+			entries.erase(it);
+			return true;
+		}
+
+		bool Contains(const Id& id) const {
+			return entries.find(id) != entries.end();
+		}
+
+		/* The fully resolved prefab, computed once and then served from the cache */
+		const T& Resolve(const Id& id) {
+			auto it = entries.find(id);
+			if (it == entries.end()) {
+				Deserializer::HandleError("prefab", Serializer::ToJson(id));
+				return Empty();
+			}
+			Entry& entry = it->second;
+			if (entry.resolved) {
+				return *entry.resolved;
+			}
+			if (entry.base) {
+				entry.resolved = std::make_shared<const T>(*entry.base);
+				return *entry.resolved;
+			}
+			if (entry.resolving) {
+				Deserializer::HandleError("prefab parent cycle", Serializer::ToJson(id));
+				return Empty();
+			}
+			entry.resolving = true;
+			T resolved{};
+			try {
+				resolved = Apply(Resolve(*entry.parent), entry.patch);
+			} catch (...) {
+				entry.resolving = false;
+				throw;
+			}
+			entry.resolving = false;
+			entry.resolved = std::make_shared<const T>(std::move(resolved));
+			return *entry.resolved;
+		}
+
+		/* Resolves every prefab that is not cached, parents before the prefabs that derive from them. */
+		/* Prefabs whose parents are resolved do not depend on each other and are split over worker threads (0 = hardware concurrency). */
+		/* Prefabs with a missing parent are skipped, Resolve reports them. Returns the number of prefabs resolved */
+		std::size_t ResolveAll(unsigned thread_count = 0) {
+			if (thread_count == 0) {
+				thread_count = std::max(1u, std::thread::hardware_concurrency());
+			}
+
+			/* First wave: unresolved prefabs whose parent is resolved, or that have no parent */
+			std::vector<std::pair<const Id*, Entry*>> wave;
+			for (auto& [id, entry] : entries) {
+				if (entry.resolved) {
+					continue;
+				}
+				if (entry.base) {
+					wave.push_back({ &id, &entry });
+					continue;
+				}
+				auto parent = entries.find(*entry.parent);
+				if (parent != entries.end() && parent->second.resolved) {
+					wave.push_back({ &id, &entry });
+				}
+			}
+
+			std::size_t count = 0;
+			while (!wave.empty()) {
+				ParallelFor(wave.size(), thread_count, [&](std::size_t i) {
+					Entry& entry = *wave[i].second;
+					if (entry.base) {
+						entry.resolved = std::make_shared<const T>(*entry.base);
+					} else {
+						entry.resolved = std::make_shared<const T>(Apply(*entries.find(*entry.parent)->second.resolved, entry.patch));
+					}
+				});
+				count += wave.size();
+
+				/* Next wave: the dependents of this one, their parent is resolved now */
+				std::vector<std::pair<const Id*, Entry*>> next;
+				for (auto& [id, entry] : wave) {
+					auto children = dependents.find(*id);
+					if (children == dependents.end()) {
+						continue;
+					}
+					for (const Id& child_id : children->second) {
+						auto child = entries.find(child_id);
+						if (child != entries.end() && !child->second.resolved) {
+							next.push_back({ &child->first, &child->second });
+						}
+					}
+				}
+				wave = std::move(next);
+			}
+			return count;
+		}
+
+		/* A new instance, copied from the resolved prefab. */
+		/* shared_ptr members point to the same object as the cached prefab, like any copy of T */
+		T Instantiate(const Id& id) {
+			return Resolve(id);
+		}
+
+		void Instantiate(const Id& id, std::size_t count, std::vector<T>& out) {
+			const T& prefab = Resolve(id);
+			out.insert(out.end(), count, prefab);
+		}
+
+		/* A new instance that shares every field with the resolved prefab until it is written. */
+		/* Invalidating the prefab does not change existing instances, they keep the old version */
+		CowInstance<T> InstantiateShared(const Id& id) {
+			Resolve(id);
+			auto it = entries.find(id);
+			if (it == entries.end() || !it->second.resolved) {
+				return CowInstance<T>();
+			}
+			return CowInstance<T>(it->second.resolved);
+		}
+
+		/* Drops the cached result of id and of every prefab that derives from it, directly or through other prefabs */
+		void Invalidate(const Id& id) {
+			std::vector<Id> stack{ id };
+			std::unordered_set<Id> visited;
+			while (!stack.empty()) {
+				Id current = std::move(stack.back());
+				stack.pop_back();
+				if (!visited.insert(current).second) {
+					continue;
+				}
+
+				auto it = entries.find(current);
+				if (it != entries.end()) {
+					/* A prefab is only cached after its parent, so nothing below an unresolved prefab is cached */
+					if (!it->second.resolved && !(current == id)) {
+						continue;
+					}
+					it->second.resolved.reset();
+				}
+				auto children = dependents.find(current);
+				if (children != dependents.end()) {
+					stack.insert(stack.end(), children->second.begin(), children->second.end());
+				}
+			}
+		}
+
+		/* Drops every cached result */
+		void Clear() {
+			for (auto& [id, entry] : entries) {
+				entry.resolved.reset();
+			}
+		}
+
+		bool IsCached(const Id& id) const {
+			auto it = entries.find(id);
+			return it != entries.end() && it->second.resolved != nullptr;
+		}
+
+	private:
+		struct Entry {
+			/* Set for base prefabs */
+			std::optional<T> base;
+			/* Set for override prefabs */
+			std::optional<Id> parent;
+			json patch;
+			/* Shared with the copy-on-write instances, they keep it alive after an invalidation */
+			std::shared_ptr<const T> resolved;
+			/* Guards against cycles in the parents */
+			bool resolving = false;
+		};
+
+		std::unordered_map<Id, Entry> entries;
+		/* Reverse edges, from a parent id to the prefabs that override it */
+		std::unordered_map<Id, std::vector<Id>> dependents;
+
+		/* True if id is ancestor or one of its parents, grandparents and so on */
+		bool DerivesFrom(const Id& id, const Id& ancestor) const {
+			const Id* current = &id;
+			/* Bounded by the number of prefabs in case the chain already loops */
+			for (std::size_t steps = 0; steps <= entries.size(); ++steps) {
+				if (*current == ancestor) {
+					return true;
+				}
+				auto it = entries.find(*current);
+				if (it == entries.end() || !it->second.parent) {
+					return false;
+				}
+				current = &*it->second.parent;
+			}
+			return false;
+		}
+
+		/* Removes id from the dependents of its current parent */
+		void Unlink(const Id& id, Entry& entry) {
+			if (!entry.parent) {
+				return;
+			}
+			auto children = dependents.find(*entry.parent);
+			if (children != dependents.end()) {
+				auto& list = children->second;
+				auto it = std::find(list.begin(), list.end(), id);
+				if (it != list.end()) {
+					list.erase(it);
+				}
+				if (list.empty()) {
+					dependents.erase(children);
+				}
+			}
+			entry.parent.reset();
+		}
+
+		/* Copied through json so the patch does not write into objects shared with the parent */
+		static T Apply(const T& parent, const json& patch) {
+			T resolved{};
+			Deserializer::FromJson(Serializer::ToJson(parent), resolved);
+			Overwrite::FromJson(patch, resolved);
+			return resolved;
+		}
+
+		/* Returned when errors do not throw */
+		static const T& Empty() {
+			static const T empty{};
+			return empty;
+		}
+	};
+}
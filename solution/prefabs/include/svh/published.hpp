@@ -0,0 +1,96 @@
+#pragma once
+#include "svh/serializer.hpp"
+
+#include <atomic>			// for std::atomic
+#include <cstddef>			// for std::size_t
+#include <cstdint>			// for std::uint64_t
+#include <memory>			// for std::shared_ptr
+#include <mutex>			// for std::mutex, std::lock_guard
+#include <thread>			// for std::this_thread::yield
+
+namespace svh {
+
+	/* Read-copy-update publication of an immutable value. */
+	/* Readers take a snapshot without locks and keep it as long as they like, a writer builds the next version on the side */
+	/* and swaps it in with one atomic store. A version is freed when the last snapshot of it is dropped */
+	template<typename T>
+	class Published {
+	public:
+		Published() : Published(std::make_shared<const T>()) {}
+		explicit Published(T value) : Published(std::make_shared<const T>(std::move(value))) {}
+		explicit Published(std::shared_ptr<const T> value) : current(new Version{ std::move(value) }) {}
+
+		~Published() {
+			delete current.load();
+		}
+
+		Published(const Published&) = delete;
+		Published& operator=(const Published&) = delete;
+
+		/* The latest published version. Lock-free: two atomic counter updates and a shared_ptr copy */
+		std::shared_ptr<const T> Read() const {
+			auto& counter = readers[phase.load() & 1];
+			counter.fetch_add(1);
+			/* The version can not be freed while the counter is raised */
+			std::shared_ptr<const T> snapshot = current.load()->value;
+			counter.fetch_sub(1);
+			return snapshot;
+		}
+
+		void Publish(T value) {
+			Publish(std::make_shared<const T>(std::move(value)));
+		}
+
+		/* Readers see either the previous or this version, never a partial one. Writers are serialized */
+		void Publish(std::shared_ptr<const T> value) {
+			std::lock_guard<std::mutex> lock(writer);
+			PublishLocked(std::move(value));
+		}
+
+		/* Copies the latest version, lets modify change the copy and publishes it */
+		template<typename Modify>
+		void Update(Modify&& modify) {
+			std::lock_guard<std::mutex> lock(writer);
+			T next = *current.load()->value;
+			modify(next);
+			PublishLocked(std::make_shared<const T>(std::move(next)));
+		}
+
+		/* Publishes the latest version with a Compare patch applied to it */
+		void Patch(const json& delta) {
+			Update([&](T& next) { Overwrite::FromJson(delta, next); });
+		}
+
+		/* Number of versions published after the first one */
+		std::uint64_t VersionCount() const {
+			return versions.load();
+		}
+
+	private:
+		/* Owned by Published, snapshots only share the value */
+		struct Version {
+			std::shared_ptr<const T> value;
+		};
+
+		std::atomic<Version*> current;
+		/* Readers inside Read, split by phase so a writer only waits for readers that started before it */
+		mutable std::atomic<std::size_t> readers[2] = { {0}, {0} };
+		std::atomic<std::uint64_t> phase{ 0 };
+		std::atomic<std::uint64_t> versions{ 0 };
+		std::mutex writer;
+
+		void PublishLocked(std::shared_ptr<const T> value) {
+			Version* previous = current.exchange(new Version{ std::move(value) });
+			versions.fetch_add(1);
+			/* Grace period: a reader may have picked its counter just before a phase flip, */
+			/* so both phases are flipped and drained before the previous version is deleted */
+			for (int flip = 0; flip < 2; ++flip) {
+				const std::uint64_t old_phase = phase.fetch_add(1);
+				while (readers[old_phase & 1].load() != 0) {
+					std::this_thread::yield();
+				}
+			}
+			delete previous;
+		}
+	};
+}
@@ -0,0 +1,513 @@
+#pragma once
+#include "svh/serializer.hpp"
+#include "svh/std_types.hpp"
+
+#include <algorithm>		// for std::clamp, std::min
+#include <array>			// for std::array
+#include <cmath>			// for std::llround
+#include <cstddef>			// for std::size_t
+#include <cstdint>			// for std::uint8_t, std::uint32_t, std::int64_t, std::uint64_t
+#include <cstring>			// for std::memcpy, std::memcmp
+#include <deque>			// for std::deque
+#include <iterator>			// for std::size
+#include <optional>			// for std::optional
+#include <string>			// for std::string
+#include <type_traits>		// for std::underlying_type_t
+#include <unordered_map>	// for std::unordered_map
+#include <utility>			// for std::index_sequence
+#include <vector>			// for std::vector
+
+namespace svh {
+
+	/* Specialize for a field to replicate it with fewer bits, for example */
+	/* template<> struct svh::replicated_field<&Unit::health> { static constexpr int bits = 7; static constexpr double min = 0, max = 100; }; */
+	/* Integers and enums are sent as bits wide offsets from min, floats as one of 2^bits - 1 steps from min to max. */
+	/* Values outside the range are clamped. It applies to every element of an array or vector field too */
+	template<auto Member>
+	struct replicated_field {
+		static constexpr int bits = 0;
+		static constexpr double min = 0;
+		static constexpr double max = 0;
+	};
+
+	/* Bit-packed deltas of T against a baseline, see ReplicationEncoder and ReplicationDecoder. */
+	/* Every field starts with a changed bit. Structs, arrays and vectors then hold their changed fields or elements, */
+	/* bools are one bit, integers zigzag varints of the difference to the baseline unless quantized, floats their */
+	/* raw bits unless quantized, strings a varint length and bytes. Other types, like maps, are sent as MessagePack */
+	class Replication {
+	public: /* Types */
+
+		struct Range {
+			int bits = 0;
+			double min = 0;
+			double max = 0;
+		};
+
+		class BitWriter {
+		public:
+			/* The low count bits of value, least significant first, filling each byte up before the next */
+			void Write(std::uint64_t value, int count) {
+				while (count > 0) {
+					if (bits % 8 == 0) bytes.push_back(0);
+					const int used = static_cast<int>(bits % 8);
+					const int take = std::min(8 - used, count);
+					bytes.back() |= static_cast<std::uint8_t>((value & ((1u << take) - 1)) << used);
+					value >>= take;
+					count -= take;
+					bits += take;
+				}
+			}
+
+			void Bit(bool value) {
+				Write(value ? 1 : 0, 1);
+			}
+
+			/* Groups of 7 bits, each followed by a bit that says if another group follows */
+			void Varint(std::uint64_t value) {
+				do {
+					Write(value & 0x7f, 7);
+					value >>= 7;
+					Bit(value != 0);
+				} while (value != 0);
+			}
+
+			std::size_t Position() const {
+				return bits;
+			}
+
+			/* Drops every bit written after position */
+			void Truncate(std::size_t position) {
+				bits = position;
+				bytes.resize((bits + 7) / 8);
+				if (bits % 8 != 0) bytes.back() &= static_cast<std::uint8_t>((1u << (bits % 8)) - 1);
+			}
+
+			std::vector<std::uint8_t> bytes;
+
+		private:
+			std::size_t bits = 0;
+		};
+
+		/* Bounds checked, a read past the end sets ok to false and returns zeros */
+		class BitReader {
+		public:
+			BitReader(const std::uint8_t* data, std::size_t size) : data(data), size(size) {}
+
+			std::uint64_t Read(int count) {
+				if (static_cast<std::size_t>(count) > Remaining()) {
+					ok = false;
+					bits = size * 8;
+					return 0;
+				}
+				std::uint64_t value = 0;
+				for (int shift = 0; shift < count;) {
+					const int used = static_cast<int>(bits % 8);
+					const int take = std::min(8 - used, count - shift);
+					value |= static_cast<std::uint64_t>((data[bits / 8] >> used) & ((1u << take) - 1)) << shift;
+					shift += take;
+					bits += take;
+				}
+				return value;
+			}
+
+			bool Bit() {
+				return Read(1) != 0;
+			}
+
+			std::uint64_t Varint() {
+				std::uint64_t value = 0;
+				for (int shift = 0; shift < 64 && ok; shift += 7) {
+					value |= Read(7) << shift;
+					if (!Bit()) return value;
+				}
+				ok = false;
+				return 0;
+			}
+
+			/* Bits left */
+			std::size_t Remaining() const {
+				return size * 8 - bits;
+			}
+
+			bool ok = true;
+
+		private:
+			const std::uint8_t* data;
+			std::size_t size;
+			std::size_t bits = 0;
+		};
+
+	public: /* API */
+
+		/* Writes the changes from base to value. Value is changed to what the receiver will decode: */
+		/* unchanged fields are set to base and quantized fields to their quantized value. Returns true if anything changed */
+		template<typename T>
+		static bool Encode(BitWriter& writer, const T& base, T& value, const Range& range = Range()) {
+			if constexpr (is_visitable_v<T>) {
+				return Composite(writer, [&] {
+					return EncodeFields(writer, base, value, std::make_index_sequence<visit_struct::field_count<T>()>{});
+				});
+			} else if constexpr (std::is_same_v<T, bool>) {
+				const bool changed = value != base;
+				writer.Bit(changed);
+				if (changed) writer.Bit(value);
+				return changed;
+			} else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+				const std::uint64_t current = Quantize(value, range);
+				const std::uint64_t previous = Quantize(base, range);
+				const bool changed = current != previous;
+				writer.Bit(changed);
+				if (!changed) {
+					value = base;
+				} else if (range.bits > 0) {
+					writer.Write(current, range.bits);
+					value = Dequantize<T>(current, range);
+				} else {
+					/* Wraps, the receiver adds it back onto the same baseline */
+					writer.Varint(ZigZag(static_cast<std::int64_t>(current - previous)));
+				}
+				return changed;
+			} else if constexpr (std::is_floating_point_v<T>) {
+				if (range.bits > 0) {
+					const std::uint64_t current = QuantizeFloat(value, range);
+					const bool changed = current != QuantizeFloat(base, range);
+					writer.Bit(changed);
+					if (changed) writer.Write(current, range.bits);
+					value = changed ? DequantizeFloat<T>(current, range) : base;
+					return changed;
+				}
+				const bool changed = std::memcmp(&value, &base, sizeof(T)) != 0;
+				writer.Bit(changed);
+				if (changed) writer.Write(RawBits(value), sizeof(T) * 8);
+				return changed;
+			} else if constexpr (is_string_v<T>) {
+				const bool changed = value != base;
+				writer.Bit(changed);
+				if (changed) {
+					writer.Varint(value.size());
+					for (char c : value) writer.Write(static_cast<unsigned char>(c), 8);
+				}
+				return changed;
+			} else if constexpr (std::is_array_v<T> || is_std_array_v<T>) {
+				return Composite(writer, [&] {
+					bool changed = false;
+					for (std::size_t i = 0; i < std::size(value); ++i) {
+						changed |= Encode(writer, base[i], value[i], range);
+					}
+					return changed;
+				});
+			} else if constexpr (is_resizable_v<T>) {
+				using E = typename T::value_type;
+				return Composite(writer, [&] {
+					writer.Varint(value.size());
+					bool changed = value.size() != base.size();
+					const E empty{};
+					for (std::size_t i = 0; i < value.size(); ++i) {
+						changed |= Encode(writer, i < base.size() ? base[i] : empty, value[i], range);
+					}
+					return changed;
+				});
+			} else {
+				const bool changed = !Compare::GetChanges(base, value).is_null();
+				writer.Bit(changed);
+				if (changed) {
+					const std::vector<std::uint8_t> packed = json::to_msgpack(Serializer::ToJson(value));
+					writer.Varint(packed.size());
+					for (std::uint8_t byte : packed) writer.Write(byte, 8);
+				}
+				return changed;
+			}
+		}
+
+		/* Applies changes written by Encode to value, which has to hold the same baseline. False if the data ran out */
+		template<typename T>
+		static bool Decode(BitReader& reader, T& value, const Range& range = Range()) {
+			if (!reader.Bit()) {
+				return reader.ok;
+			}
+			if constexpr (is_visitable_v<T>) {
+				DecodeFields(reader, value, std::make_index_sequence<visit_struct::field_count<T>()>{});
+			} else if constexpr (std::is_same_v<T, bool>) {
+				value = reader.Bit();
+			} else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+				if (range.bits > 0) {
+					value = Dequantize<T>(reader.Read(range.bits), range);
+				} else {
+					value = Dequantize<T>(Quantize(value, Range()) + static_cast<std::uint64_t>(UnZigZag(reader.Varint())), Range());
+				}
+			} else if constexpr (std::is_floating_point_v<T>) {
+				if (range.bits > 0) {
+					value = DequantizeFloat<T>(reader.Read(range.bits), range);
+				} else {
+					const std::uint64_t raw = reader.Read(sizeof(T) * 8);
+					std::memcpy(&value, &raw, sizeof(T));
+				}
+			} else if constexpr (is_string_v<T>) {
+				const std::uint64_t length = reader.Varint();
+				value.clear();
+				for (std::uint64_t i = 0; i < length && reader.ok; ++i) {
+					value.push_back(static_cast<char>(reader.Read(8)));
+				}
+			} else if constexpr (std::is_array_v<T> || is_std_array_v<T>) {
+				for (std::size_t i = 0; i < std::size(value) && reader.ok; ++i) {
+					Decode(reader, value[i], range);
+				}
+			} else if constexpr (is_resizable_v<T>) {
+				const std::uint64_t count = reader.Varint();
+				/* Every element takes at least one bit, a corrupt count can not allocate more than the packet */
+				if (!reader.ok || count > reader.Remaining()) {
+					reader.ok = false;
+					return false;
+				}
+				value.resize(static_cast<std::size_t>(count));
+				for (std::size_t i = 0; i < value.size() && reader.ok; ++i) {
+					Decode(reader, value[i], range);
+				}
+			} else {
+				const std::uint64_t length = reader.Varint();
+				if (!reader.ok || length > reader.Remaining()) {
+					reader.ok = false;
+					return false;
+				}
+				std::vector<std::uint8_t> packed(static_cast<std::size_t>(length));
+				for (auto& byte : packed) byte = static_cast<std::uint8_t>(reader.Read(8));
+				const json j = json::from_msgpack(packed, true, false);
+				if (j.is_discarded()) {
+					reader.ok = false;
+					return false;
+				}
+				value = T{};
+				Deserializer::FromJson(j, value);
+			}
+			return reader.ok;
+		}
+
+	private: /* Types */
+
+		/* vector<bool> has no references to its elements, it goes through MessagePack */
+		template<typename T>
+		static constexpr bool is_resizable_v = (is_std_vector_v<T> && !std::is_same_v<T, std::vector<bool>>) || is_specialization<T, std::deque>::value;
+
+	private: /* Helpers */
+
+		/* Writes a changed bit, then what write writes if it reports a change, otherwise takes both back and writes a zero */
+		template<typename Write>
+		static bool Composite(BitWriter& writer, Write&& write) {
+			const std::size_t mark = writer.Position();
+			writer.Bit(true);
+			if (write()) {
+				return true;
+			}
+			writer.Truncate(mark);
+			writer.Bit(false);
+			return false;
+		}
+
+		template<typename T, std::size_t... I>
+		static bool EncodeFields(BitWriter& writer, const T& base, T& value, std::index_sequence<I...>) {
+			bool changed = false;
+			((changed |= Encode(writer, visit_struct::get<I>(base), visit_struct::get<I>(value), FieldRange<T, I>())), ...);
+			return changed;
+		}
+
+		template<typename T, std::size_t... I>
+		static void DecodeFields(BitReader& reader, T& value, std::index_sequence<I...>) {
+			(Decode(reader, visit_struct::get<I>(value), FieldRange<T, I>()), ...);
+		}
+
+		template<typename T, std::size_t I>
+		static Range FieldRange() {
+			using Field = replicated_field<visit_struct::get_pointer<I, T>()>;
+			return Range{ Field::bits, Field::min, Field::max };
+		}
+
+		/* The integer as 64 bits, an offset from min when quantized */
+		template<typename T>
+		static std::uint64_t Quantize(T value, const Range& range) {
+			if constexpr (std::is_enum_v<T>) {
+				return Quantize(static_cast<std::underlying_type_t<T>>(value), range);
+			} else {
+				if (range.bits <= 0) {
+					return static_cast<std::uint64_t>(static_cast<std::int64_t>(value));
+				}
+				const std::int64_t low = static_cast<std::int64_t>(range.min);
+				const std::int64_t high = range.max > range.min ? static_cast<std::int64_t>(range.max) : static_cast<std::int64_t>(value);
+				const std::uint64_t offset = static_cast<std::uint64_t>(std::clamp(static_cast<std::int64_t>(value), low, std::max(low, high)) - low);
+				return range.bits >= 64 ? offset : std::min(offset, (std::uint64_t(1) << range.bits) - 1);
+			}
+		}
+
+		template<typename T>
+		static T Dequantize(std::uint64_t value, const Range& range) {
+			if constexpr (std::is_enum_v<T>) {
+				return static_cast<T>(Dequantize<std::underlying_type_t<T>>(value, range));
+			} else {
+				return static_cast<T>(static_cast<std::int64_t>(value) + (range.bits > 0 ? static_cast<std::int64_t>(range.min) : 0));
+			}
+		}
+
+		template<typename T>
+		static std::uint64_t QuantizeFloat(T value, const Range& range) {
+			const double steps = static_cast<double>((std::uint64_t(1) << range.bits) - 1);
+			const double span = range.max - range.min;
+			if (!(span > 0) || value != value) {
+				return 0;
+			}
+			const double clamped = std::clamp(static_cast<double>(value), range.min, range.max);
+			return static_cast<std::uint64_t>(std::llround((clamped - range.min) / span * steps));
+		}
+
+		template<typename T>
+		static T DequantizeFloat(std::uint64_t value, const Range& range) {
+			const double steps = static_cast<double>((std::uint64_t(1) << range.bits) - 1);
+			return static_cast<T>(range.min + static_cast<double>(value) * (range.max - range.min) / steps);
+		}
+
+		template<typename T>
+		static std::uint64_t RawBits(T value) {
+			std::uint64_t raw = 0;
+			std::memcpy(&raw, &value, sizeof(T));
+			return raw;
+		}
+
+		static std::uint64_t ZigZag(std::int64_t value) {
+			return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+		}
+
+		static std::int64_t UnZigZag(std::uint64_t value) {
+			return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+		}
+	};
+
+	/* Encodes T for many receivers, each against the newest state it acknowledged. */
+	/* What was sent is kept for the last history ticks per receiver. A receiver whose acknowledged tick is older */
+	/* than that, or who never acknowledged one, gets the full state as a delta against T{} */
+	template<typename T>
+	class ReplicationEncoder {
+	public:
+		explicit ReplicationEncoder(std::size_t history = 32) : history(history == 0 ? 1 : history) {}
+
+		/* Packet: 32 bit tick, a bit that says if there is a baseline, the distance back to it as a varint, then the delta */
+		std::vector<std::uint8_t> Encode(std::uint32_t receiver, std::uint32_t tick, const T& value) {
+			Receiver& state = receivers[receiver];
+			if (state.ring.empty()) {
+				state.ring.resize(history);
+			}
+			const Snapshot* base = state.acknowledged ? Find(state, *state.acknowledged) : nullptr;
+
+			Replication::BitWriter writer;
+			writer.Write(tick, 32);
+			writer.Bit(base != nullptr);
+			if (base != nullptr) {
+				writer.Varint(tick - base->tick);
+			}
+			Snapshot& slot = state.ring[tick % history];
+			/* The slot may hold the baseline itself, when history ticks passed since the acknowledgement */
+			T sent = value;
+			if (base != nullptr) {
+				Replication::Encode(writer, base->value, sent);
+			} else {
+				Replication::Encode(writer, T{}, sent);
+			}
+			slot.tick = tick;
+			slot.used = true;
+			slot.value = std::move(sent);
+			return std::move(writer.bytes);
+		}
+
+		/* The receiver decoded the packet of tick, later packets are encoded against it */
+		void Acknowledge(std::uint32_t receiver, std::uint32_t tick) {
+			auto it = receivers.find(receiver);
+			if (it == receivers.end() || Find(it->second, tick) == nullptr) {
+				return;
+			}
+			if (!it->second.acknowledged || static_cast<std::int32_t>(tick - *it->second.acknowledged) > 0) {
+				it->second.acknowledged = tick;
+			}
+		}
+
+		void RemoveReceiver(std::uint32_t receiver) {
+			receivers.erase(receiver);
+		}
+
+		std::size_t ReceiverCount() const {
+			return receivers.size();
+		}
+
+	private:
+		struct Snapshot {
+			std::uint32_t tick = 0;
+			bool used = false;
+			T value{};
+		};
+
+		struct Receiver {
+			std::vector<Snapshot> ring;
+			std::optional<std::uint32_t> acknowledged;
+		};
+
+		std::size_t history;
+		std::unordered_map<std::uint32_t, Receiver> receivers;
+
+		const Snapshot* Find(const Receiver& state, std::uint32_t tick) const {
+			const Snapshot& slot = state.ring[tick % history];
+			return slot.used && slot.tick == tick ? &slot : nullptr;
+		}
+	};
+
+	/* Decodes packets of ReplicationEncoder, keeping the states of the last history ticks as baselines */
+	template<typename T>
+	class ReplicationDecoder {
+	public:
+		explicit ReplicationDecoder(std::size_t history = 32) : history(history == 0 ? 1 : history), ring(this->history) {}
+
+		/* Sets value to the state of the packet and returns true, acknowledge LastTick to the sender after it. */
+		/* Returns false if the baseline of the packet is no longer known, which happens when packets arrive too late. */
+		/* A packet that is cut off or corrupt is reported through Deserializer::HandleError */
+		bool Decode(const std::uint8_t* data, std::size_t size, T& value) {
+			Replication::BitReader reader(data, size);
+			const std::uint32_t tick = static_cast<std::uint32_t>(reader.Read(32));
+			const bool has_base = reader.Bit();
+			T state{};
+			if (has_base) {
+				const std::uint32_t base_tick = tick - static_cast<std::uint32_t>(reader.Varint());
+				const Snapshot& base = ring[base_tick % history];
+				if (!reader.ok || !base.used || base.tick != base_tick) {
+					return false;
+				}
+				state = base.value;
+			}
+			if (!Replication::Decode(reader, state) || !reader.ok) {
+				Deserializer::HandleError("Truncated or corrupt replication packet", json(tick));
+				return false;
+			}
+			Snapshot& slot = ring[tick % history];
+			slot.tick = tick;
+			slot.used = true;
+			slot.value = state;
+			last = tick;
+			value = std::move(state);
+			return true;
+		}
+
+		bool Decode(const std::vector<std::uint8_t>& packet, T& value) {
+			return Decode(packet.data(), packet.size(), value);
+		}
+
+		/* Tick of the last decoded packet */
+		std::uint32_t LastTick() const {
+			return last;
+		}
+
+	private:
+		struct Snapshot {
+			std::uint32_t tick = 0;
+			bool used = false;
+			T value{};
+		};
+
+		std::size_t history;
+		std::vector<Snapshot> ring;
+		std::uint32_t last = 0;
+	};
+}
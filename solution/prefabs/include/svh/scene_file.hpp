@@ -0,0 +1,316 @@
+#pragma once
+#include "svh/serializer.hpp"
+#include "svh/binary.hpp"
+
+#include <algorithm>		// for std::all_of
+#include <cstdint>			// for std::uint8_t, std::uint32_t, std::uint64_t
+#include <cstring>			// for std::memcmp
+#include <fstream>			// for std::ifstream, std::ofstream
+#include <string>			// for std::string
+#include <unordered_map>	// for std::unordered_map
+#include <vector>			// for std::vector
+
+namespace svh {
+
+	/* Scene layout: header, one binary prefab per entity in the order they were added, index, trailer. */
+	/* Header: "SVHS", version, byte order, 2 reserved bytes. Trailer: index offset, index length, entity count, "SVHS" */
+	/* The index is MessagePack, so entities can be added in one pass without knowing how many there will be */
+	constexpr char SCENE_MAGIC[] = { 'S', 'V', 'H', 'S' };
+	constexpr std::uint8_t SCENE_VERSION = 1;
+	constexpr std::size_t SCENE_HEADER_SIZE = 8;
+	constexpr std::size_t SCENE_TRAILER_SIZE = 24;
+
+	/* Axis aligned box an entity occupies, for loading a region */
+	struct SceneBounds {
+		float min[3] = { 0, 0, 0 };
+		float max[3] = { 0, 0, 0 };
+
+		bool Overlaps(const SceneBounds& other) const {
+			for (int axis = 0; axis < 3; ++axis) {
+				if (max[axis] < other.min[axis] || other.max[axis] < min[axis]) {
+					return false;
+				}
+			}
+			return true;
+		}
+	};
+
+	/* Optional keys an entity can be looked up by besides its id */
+	struct SceneKeys {
+		std::vector<std::string> tags;
+		bool has_bounds = false;
+		SceneBounds bounds;
+	};
+
+	struct SceneEntry {
+		std::uint64_t offset = 0;
+		std::uint64_t length = 0;
+		std::uint64_t schema = 0;
+		SceneKeys keys;
+	};
+
+	/* Writes a scene file front to back. Every entity is written as soon as it is added, only the index is kept in memory */
+	class SceneWriter {
+	public:
+		SceneWriter() = default;
+
+		explicit SceneWriter(const std::string& path) {
+			Open(path);
+		}
+
+		/* Writes the index */
+		~SceneWriter() {
+			Close();
+		}
+
+		SceneWriter(const SceneWriter&) = delete;
+		SceneWriter& operator=(const SceneWriter&) = delete;
+
+		bool Open(const std::string& path) {
+			Close();
+			file.open(path, std::ios::binary | std::ios::trunc);
+			const std::uint8_t order = NativeByteOrder();
+			const std::uint16_t reserved = 0;
+			file.write(SCENE_MAGIC, sizeof(SCENE_MAGIC));
+			Put(SCENE_VERSION);
+			Put(order);
+			Put(reserved);
+			offset = SCENE_HEADER_SIZE;
+			return static_cast<bool>(file);
+		}
+
+		/* Adds an entity, an id that was already added is replaced in the index but stays in the file */
+		template<typename T>
+		void Add(const std::string& id, const T& value, SceneKeys keys = SceneKeys(), StringTable strings = StringTable::Keys) {
+			const std::vector<std::uint8_t> bytes = Binary::Write(value, strings);
+			file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+			index[id] = { offset, bytes.size(), Binary::SchemaHash<T>(), std::move(keys) };
+			offset += bytes.size();
+		}
+
+		/* Writes the index and the trailer, returns false if any write failed */
+		bool Close() {
+			if (!file.is_open()) {
+				return true;
+			}
+			/* An array, lookups in svh::json objects are linear */
+			json entries = json::array();
+			for (const auto& [id, entry] : index) {
+				json j = { { "id", id }, { "offset", entry.offset }, { "length", entry.length }, { "schema", entry.schema } };
+				if (!entry.keys.tags.empty()) {
+					j["tags"] = entry.keys.tags;
+				}
+				if (entry.keys.has_bounds) {
+					const auto& bounds = entry.keys.bounds;
+					j["bounds"] = { bounds.min[0], bounds.min[1], bounds.min[2], bounds.max[0], bounds.max[1], bounds.max[2] };
+				}
+				entries.push_back(std::move(j));
+			}
+			const std::vector<std::uint8_t> bytes = json::to_msgpack(entries);
+			file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+			const std::uint64_t index_offset = offset;
+			const std::uint64_t index_length = bytes.size();
+			const std::uint32_t count = static_cast<std::uint32_t>(index.size());
+			Put(index_offset);
+			Put(index_length);
+			Put(count);
+			file.write(SCENE_MAGIC, sizeof(SCENE_MAGIC));
+			const bool good = static_cast<bool>(file.flush());
+			file.close();
+			index.clear();
+			return good;
+		}
+
+		std::size_t Size() const {
+			return index.size();
+		}
+
+	private:
+		std::ofstream file;
+		std::uint64_t offset = 0;
+		std::unordered_map<std::string, SceneEntry> index;
+
+		template<typename T>
+		void Put(const T& value) {
+			file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+	};
+
+	/* Reads entities from a scene file by id, tag or region. */
+	/* Opening reads the header, the trailer and the index, a load then seeks to the entity and reads only its bytes */
+	class SceneFile {
+	public:
+		/* Returns false if the file can not be read or is not a scene */
+		bool Open(const std::string& path) {
+			Close();
+			file.open(path, std::ios::binary);
+			char header[SCENE_HEADER_SIZE];
+			if (!file.read(header, sizeof(header)) || std::memcmp(header, SCENE_MAGIC, sizeof(SCENE_MAGIC)) != 0 ||
+				static_cast<std::uint8_t>(header[4]) != SCENE_VERSION || static_cast<std::uint8_t>(header[5]) != NativeByteOrder()) {
+				Close();
+				return false;
+			}
+			file.seekg(0, std::ios::end);
+			const std::uint64_t size = static_cast<std::uint64_t>(file.tellg());
+			char trailer[SCENE_TRAILER_SIZE];
+			if (size < SCENE_HEADER_SIZE + SCENE_TRAILER_SIZE || !file.seekg(size - SCENE_TRAILER_SIZE) || !file.read(trailer, sizeof(trailer)) ||
+				std::memcmp(trailer + 20, SCENE_MAGIC, sizeof(SCENE_MAGIC)) != 0) {
+				Close();
+				return false;
+			}
+			std::uint64_t index_offset = 0, index_length = 0;
+			std::memcpy(&index_offset, trailer, sizeof(index_offset));
+			std::memcpy(&index_length, trailer + 8, sizeof(index_length));
+			if (index_offset > size || index_length > size - SCENE_TRAILER_SIZE - index_offset) {
+				Close();
+				return false;
+			}
+			buffer.resize(static_cast<std::size_t>(index_length));
+			file.seekg(static_cast<std::streamoff>(index_offset));
+			if (!file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()))) {
+				Close();
+				return false;
+			}
+			json entries = json::from_msgpack(buffer, true, false);
+			if (!entries.is_array()) {
+				Close();
+				return false;
+			}
+			index.reserve(entries.size());
+			for (const auto& j : entries) {
+				/* Entries with fields of the wrong type are skipped like the ones out of range */
+				if (!j.is_object() || !j.contains("id") || !j["id"].is_string()) {
+					continue;
+				}
+				SceneEntry entry;
+				if (!ReadUnsigned(j, "offset", entry.offset) || !ReadUnsigned(j, "length", entry.length) || !ReadUnsigned(j, "schema", entry.schema)) {
+					continue;
+				}
+				if (entry.offset > index_offset || entry.length > index_offset - entry.offset) {
+					continue;
+				}
+				if (j.contains("tags")) {
+					const json& tags = j["tags"];
+					if (!tags.is_array() || !std::all_of(tags.begin(), tags.end(), [](const json& tag) { return tag.is_string(); })) {
+						continue;
+					}
+					entry.keys.tags = tags.get<std::vector<std::string>>();
+				}
+				if (j.contains("bounds")) {
+					const json& bounds = j["bounds"];
+					if (!bounds.is_array() || !std::all_of(bounds.begin(), bounds.end(), [](const json& value) { return value.is_number(); })) {
+						continue;
+					}
+					if (bounds.size() == 6) {
+						entry.keys.has_bounds = true;
+						for (int axis = 0; axis < 3; ++axis) {
+							entry.keys.bounds.min[axis] = bounds[axis].get<float>();
+							entry.keys.bounds.max[axis] = bounds[axis + 3].get<float>();
+						}
+					}
+				}
+				index.emplace(j["id"].get<std::string>(), std::move(entry));
+			}
+			return true;
+		}
+
+		void Close() {
+			file.close();
+			file.clear();
+			index.clear();
+			buffer.clear();
+		}
+
+		bool IsOpen() const {
+			return file.is_open();
+		}
+
+		std::size_t Size() const {
+			return index.size();
+		}
+
+		bool Contains(const std::string& id) const {
+			return index.find(id) != index.end();
+		}
+
+		/* Null if there is no such entity */
+		const SceneEntry* Find(const std::string& id) const {
+			auto it = index.find(id);
+			return it == index.end() ? nullptr : &it->second;
+		}
+
+		/* Reads and deserializes only the entity of id. Returns false if there is no such entity, */
+		/* an entity written from another type is reported through Deserializer::HandleError */
+		template<typename T>
+		bool LoadEntity(const std::string& id, T& value) {
+			const SceneEntry* entry = Find(id);
+			if (entry == nullptr) {
+				return false;
+			}
+			if (entry->schema != Binary::SchemaHash<T>()) {
+				Deserializer::HandleError("Scene entity schema does not match the type", json(id));
+				return false;
+			}
+			/* The buffer is reused, it grows to the largest entity loaded */
+			buffer.resize(static_cast<std::size_t>(entry->length));
+			file.clear();
+			if (!file.seekg(static_cast<std::streamoff>(entry->offset)) ||
+				!file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()))) {
+				return false;
+			}
+			return Binary::Read(buffer.data(), buffer.size(), value);
+		}
+
+		std::vector<std::string> Ids() const {
+			std::vector<std::string> ids;
+			ids.reserve(index.size());
+			for (const auto& item : index) {
+				ids.push_back(item.first);
+			}
+			return ids;
+		}
+
+		std::vector<std::string> IdsWithTag(const std::string& tag) const {
+			std::vector<std::string> ids;
+			for (const auto& [id, entry] : index) {
+				for (const auto& other : entry.keys.tags) {
+					if (other == tag) {
+						ids.push_back(id);
+						break;
+					}
+				}
+			}
+			return ids;
+		}
+
+		/* Entities whose bounds overlap region, entities without bounds are never included */
+		std::vector<std::string> IdsInRegion(const SceneBounds& region) const {
+			std::vector<std::string> ids;
+			for (const auto& [id, entry] : index) {
+				if (entry.keys.has_bounds && entry.keys.bounds.Overlaps(region)) {
+					ids.push_back(id);
+				}
+			}
+			return ids;
+		}
+
+	private:
+		std::ifstream file;
+		std::unordered_map<std::string, SceneEntry> index;
+		std::vector<std::uint8_t> buffer;
+
+		/* A missing field reads as 0, false if it is not an unsigned number */
+		static bool ReadUnsigned(const json& j, const char* key, std::uint64_t& out) {
+			auto it = j.find(key);
+			if (it == j.end()) {
+				out = 0;
+				return true;
+			}
+			if (!it->is_number_unsigned()) {
+				return false;
+			}
+			out = it->get<std::uint64_t>();
+			return true;
+		}
+	};
+}
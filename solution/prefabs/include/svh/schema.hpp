@@ -0,0 +1,194 @@
+#pragma once
+#include "svh/serializer.hpp"
+#include "svh/binary.hpp"
+
+#include <cstdint>			// for std::uint64_t
+#include <cstdio>			// for std::snprintf
+#include <fstream>			// for std::ifstream, std::ofstream
+#include <functional>		// for std::function
+#include <string>			// for std::string, std::stoull
+#include <unordered_map>	// for std::unordered_map
+#include <utility>			// for std::pair
+
+namespace svh {
+
+	/* Key of the schema fingerprint in documents written by Schema::ToJson */
+	constexpr char SCHEMA_KEY[] = "$schema";
+
+	/* Steps that upgrade documents from one schema fingerprint to another. */
+	/* A document is upgraded by following the steps from its fingerprint until the target, */
+	/* documents without a fingerprint, written before they were added, start at fingerprint 0 */
+	class Migrations {
+	public:
+		using Step = std::function<void(json&)>;
+
+		/* Used by Schema::FromJson when no registry is given. Register steps before loading on other threads */
+		static Migrations& Default() {
+			static Migrations migrations;
+			return migrations;
+		}
+
+		/* Registers the step from documents with fingerprint from to documents with fingerprint to, */
+		/* for example Add(Schema::Fingerprint<UnitV1>(), Schema::Fingerprint<Unit>(), Migrations::Rename("hp", "health")) */
+		void Add(std::uint64_t from, std::uint64_t to, Step step) {
+			steps[from] = { to, std::move(step) };
+		}
+
+		bool Empty() const {
+			return steps.empty();
+		}
+
+		/* True if there are steps from fingerprint to target */
+		bool CanUpgrade(std::uint64_t fingerprint, std::uint64_t target) const {
+			for (std::size_t i = 0; i <= steps.size() && fingerprint != target; ++i) {
+				auto it = steps.find(fingerprint);
+				if (it == steps.end()) {
+					return false;
+				}
+				fingerprint = it->second.first;
+			}
+			return fingerprint == target;
+		}
+
+		/* Runs the steps from the document's fingerprint to target and stores target in it. */
+		/* Returns false and leaves the document as it is if there is no path */
+		bool Upgrade(json& document, std::uint64_t target) const {
+			const std::uint64_t fingerprint = ReadFingerprint(document);
+			if (!document.is_object() || !CanUpgrade(fingerprint, target)) {
+				return false;
+			}
+			for (std::uint64_t at = fingerprint; at != target;) {
+				const auto& step = steps.at(at);
+				step.second(document);
+				at = step.first;
+			}
+			WriteFingerprint(document, target);
+			return true;
+		}
+
+		/* Upgrades the json prefab at path in place. Returns false if it can not be read, has no path to target or can not be written */
+		bool UpgradeFile(const std::string& path, std::uint64_t target) const {
+			json document;
+			{
+				std::ifstream file(path);
+				document = json::parse(file, nullptr, false);
+			}
+			if (document.is_discarded() || !Upgrade(document, target)) {
+				return false;
+			}
+			std::ofstream file(path, std::ios::trunc);
+			file << document.dump(1, '\t');
+			return static_cast<bool>(file);
+		}
+
+		/* Step that renames a field of the object at parent, a json pointer like "" or "/stats" */
+		static Step Rename(std::string from, std::string to, std::string parent = "") {
+			return [from = std::move(from), to = std::move(to), parent = json::json_pointer(parent)](json& document) {
+				if (!document.contains(parent)) {
+					return;
+				}
+				json& object = document[parent];
+				auto it = object.is_object() ? object.find(from) : object.end();
+				if (it != object.end()) {
+					json value = std::move(it.value());
+					object.erase(it);
+					object[to] = std::move(value);
+				}
+			};
+		}
+
+		static Step Remove(std::string name, std::string parent = "") {
+			return [name = std::move(name), parent = json::json_pointer(parent)](json& document) {
+				if (document.contains(parent) && document[parent].is_object()) {
+					document[parent].erase(name);
+				}
+			};
+		}
+
+		/* Step that sets a field that is missing, for fields whose default in the struct is not what old data meant */
+		static Step AddField(std::string name, json value, std::string parent = "") {
+			return [name = std::move(name), value = std::move(value), parent = json::json_pointer(parent)](json& document) {
+				if (document.contains(parent) && document[parent].is_object() && !document[parent].contains(name)) {
+					document[parent][name] = value;
+				}
+			};
+		}
+
+		/* Fingerprint stored in document, 0 if it has none */
+		static std::uint64_t ReadFingerprint(const json& document) {
+			if (!document.is_object()) {
+				return 0;
+			}
+			auto it = document.find(SCHEMA_KEY);
+			if (it == document.end() || !it->is_string()) {
+				return 0;
+			}
+			try {
+				return std::stoull(it->get<std::string>(), nullptr, 16);
+			} catch (const std::exception&) {
+				return 0;
+			}
+		}
+
+		/* Stored as hex text, json readers that use doubles would round a 64 bit number */
+		static void WriteFingerprint(json& document, std::uint64_t fingerprint) {
+			char text[17];
+			std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(fingerprint));
+			document[SCHEMA_KEY] = text;
+		}
+
+	private:
+		std::unordered_map<std::uint64_t, std::pair<std::uint64_t, Step>> steps;
+	};
+
+	/* Documents that carry the schema fingerprint of the type they were written from */
+	class Schema {
+	public:
+		/* Compile time hash of the field names and types of T and everything in it, the same as Binary::SchemaHash */
+		template<typename T>
+		static constexpr std::uint64_t Fingerprint() {
+			return Binary::SchemaHash<T>();
+		}
+
+		/* Serializer::ToJson with the fingerprint of T as the first key */
+		template<typename T>
+		static json ToJson(const T& value) {
+			static_assert(is_visitable_v<T>, "Schema documents need a visitable struct");
+			json fields = Serializer::ToJson(value);
+			json document = json::object();
+			Migrations::WriteFingerprint(document, Fingerprint<T>());
+			for (auto& item : fields.items()) {
+				document[item.key()] = std::move(item.value());
+			}
+			return document;
+		}
+
+		/* Deserializes a document into value. A document with the fingerprint of T is read as it is, */
+		/* its keys are in field order so no field is searched for. Any other document is copied and upgraded */
+		/* with migrations once before it is read. Returns false if there is no path from its fingerprint to T, */
+		/* the document is then read by field name like Deserializer::FromJson. A document without a fingerprint */
+		/* only counts as current when no migrations are registered at all */
+		template<typename T>
+		static bool FromJson(const json& document, T& value, const Migrations& migrations = Migrations::Default()) {
+			const std::uint64_t fingerprint = Migrations::ReadFingerprint(document);
+			if (fingerprint == Fingerprint<T>() || (fingerprint == 0 && migrations.Empty())) {
+				Deserializer::FromJson(document, value);
+				return true;
+			}
+			if (!migrations.CanUpgrade(fingerprint, Fingerprint<T>())) {
+				Deserializer::FromJson(document, value);
+				return false;
+			}
+			json upgraded = document;
+			migrations.Upgrade(upgraded, Fingerprint<T>());
+			Deserializer::FromJson(upgraded, value);
+			return true;
+		}
+
+		/* True if document was written from the current layout of T */
+		template<typename T>
+		static bool IsCurrent(const json& document) {
+			return Migrations::ReadFingerprint(document) == Fingerprint<T>();
+		}
+	};
+}
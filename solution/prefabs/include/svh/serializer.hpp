@@ -3,8 +3,17 @@
 #include <svh/visit_struct/visit_struct.hpp>
 #include <svh/cubicdaiya/dtl.hpp>
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 
 #include "defines.hpp"
+#include "enum_codec.hpp"
 
 /* Define SVH_DISABLE_EXCEPTION_HANDLING to disable exceptions */
 /* Define SVH_DISABLE_ERROR_LOGGING to disable logging */
@@ -64,6 +73,19 @@ namespace svh {
 			return value;
 		}
 
+		/* For enums without user-defined serialize functions, written by name, see EnumCodec */
+		template<typename T>
+		static auto SerializeImpl(const T& value)
+			-> std::enable_if_t<is_enum_v<T> && !has_serialize_v<T>, json> {
+			if constexpr (!enum_as_integer<T>::value) {
+				const std::string_view name = EnumCodec<T>::Name(value);
+				if (!name.empty()) {
+					return std::string(name);
+				}
+			}
+			return EnumCodec<T>::ToInteger(value);
+		}
+
 		/* For C-style arrays */
 		template<typename T, std::size_t N>
 		static auto SerializeImpl(const T(&value)[N]) {
@@ -97,9 +119,16 @@ namespace svh {
 		/* For visitable struct */
 		template<typename T>
 		void operator()(const char* name, T& value) {
-			auto it = input.find(name);
-			if (it != input.end()) {
+			/* Documents written by Serializer hold the fields in visit order, so the next key is checked before searching */
+			if (next != input->end() && next.key() == name) {
+				DeserializeImpl(next.value(), value);
+				++next;
+				return;
+			}
+			auto it = input->find(name);
+			if (it != input->end()) {
 				DeserializeImpl(it.value(), value);
+				next = std::next(it);
 			}
 		}
 
@@ -119,16 +148,19 @@ namespace svh {
 		}
 	private:
 		/* Variables */
-		json input;
+		const json* input;
+		json::const_iterator next;
 
 	private:
-		Deserializer() : input(json()) {}
+		explicit Deserializer(const json& j) : input(&j), next(j.begin()) {}
 		/* For visitable structs only */
 		template<typename T>
 		static auto DeserializeImpl(const json& j, T& value)
 			-> enable_if_visitable<T, void> {
-			Deserializer deserializer;
-			deserializer.input = j;
+			if (!j.is_object()) {
+				return;
+			}
+			Deserializer deserializer(j);
 			visit_struct::for_each(value, deserializer);
 		}
 
@@ -159,6 +191,21 @@ namespace svh {
 			}
 		}
 
+		/* For enums without user-defined deserialize functions, accepts names and integers */
+		template<typename T>
+		static auto DeserializeImpl(const json& j, T& value)
+			-> std::enable_if_t<is_enum_v<T> && !has_deserialize_v<T>, void> {
+			if (j.is_string()) {
+				if (!EnumCodec<T>::Decode(j.get_ref<const std::string&>(), value)) {
+					HandleError("Unknown enum name", j);
+				}
+			} else if (j.is_number_integer()) {
+				value = static_cast<T>(j.get<typename EnumCodec<T>::Integer>());
+			} else {
+				HandleError("Invalid enum type", j);
+			}
+		}
+
 		/* For C-style arrays */
 		template<typename T, std::size_t N>
 		static auto DeserializeImpl(const json& j, T(&value)[N]) {
@@ -247,7 +294,21 @@ namespace svh {
 		OverwriteImpl(j, value);
 	}
 
+	/* One step in the path to a value written by Overwrite */
+	struct PathElement {
+		enum class Kind : unsigned char { Field, Index, Key };
+
+		Kind kind = Kind::Field;
+		/* Field index in VISITABLE_STRUCT order, or the container index */
+		std::size_t index = 0;
+		/* Map key, in the same format as the json object key */
+		std::string key;
+	};
+
+	using FieldPath = std::vector<PathElement>;
+
 	class Overwrite {
+		struct Observation;
 	public:
 		/* For users */
 		template<typename T>
@@ -258,24 +319,214 @@ namespace svh {
 			OverwriteImpl(j, value);
 		}
 
+		/* Same as above, observer(const FieldPath&) is called for every value the patch writes. */
+		/* Added or removed elements are reported once as a change of their container (or map key) */
+		template<typename T, typename Observer>
+		static void FromJson(const json& j, T& value, Observer&& observer) {
+			if (j.is_null()) {
+				return;
+			}
+			using ObserverType = std::remove_reference_t<Observer>;
+			Observation observation;
+			observation.observer = const_cast<void*>(static_cast<const void*>(&observer));
+			observation.notify = [](void* o, const FieldPath& path) {
+				(*static_cast<ObserverType*>(o))(path);
+			};
+			ObservationScope scope(&observation);
+			OverwriteImpl(j, value);
+		}
+
+		/* Applies the same patch to every target, split over worker threads (0 = hardware concurrency). */
+		/* Objects shared by several targets through shared_ptr/weak_ptr are overwritten once */
+		template<typename T>
+		static void FromJsonBatch(const json& j, T* targets, std::size_t count, unsigned thread_count = 0) {
+			BatchImpl(j, count, thread_count, [targets](std::size_t i) -> T& { return targets[i]; });
+		}
+
+		template<typename T>
+		static void FromJsonBatch(const json& j, std::vector<T>& targets, unsigned thread_count = 0) {
+			FromJsonBatch(j, targets.data(), targets.size(), thread_count);
+		}
+
+		/* For targets that are not stored next to each other */
+		template<typename T>
+		static void FromJsonBatch(const json& j, std::vector<T*>& targets, unsigned thread_count = 0) {
+			BatchImpl(j, targets.size(), thread_count, [&targets](std::size_t i) -> T& { return *targets[i]; });
+		}
+
+		/* Used by the shared pointer overwrites, false if another target of the running batch already owns this object */
+		static bool ClaimShared(const void* object) {
+			SharedClaims* claims = ActiveClaims();
+			if (claims == nullptr) {
+				return true;
+			}
+			std::lock_guard<std::mutex> lock(claims->mutex);
+			return claims->objects.insert(object).second;
+		}
+
+		/* The helpers below are used by the std overwrites, they do nothing without an observer */
+		static bool IsObserved() {
+			return ActiveObservation() != nullptr;
+		}
+
+		/* Reports the current path as changed */
+		static void NotifyChanged() {
+			Observation* observation = ActiveObservation();
+			if (observation == nullptr) {
+				return;
+			}
+			++observation->notified;
+			/* Overwrites done by the observer itself are not reported */
+			ObservationScope quiet(nullptr);
+			observation->notify(observation->observer, observation->path);
+		}
+
+		/* Adds an element to the path while it is alive */
+		class PathScope {
+		public:
+			PathScope(PathElement::Kind kind, std::size_t index) : observation(ActiveObservation()) {
+				if (observation) observation->path.push_back({ kind, index, {} });
+			}
+			explicit PathScope(const std::string& key) : observation(ActiveObservation()) {
+				if (observation) observation->path.push_back({ PathElement::Kind::Key, 0, key });
+			}
+			~PathScope() {
+				if (observation) observation->path.pop_back();
+			}
+			PathScope(const PathScope&) = delete;
+			PathScope& operator=(const PathScope&) = delete;
+		private:
+			Observation* observation;
+		};
+
+		/* Stops reporting while new elements are built or a container is copied back, */
+		/* the container reports the change itself */
+		class QuietScope {
+		public:
+			QuietScope() : previous(ActiveObservation()) { ActiveObservation() = nullptr; }
+			~QuietScope() { ActiveObservation() = previous; }
+			QuietScope(const QuietScope&) = delete;
+			QuietScope& operator=(const QuietScope&) = delete;
+		private:
+			Observation* previous;
+		};
+
 		/* For visitable struct */
 		template<typename T>
 		void operator()(const char* name, T& value) {
-			auto it = input.find(name);
-			if (it != input.end()) {
+			const std::size_t index = field_index++;
+			auto it = input->find(name);
+			if (it != input->end()) {
+				PathScope scope(PathElement::Kind::Field, index);
 				OverwriteImpl(it.value(), value);
 			}
 		}
 
 	private: /* Variables */
-		json input;
+		/* Points into the patch, the patch outlives the visit */
+		const json* input = nullptr;
+		std::size_t field_index = 0;
+
+		struct Observation {
+			FieldPath path;
+			void* observer = nullptr;
+			void (*notify)(void*, const FieldPath&) = nullptr;
+			/* Number of NotifyChanged calls, to find the leaves */
+			std::size_t notified = 0;
+		};
+
+		static Observation*& ActiveObservation() {
+			thread_local Observation* observation = nullptr;
+			return observation;
+		}
+
+		class ObservationScope {
+		public:
+			explicit ObservationScope(Observation* observation) : previous(ActiveObservation()) { ActiveObservation() = observation; }
+			~ObservationScope() { ActiveObservation() = previous; }
+			ObservationScope(const ObservationScope&) = delete;
+			ObservationScope& operator=(const ObservationScope&) = delete;
+		private:
+			Observation* previous;
+		};
+
+		struct SharedClaims {
+			std::mutex mutex;
+			std::unordered_set<const void*> objects;
+		};
+
+		static SharedClaims*& ActiveClaims() {
+			thread_local SharedClaims* claims = nullptr;
+			return claims;
+		}
 	private: /* Functions */
 
+		/* Runs OverwriteImpl on target(i) for every i below count */
+		template<typename Target>
+		static void BatchImpl(const json& j, std::size_t count, unsigned thread_count, Target target) {
+			if (j.is_null() || count == 0) {
+				return;
+			}
+			if (thread_count == 0) {
+				thread_count = std::max(1u, std::thread::hardware_concurrency());
+			}
+			/* Small batches are not worth starting threads for */
+			constexpr std::size_t chunk_size = 256;
+			const std::size_t chunks = (count + chunk_size - 1) / chunk_size;
+			thread_count = static_cast<unsigned>(std::min<std::size_t>(thread_count, chunks));
+
+			SharedClaims claims;
+			std::atomic<std::size_t> next_chunk{ 0 };
+			std::exception_ptr error;
+			std::mutex error_mutex;
+
+			auto worker = [&]() {
+				SharedClaims* previous = ActiveClaims();
+				ActiveClaims() = &claims;
+				try {
+					for (std::size_t chunk = next_chunk++; chunk < chunks; chunk = next_chunk++) {
+						const std::size_t end = std::min(count, (chunk + 1) * chunk_size);
+						for (std::size_t i = chunk * chunk_size; i < end; ++i) {
+							OverwriteImpl(j, target(i));
+						}
+					}
+				} catch (...) {
+					std::lock_guard<std::mutex> lock(error_mutex);
+					if (!error) error = std::current_exception();
+					/* Stop the other workers */
+					next_chunk = chunks;
+				}
+				ActiveClaims() = previous;
+			};
+
+			std::vector<std::thread> threads;
+			threads.reserve(thread_count - 1);
+			for (unsigned t = 1; t < thread_count; ++t) {
+				threads.emplace_back(worker);
+			}
+			worker();
+			for (auto& thread : threads) {
+				thread.join();
+			}
+			if (error) {
+				std::rethrow_exception(error);
+			}
+		}
+
 		/* For userdefined overwrites*/
 		template<typename T>
 		static auto OverwriteImpl(const json& j, T& value)
 			-> enable_if_has_overwrite<T, void> {
-			return UserDefinedOverwriteImpl(j, value);
+			Observation* observation = ActiveObservation();
+			if (observation == nullptr) {
+				return UserDefinedOverwriteImpl(j, value);
+			}
+			const std::size_t notified = observation->notified;
+			UserDefinedOverwriteImpl(j, value);
+			/* Nothing inside reported a change, so the value itself is the leaf */
+			if (observation->notified == notified) {
+				NotifyChanged();
+			}
 		}
 
 		/* For visitable structs only */
@@ -283,7 +534,7 @@ namespace svh {
 		static auto OverwriteImpl(const json& j, T& value)
 			-> enable_if_visitable<T, void> {
 			Overwrite overwrite;
-			overwrite.input = j;
+			overwrite.input = &j;
 			visit_struct::for_each(value, overwrite);
 		}
 
@@ -292,6 +543,7 @@ namespace svh {
 		static auto OverwriteImpl(const json& j, T& value)
 			-> std::enable_if_t < svh::has_overwrite_v<T> == false && !svh::is_visitable_v<T>, void> {
 			svh::Deserializer::FromJson(j, value);
+			NotifyChanged();
 		}
 	};
 }
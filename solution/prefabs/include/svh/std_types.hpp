@@ -1,6 +1,7 @@
 ﻿#pragma once
 #include "svh/serializer.hpp"
 #include "svh/defines.hpp"
+#include "svh/key_codec.hpp"
 
 #include <vector>			// for std::vector
 #include <map>				// for std::map
@@ -39,12 +40,7 @@ namespace std {
 	static inline svh::json SerializeImpl(const std::map<K, V, C, A>& value) {
 		svh::json result = svh::json::object();
 		for (const auto& item : value) {
-			if constexpr (svh::is_string_v<K>) {
-				result[item.first] = svh::Serializer::ToJson(item.second);
-			} else {
-				auto key = svh::Serializer::ToJson(item.first).dump();
-				result[key] = svh::Serializer::ToJson(item.second);
-			}
+			svh::EmplaceUniqueKey(result, svh::KeyCodec<K>::Encode(item.first), svh::Serializer::ToJson(item.second));
 		}
 		return result;
 	}
@@ -60,12 +56,7 @@ namespace std {
 	static inline svh::json SerializeImpl(const std::unordered_map<K, V, H, E, A>& value) {
 		svh::json result = svh::json::object();
 		for (const auto& item : value) {
-			if constexpr (svh::is_string_v<K>) {
-				result[item.first] = svh::Serializer::ToJson(item.second);
-			} else {
-				auto key = svh::Serializer::ToJson(item.first).dump();
-				result[key] = svh::Serializer::ToJson(item.second);
-			}
+			svh::EmplaceUniqueKey(result, svh::KeyCodec<K>::Encode(item.first), svh::Serializer::ToJson(item.second));
 		}
 		return result;
 	}
@@ -81,7 +72,7 @@ namespace std {
 		svh::json result = svh::json::object();
 
 		for (auto&& [k, v] : mm) {
-			auto& slot = result[k];
+			auto& slot = result[svh::KeyCodec<K>::Encode(k)];
 			if (slot.is_null()) {
 				// first value for this key – store it directly
 				slot = svh::Serializer::ToJson(v);
@@ -110,7 +101,7 @@ namespace std {
 	static inline svh::json SerializeImpl(const std::unordered_multimap<K, V, H, E, A>& umm) {
 		svh::json result = svh::json::object();
 		for (auto&& [k, v] : umm) {
-			auto& slot = result[k];
+			auto& slot = result[svh::KeyCodec<K>::Encode(k)];
 			if (slot.is_null()) {
 				// first value for this key – store it directly
 				slot = svh::Serializer::ToJson(v);
@@ -256,22 +247,14 @@ namespace std {
 			auto& key = item.key();
 			auto& val = item.value();
 			K k{};
-			if constexpr (svh::is_string_v<K>) {
-				k = key;
-			} else {
-				svh::Deserializer::FromJson(key, k);
-			}
-			if (val.is_array()) {
-				for (const auto& v : val) {
-					V temp_value{};
-					svh::Deserializer::FromJson(v, temp_value);
-					value.emplace(std::move(k), std::move(temp_value));
-				}
-			} else {
-				V temp_value{};
-				svh::Deserializer::FromJson(val, temp_value);
-				value.emplace(std::move(k), std::move(temp_value));
+			if (!svh::KeyCodec<K>::Decode(key, k)) {
+				svh::Deserializer::HandleError("map key", key);
+				continue;
 			}
+			// keys are unique, so an array is the value itself and not several values
+			V temp_value{};
+			svh::Deserializer::FromJson(val, temp_value);
+			value.emplace(std::move(k), std::move(temp_value));
 		}
 	}
 
@@ -292,18 +275,14 @@ namespace std {
 			auto& key = item.key();
 			auto& val = item.value();
 			K k{};
-			svh::Deserializer::FromJson(key, k);
-			if (val.is_array()) {
-				for (const auto& v : val) {
-					V temp_value{};
-					svh::Deserializer::FromJson(v, temp_value);
-					value.emplace(std::move(k), std::move(temp_value));
-				}
-			} else {
-				V temp_value{};
-				svh::Deserializer::FromJson(val, temp_value);
-				value.emplace(std::move(k), std::move(temp_value));
+			if (!svh::KeyCodec<K>::Decode(key, k)) {
+				svh::Deserializer::HandleError("map key", key);
+				continue;
 			}
+			// keys are unique, so an array is the value itself and not several values
+			V temp_value{};
+			svh::Deserializer::FromJson(val, temp_value);
+			value.emplace(std::move(k), std::move(temp_value));
 		}
 	}
 
@@ -323,7 +302,10 @@ namespace std {
 			auto& key = item.key();
 			auto& val = item.value();
 			K k{};
-			svh::Deserializer::FromJson(key, k);
+			if (!svh::KeyCodec<K>::Decode(key, k)) {
+				svh::Deserializer::HandleError("map key", key);
+				continue;
+			}
 			if (val.is_array()) {
 				for (const auto& v : val) {
 					V value{};
@@ -355,7 +337,10 @@ namespace std {
 			auto& key = item.key();
 			auto& val = item.value();
 			K k{};
-			svh::Deserializer::FromJson(key, k);
+			if (!svh::KeyCodec<K>::Decode(key, k)) {
+				svh::Deserializer::HandleError("map key", key);
+				continue;
+			}
 			if (val.is_array()) {
 				for (const auto& v : val) {
 					V value{};
@@ -673,33 +658,34 @@ namespace std {
 		svh::json added_json = svh::json::array();
 		svh::json changed_json = svh::json::array();
 
+		// an ADD that was turned into a "changed" entry
+		constexpr int paired = dtl::SES_ADD + 1;
+
 		for (size_t k = 0; k < ops.size(); ++k) {
 			auto& o = ops[k];
 
 			// — only recurse for sequence‐like Elems (e.g. vector<...>, list<...>, but not int) —
 			if constexpr (!svh::is_string_type_v<Elem>) {
 				if (o.type == dtl::SES_DELETE) {
-					// find the matching ADD for this delete, anywhere after it
-					auto it = std::find_if(
-						ops.begin() + k + 1, ops.end(),
-						[&](Op const& x) {
-							return x.type == dtl::SES_ADD
-								&& x.afterIdx == o.beforeIdx;
-						}
-					);
+					// find the first unused ADD of the same edit run, a COMMON in between
+					// would move the kept element away from the index it is changed at
+					auto it = ops.begin() + k + 1;
+					while (it != ops.end() && (it->type == dtl::SES_DELETE || it->type == paired)) {
+						++it;
+					}
+					if (it != ops.end() && it->type != dtl::SES_ADD) {
+						it = ops.end();
+					}
 
 					if (it != ops.end()) {
 						// recurse into the two inner sequences
 						Elem oldInner = left[o.beforeIdx];
-						Elem newInner = right[o.beforeIdx];
+						Elem newInner = right[it->afterIdx];
 						svh::json innerDiff = svh::Compare::GetChanges(oldInner, newInner);
-						auto dump = innerDiff.dump();
-
-						it->type = dtl::SES_COMMON;
 
 						// always treat any innerDiff as a nested “changed” patch:
 						if (!innerDiff.empty()) {
-							svh::json idx = svh::json::array({ o.beforeIdx });
+							svh::json idx = svh::json::array({ it->afterIdx });
 							changed_json.push_back(
 								svh::json::object({
 								{ svh::INDEX, std::move(idx) },
@@ -712,7 +698,7 @@ namespace std {
 
 
 						// mark that ADD as “used” so we don’t emit it again
-						it->type = dtl::SES_COMMON;
+						it->type = paired;
 						continue;
 					}
 				}
@@ -756,7 +742,9 @@ namespace std {
 			auto const& k = item.first;
 			auto const& v = item.second;
 			if (left.find(k) == left.end()) {
-				added_entries.push_back(svh::Serializer::ToJson(item));
+				svh::json entry = svh::json::object();
+				svh::EmplaceUniqueKey(entry, svh::KeyCodec<Key>::Encode(k), svh::Serializer::ToJson(v));
+				added_entries.push_back(std::move(entry));
 			}
 		}
 
@@ -764,7 +752,7 @@ namespace std {
 		// 2) scan removals in `left`
 		for (auto const& [k, v] : left) {
 			if (right.find(k) == right.end()) {
-				removed_keys.push_back(svh::Serializer::ToJson(k));
+				removed_keys.push_back(svh::KeyCodec<Key>::ToValue(k));
 			}
 		}
 
@@ -774,11 +762,9 @@ namespace std {
 			if (rit != right.end()) {
 				auto cd = svh::Compare::GetChanges(v, rit->second);
 				if (!cd.empty()) {
-					//changed[svh::Serializer::ToJson(k).get<std::string>()] = cd;
-					auto key = svh::Serializer::ToJson(k);
-					changed.push_back(
-						svh::json::object({ {key,cd} })
-					);
+					svh::json entry = svh::json::object();
+					svh::EmplaceUniqueKey(entry, svh::KeyCodec<Key>::Encode(k), std::move(cd));
+					changed.push_back(std::move(entry));
 				}
 			}
 		}
@@ -903,6 +889,7 @@ namespace std {
 			if (idx == N - 1) {
 				auto& elem = std::get<N - 1>(t);
 				const auto& val = change["value"];
+				svh::Overwrite::PathScope scope(svh::PathElement::Kind::Index, N - 1);
 
 				if constexpr (svh::is_std_tuple_v<std::decay_t<decltype(elem)>>) {
 					// element is itself a tuple: if the JSON is a diff obj, recurse,
@@ -915,6 +902,7 @@ namespace std {
 				} else {
 					// a leaf element – just overwrite via the normal FromJson
 					svh::Deserializer::FromJson(val, elem);
+					svh::Overwrite::NotifyChanged();
 				}
 			} else {
 				// not the right slot — keep recursing down
@@ -955,6 +943,7 @@ namespace std {
 	template<typename Elem>
 	static inline void OverwriteImpl(const svh::json& j, std::vector<Elem>& c) {
 		if (j.is_array()) {
+			svh::Overwrite::QuietScope quiet;
 			c.clear();
 			for (auto const& item : j) {
 				Elem tmp{};
@@ -971,7 +960,6 @@ namespace std {
 		if (j.contains(svh::REMOVED)) {
 			int offset = 0;
 			for (auto const& idx : j[svh::REMOVED]) {
-				auto dump = idx.dump();
 				auto i = getIndex(idx);
 				i -= offset;
 				if (i < c.size()) {
@@ -984,20 +972,25 @@ namespace std {
 		}
 		// ADDED
 		if (j.contains(svh::ADDED_VALUES)) {
+			svh::Overwrite::QuietScope quiet;
 			for (auto const& item : j[svh::ADDED_VALUES]) {
 				std::size_t i = getIndex(item[svh::INDEX]);
 				Elem tmp{};
-				auto dump = item[svh::VALUE].dump();
 				svh::Overwrite::FromJson(item[svh::VALUE], tmp);
 				i = std::min(i, c.size());
 				c.insert(c.begin() + i, std::move(tmp));
 			}
 		}
+		// the layout changed, report the vector itself
+		if (j.contains(svh::REMOVED) || j.contains(svh::ADDED_VALUES)) {
+			svh::Overwrite::NotifyChanged();
+		}
 		// CHANGED
 		if (j.contains(svh::CHANGED_VALUES)) {
 			for (auto const& item : j[svh::CHANGED_VALUES]) {
 				std::size_t i = getIndex(item[svh::INDEX]);
 				if (i < c.size()) {
+					svh::Overwrite::PathScope scope(svh::PathElement::Kind::Index, i);
 					svh::Overwrite::FromJson(item[svh::VALUE], c[i]);
 				} else {
 					svh::Deserializer::HandleError("index out of range", j);
@@ -1009,6 +1002,7 @@ namespace std {
 	// 3b) vector<bool>
 	static inline void OverwriteImpl(const svh::json& j, std::vector<bool>& c) {
 		if (j.is_array()) {
+			svh::Overwrite::QuietScope quiet;
 			c.clear();
 			for (auto const& item : j) {
 				bool b{};
@@ -1035,6 +1029,7 @@ namespace std {
 			}
 		}
 		if (j.contains(svh::ADDED_VALUES)) {
+			svh::Overwrite::QuietScope quiet;
 			for (auto const& item : j[svh::ADDED_VALUES]) {
 				auto i = getIndex(item[svh::INDEX]);
 				bool b{};
@@ -1043,10 +1038,14 @@ namespace std {
 				c.insert(c.begin() + i, b);
 			}
 		}
+		if (j.contains(svh::REMOVED) || j.contains(svh::ADDED_VALUES)) {
+			svh::Overwrite::NotifyChanged();
+		}
 		if (j.contains(svh::CHANGED_VALUES)) {
 			for (auto const& item : j[svh::CHANGED_VALUES]) {
 				auto i = getIndex(item[svh::INDEX]);
 				if (i < c.size()) {
+					svh::Overwrite::PathScope scope(svh::PathElement::Kind::Index, i);
 					bool b{};
 					svh::Overwrite::FromJson(item[svh::VALUE], b);
 					c[i] = b;
@@ -1062,6 +1061,7 @@ namespace std {
 	static inline void OverwriteImpl(const svh::json& j, std::list<Elem>& c) {
 		auto vec = svh::to_std_vector(c);
 		svh::Overwrite::FromJson(j, vec);
+		svh::Overwrite::QuietScope quiet;
 		c.clear();
 		for (auto const& item : vec) {
 			svh::Overwrite::FromJson(item, c.emplace_back());
@@ -1074,6 +1074,7 @@ namespace std {
 		auto vec = svh::to_std_vector(c);
 		svh::Overwrite::FromJson(j, vec);
 
+		svh::Overwrite::QuietScope quiet;
 		c.clear();
 
 		auto it = c.before_begin();
@@ -1089,6 +1090,7 @@ namespace std {
 	static inline void OverwriteImpl(const svh::json& j, std::deque<Elem>& c) {
 		auto vec = svh::to_std_vector(c);
 		svh::Overwrite::FromJson(j, vec);
+		svh::Overwrite::QuietScope quiet;
 		c.clear();
 		for (auto const& item : vec) {
 			svh::Overwrite::FromJson(item, c.emplace_back());
@@ -1100,6 +1102,7 @@ namespace std {
 	static inline void OverwriteImpl(const svh::json& j, std::array<Elem, N>& arr) {
 		auto vec = svh::to_std_vector(arr);
 		svh::Overwrite::FromJson(j, vec);
+		svh::Overwrite::QuietScope quiet;
 		for (std::size_t i = 0; i < N; ++i) {
 			svh::Overwrite::FromJson(vec[i], arr[i]);
 		}
@@ -1110,6 +1113,7 @@ namespace std {
 	static inline void OverwriteImpl(const svh::json& j, Elem(&arr)[N]) {
 		auto vec = svh::to_std_vector(arr);
 		svh::Overwrite::FromJson(j, vec);
+		svh::Overwrite::QuietScope quiet;
 		for (std::size_t i = 0; i < N; ++i) {
 			svh::Overwrite::FromJson(vec[i], arr[i]);
 		}
@@ -1129,6 +1133,7 @@ namespace std {
 
 		// array → full replace
 		if (j.is_array()) {
+			svh::Overwrite::QuietScope quiet;
 			m.clear();
 			for (auto const& item : j) {
 				if (!item.is_object()) {
@@ -1137,10 +1142,13 @@ namespace std {
 				}
 				// each entry is a singleton object { key: value }
 				for (auto it = item.begin(); it != item.end(); ++it) {
-					Key   k;
-					Value v;
+					Key   k{};
+					Value v{};
 					// parse the key (string) back into Key
-					svh::Overwrite::FromJson(svh::json(it.key()), k);
+					if (!svh::KeyCodec<Key>::Decode(it.key(), k)) {
+						svh::Deserializer::HandleError("map key", item);
+						continue;
+					}
 					// parse the value
 					svh::Overwrite::FromJson(it.value(), v);
 					m.emplace(std::move(k), std::move(v));
@@ -1158,28 +1166,40 @@ namespace std {
 		// 1) removals
 		if (j.contains(svh::REMOVED)) {
 			for (auto const& keyJ : j[svh::REMOVED]) {
-				Key k;
-				svh::Overwrite::FromJson(keyJ, k);
+				Key k{};
+				if (!svh::KeyCodec<Key>::FromValue(keyJ, k)) {
+					svh::Deserializer::HandleError("map key", keyJ);
+					continue;
+				}
 				m.erase(k);
+				if (svh::Overwrite::IsObserved()) {
+					svh::Overwrite::PathScope scope(svh::KeyCodec<Key>::Encode(k));
+					svh::Overwrite::NotifyChanged();
+				}
 			}
 		}
 
-		auto dump = j.dump();
-
 		// 2) additions
 		if (j.contains(svh::ADDED_VALUES)) {
 			for (auto const& item : j[svh::ADDED_VALUES]) {
-				auto dump2 = item.dump();
 				if (!item.is_object()) {
 					svh::Deserializer::HandleError("map", item);
 					continue;
 				}
 				for (auto it = item.begin(); it != item.end(); ++it) {
-					Key   k;
-					Value v;
-					svh::Overwrite::FromJson(svh::json(it.key()), k);
-					svh::Overwrite::FromJson(it.value(), v);
+					Key   k{};
+					Value v{};
+					if (!svh::KeyCodec<Key>::Decode(it.key(), k)) {
+						svh::Deserializer::HandleError("map key", item);
+						continue;
+					}
+					{
+						svh::Overwrite::QuietScope quiet;
+						svh::Overwrite::FromJson(it.value(), v);
+					}
 					m.emplace(std::move(k), std::move(v));
+					svh::Overwrite::PathScope scope(it.key());
+					svh::Overwrite::NotifyChanged();
 				}
 			}
 		}
@@ -1191,18 +1211,15 @@ namespace std {
 			// Case A: object of key→value
 			if (changed.is_object()) {
 				for (auto it = changed.begin(); it != changed.end(); ++it) {
-					const auto& keyStr = it.key();
-					svh::json keyJ;
-					try {
-						keyJ = svh::json::parse(keyStr);
-					} catch (...) {
-						keyJ = keyStr;
+					Key k{};
+					if (!svh::KeyCodec<Key>::Decode(it.key(), k)) {
+						svh::Deserializer::HandleError("map key", changed);
+						continue;
 					}
-					Key k;
-					svh::Overwrite::FromJson(keyJ, k);
 
 					auto mapIt = m.find(k);
 					if (mapIt != m.end()) {
+						svh::Overwrite::PathScope scope(it.key());
 						svh::Overwrite::FromJson(it.value(), mapIt->second);
 					} else {
 						svh::Deserializer::HandleError("map", j);
@@ -1216,18 +1233,15 @@ namespace std {
 						continue;  // skip anything unexpected
 					}
 					for (auto it2 = entry.begin(); it2 != entry.end(); ++it2) {
-						const auto& keyStr = it2.key();
-						svh::json keyJ;
-						try {
-							keyJ = svh::json::parse(keyStr);
-						} catch (...) {
-							keyJ = keyStr;
+						Key k{};
+						if (!svh::KeyCodec<Key>::Decode(it2.key(), k)) {
+							svh::Deserializer::HandleError("map key", entry);
+							continue;
 						}
-						Key k;
-						svh::Overwrite::FromJson(keyJ, k);
 
 						auto mapIt = m.find(k);
 						if (mapIt != m.end()) {
+							svh::Overwrite::PathScope scope(it2.key());
 							svh::Overwrite::FromJson(it2.value(), mapIt->second);
 						} else {
 							svh::Deserializer::HandleError("map", j);
@@ -1261,14 +1275,18 @@ namespace std {
 			p.reset();
 		} else {
 			if (!p) p = std::make_shared<T>();
-			svh::Overwrite::FromJson(j, *p);
+			if (svh::Overwrite::ClaimShared(p.get())) {
+				svh::Overwrite::FromJson(j, *p);
+			}
 		}
 	}
 
 	template<typename T>
 	static inline void OverwriteImpl(const svh::json& j, std::weak_ptr<T>& wp) {
 		if (auto sp = wp.lock()) {
-			svh::Overwrite::FromJson(j, *sp);
+			if (svh::Overwrite::ClaimShared(sp.get())) {
+				svh::Overwrite::FromJson(j, *sp);
+			}
 		} else {
 			svh::Deserializer::HandleError("weak_ptr", j);
 		}
@@ -1283,8 +1301,14 @@ namespace std {
 			svh::Deserializer::HandleError("pair", j);
 			return;
 		}
-		if (j.contains(svh::FIRST))  svh::Overwrite::FromJson(j[svh::FIRST], p.first);
-		if (j.contains(svh::SECOND)) svh::Overwrite::FromJson(j[svh::SECOND], p.second);
+		if (j.contains(svh::FIRST)) {
+			svh::Overwrite::PathScope scope(svh::PathElement::Kind::Index, 0);
+			svh::Overwrite::FromJson(j[svh::FIRST], p.first);
+		}
+		if (j.contains(svh::SECOND)) {
+			svh::Overwrite::PathScope scope(svh::PathElement::Kind::Index, 1);
+			svh::Overwrite::FromJson(j[svh::SECOND], p.second);
+		}
 	}
 
 	template<
@@ -1296,7 +1320,7 @@ namespace std {
 	static inline auto OverwriteImpl(
 		const svh::json& j,
 		Set<Key, CmpOrHash, Alloc>& s
-	) -> std::enable_if_t< !svh::is_string_type_v< Set<Key, CmpOrHash, Alloc>>, void> {
+	) -> std::enable_if_t< !svh::is_string_type_v< Set<Key, CmpOrHash, Alloc>> && !svh::is_associative_map_v<Set<Key, CmpOrHash, Alloc>>, void> {
 		using Container = Set<Key, CmpOrHash, Alloc>;
 		// 1) serialize current into a vec repr
 		auto vec = svh::to_std_vector(s);
@@ -0,0 +1,231 @@
+#pragma once
+#include "svh/serializer.hpp"
+
+#include <cstddef>			// for std::size_t
+#include <fstream>			// for std::ifstream, std::ofstream
+#include <istream>			// for std::istream
+#include <memory>			// for std::unique_ptr
+#include <ostream>			// for std::ostream
+#include <string>			// for std::string
+#include <vector>			// for std::vector
+
+namespace svh {
+
+	/* Lines: one json record per line (NDJSON). Array: one top-level json array, written and read element by element */
+	enum class StreamFormat { Lines, Array };
+
+	/* Writes records one at a time, each is serialized straight into the stream and then dropped */
+	template<typename T>
+	class StreamWriter {
+	public:
+		StreamWriter(std::ostream& stream, StreamFormat format = StreamFormat::Lines) : out(&stream), format(format) {}
+
+		StreamWriter(const std::string& path, StreamFormat format = StreamFormat::Lines)
+			: file(std::make_unique<std::ofstream>(path, std::ios::binary | std::ios::trunc)), out(file.get()), format(format) {
+		}
+
+		/* Closes the array */
+		~StreamWriter() {
+			Close();
+		}
+
+		StreamWriter(const StreamWriter&) = delete;
+		StreamWriter& operator=(const StreamWriter&) = delete;
+
+		void Write(const T& value) {
+			if (format == StreamFormat::Array) {
+				*out << (count == 0 ? "[\n" : ",\n");
+			}
+			*out << Serializer::ToJson(value);
+			if (format == StreamFormat::Lines) {
+				*out << '\n';
+			}
+			++count;
+		}
+
+		/* Ends the array and flushes, nothing can be written after it */
+		void Close() {
+			if (closed) {
+				return;
+			}
+			if (format == StreamFormat::Array) {
+				*out << (count == 0 ? "[]\n" : "\n]\n");
+			}
+			out->flush();
+			closed = true;
+		}
+
+		/* False if the stream failed, for example because the disk is full */
+		bool Good() const {
+			return static_cast<bool>(*out);
+		}
+
+		std::size_t Count() const {
+			return count;
+		}
+
+	private:
+		std::unique_ptr<std::ofstream> file;
+		std::ostream* out;
+		StreamFormat format;
+		std::size_t count = 0;
+		bool closed = false;
+	};
+
+	/* Reads records one at a time from NDJSON or a top-level json array, the format is detected from the first character. */
+	/* The input is read in fixed size chunks and each record is parsed from one reused buffer, */
+	/* so memory only depends on the size of the largest record, not on the size of the file */
+	template<typename T>
+	class StreamReader {
+	public:
+		static constexpr std::size_t CHUNK_SIZE = 1 << 16;
+
+		explicit StreamReader(std::istream& stream) : in(&stream), chunk(CHUNK_SIZE) {}
+
+		explicit StreamReader(const std::string& path)
+			: file(std::make_unique<std::ifstream>(path, std::ios::binary)), in(file.get()), chunk(CHUNK_SIZE) {
+		}
+
+		StreamReader(const StreamReader&) = delete;
+		StreamReader& operator=(const StreamReader&) = delete;
+
+		/* Reads the next record into value, false at the end. A record that does not parse goes through Deserializer::HandleError */
+		bool Next(T& value) {
+			if (!NextRecord()) {
+				return false;
+			}
+			json j = json::parse(record.begin(), record.end(), nullptr, false);
+			if (j.is_discarded()) {
+				Deserializer::HandleError("Invalid stream record", json(count));
+				return false;
+			}
+			value = T{};
+			Deserializer::FromJson(j, value);
+			++count;
+			return true;
+		}
+
+		/* Number of records read */
+		std::size_t Count() const {
+			return count;
+		}
+
+		/* Bytes held for the current record, stays at the size of the largest record */
+		std::size_t BufferCapacity() const {
+			return record.capacity() + chunk.size();
+		}
+
+	private:
+		std::unique_ptr<std::ifstream> file;
+		std::istream* in;
+		std::vector<char> chunk;
+		std::size_t position = 0;
+		std::size_t filled = 0;
+		std::string record;
+		std::size_t count = 0;
+		bool started = false;
+		bool in_array = false;
+		bool finished = false;
+
+		/* Next character without consuming it, false at the end of the input */
+		bool Peek(char& c) {
+			if (position == filled) {
+				if (!in || !*in) {
+					return false;
+				}
+				in->read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+				filled = static_cast<std::size_t>(in->gcount());
+				position = 0;
+				if (filled == 0) {
+					return false;
+				}
+			}
+			c = chunk[position];
+			return true;
+		}
+
+		static bool IsSpace(char c) {
+			return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+		}
+
+		/* Copies the text of the next top-level value into record */
+		bool NextRecord() {
+			if (finished || in == nullptr) {
+				return false;
+			}
+			char c;
+			/* Whitespace, and the brackets and commas of the array */
+			while (Peek(c)) {
+				/* The first character after leading whitespace tells an array from NDJSON */
+				if (!started && !IsSpace(c)) {
+					started = true;
+					if (c == '[') {
+						in_array = true;
+						++position;
+						continue;
+					}
+				}
+				if (IsSpace(c) || (in_array && c == ',')) {
+					++position;
+				} else if (in_array && c == ']') {
+					finished = true;
+					return false;
+				} else {
+					break;
+				}
+			}
+			if (position == filled && !Peek(c)) {
+				finished = true;
+				return false;
+			}
+
+			/* Scans a chunk at a time and appends what belongs to the record in one go */
+			record.clear();
+			int depth = 0;
+			bool in_string = false;
+			bool escaped = false;
+			bool done = false;
+			while (!done && Peek(c)) {
+				const std::size_t start = position;
+				for (; position < filled; ++position) {
+					c = chunk[position];
+					if (in_string) {
+						if (escaped) {
+							escaped = false;
+						} else if (c == '\\') {
+							escaped = true;
+						} else if (c == '"') {
+							in_string = false;
+							/* A string on its own */
+							if (depth == 0) {
+								++position;
+								done = true;
+								break;
+							}
+						}
+					} else if (c == '"') {
+						in_string = true;
+					} else if (c == '{' || c == '[') {
+						++depth;
+					} else if (c == '}' || c == ']') {
+						if (depth == 0) {
+							/* The end of the array after a number, true or null */
+							done = true;
+							break;
+						}
+						if (--depth == 0) {
+							++position;
+							done = true;
+							break;
+						}
+					} else if (depth == 0 && (IsSpace(c) || c == ',')) {
+						done = true;
+						break;
+					}
+				}
+				record.append(chunk.data() + start, position - start);
+			}
+			return !record.empty();
+		}
+	};
+}
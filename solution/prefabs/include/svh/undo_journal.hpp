@@ -0,0 +1,92 @@
+#pragma once
+#include "svh/serializer.hpp"
+#include "svh/patch.hpp"
+
+#include <deque>		// for std::deque
+#include <cstddef>		// for std::size_t
+
+namespace svh {
+
+	/* Undo/redo history made of invertible patches. */
+	/* Only the changed fields are stored, the oldest steps are dropped once the memory budget is exceeded */
+	class UndoJournal {
+	public:
+		explicit UndoJournal(std::size_t memory_budget) : budget(memory_budget) {}
+
+		/* Records the step from before to after, returns false if nothing changed */
+		template<typename T>
+		bool Record(const T& before, const T& after) {
+			json patch = GetInvertibleChanges(before, after);
+			if (patch.is_null()) {
+				return false;
+			}
+			Push(std::move(patch));
+			return true;
+		}
+
+		/* Adds an invertible patch, this discards everything that could be redone */
+		void Push(json patch) {
+			while (steps.size() > cursor) {
+				usage -= steps.back().bytes;
+				steps.pop_back();
+			}
+			const std::size_t bytes = EstimateSize(patch);
+			steps.push_back({ std::move(patch), bytes });
+			usage += bytes;
+			cursor = steps.size();
+
+			/* Keep at least the latest step, even if it alone is over budget */
+			while (usage > budget && steps.size() > 1) {
+				usage -= steps.front().bytes;
+				steps.pop_front();
+				--cursor;
+			}
+		}
+
+		template<typename T>
+		bool Undo(T& value) {
+			if (!CanUndo()) {
+				return false;
+			}
+			--cursor;
+			Overwrite::FromJson(steps[cursor].patch[UNDO], value);
+			return true;
+		}
+
+		template<typename T>
+		bool Redo(T& value) {
+			if (!CanRedo()) {
+				return false;
+			}
+			Overwrite::FromJson(steps[cursor].patch[REDO], value);
+			++cursor;
+			return true;
+		}
+
+		bool CanUndo() const { return cursor > 0; }
+		bool CanRedo() const { return cursor < steps.size(); }
+
+		std::size_t UndoCount() const { return cursor; }
+		std::size_t RedoCount() const { return steps.size() - cursor; }
+		std::size_t MemoryUsage() const { return usage; }
+		std::size_t MemoryBudget() const { return budget; }
+
+		void Clear() {
+			steps.clear();
+			cursor = 0;
+			usage = 0;
+		}
+
+	private:
+		struct Step {
+			json patch;
+			std::size_t bytes;
+		};
+
+		std::deque<Step> steps;
+		/* Number of steps that can be undone, steps past it can be redone */
+		std::size_t cursor = 0;
+		std::size_t usage = 0;
+		std::size_t budget;
+	};
+}
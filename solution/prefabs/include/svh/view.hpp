@@ -0,0 +1,422 @@
+#pragma once
+#include "svh/serializer.hpp"
+#include "svh/binary.hpp"
+
+#include <array>			// for std::array
+#include <cstddef>			// for std::size_t
+#include <cstdint>			// for std::uint8_t, std::uint32_t, std::uint64_t
+#include <cstring>			// for std::memcpy, std::memcmp
+#include <deque>			// for std::deque
+#include <fstream>			// for std::ofstream
+#include <iterator>			// for std::size
+#include <limits>			// for std::numeric_limits
+#include <list>				// for std::list
+#include <string>			// for std::string
+#include <string_view>		// for std::string_view
+#include <type_traits>		// for std::is_array_v
+#include <utility>			// for std::index_sequence
+#include <vector>			// for std::vector
+
+namespace svh {
+
+	/* "SVHV", format version, byte order, 16 bit flags, 64 bit schema hash of the root type, then the root slot */
+	constexpr char VIEW_MAGIC[] = { 'S', 'V', 'H', 'V' };
+	constexpr std::uint8_t VIEW_VERSION = 1;
+	constexpr std::size_t VIEW_HEADER_SIZE = 16;
+
+	template<typename T>
+	class View;
+
+	template<typename E>
+	class ListView;
+
+	/* Buffer format read in place by View, in the style of FlatBuffers. */
+	/* Every type has a slot whose size is known at compile time: numbers, enums and bulk copyable types are stored in it */
+	/* as they are in memory, bools as one byte and visitable structs as the slots of their fields one after another, */
+	/* so the offset of a field is a constant computed from the VISITABLE_STRUCT metadata. */
+	/* Strings, lists and other types store a 32 bit offset from the start of the buffer to their data: */
+	/* strings a 32 bit length, the characters and a zero, lists a 32 bit count and the slots of the elements, */
+	/* aligned when the elements are raw, and other types, like maps, a 32 bit length and MessagePack */
+	class ViewFormat {
+	public: /* API */
+
+		enum class Kind { Raw, Bool, Struct, String, List, Packed };
+
+		/* Writes value as a buffer View<T> can read, offsets limit it to 4 GB */
+		template<typename T>
+		static std::vector<std::uint8_t> Write(const T& value) {
+			Builder builder;
+			builder.bytes.reserve(256);
+			builder.Append(VIEW_MAGIC, sizeof(VIEW_MAGIC));
+			const std::uint8_t version = VIEW_VERSION;
+			const std::uint8_t order = NativeByteOrder();
+			const std::uint16_t flags = 0;
+			const std::uint64_t schema = Binary::SchemaHash<T>();
+			builder.Append(&version, sizeof(version));
+			builder.Append(&order, sizeof(order));
+			builder.Append(&flags, sizeof(flags));
+			builder.Append(&schema, sizeof(schema));
+			WriteSlot<T>(builder, builder.Allocate(SlotSize<T>(), false), value);
+			return std::move(builder.bytes);
+		}
+
+		template<typename T>
+		static constexpr Kind KindOf() {
+			if constexpr (is_visitable_v<T>) {
+				return Kind::Struct;
+			} else if constexpr (std::is_same_v<T, bool>) {
+				return Kind::Bool;
+			} else if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T> || is_bulk_copyable<T>::value) {
+				return Kind::Raw;
+			} else if constexpr (is_string_v<T>) {
+				return Kind::String;
+			} else if constexpr (is_list_v<T>) {
+				return Kind::List;
+			} else {
+				return Kind::Packed;
+			}
+		}
+
+		template<typename T>
+		static constexpr std::size_t SlotSize() {
+			if constexpr (KindOf<T>() == Kind::Raw) {
+				return sizeof(T);
+			} else if constexpr (KindOf<T>() == Kind::Bool) {
+				return 1;
+			} else if constexpr (KindOf<T>() == Kind::Struct) {
+				return FieldOffset<T, visit_struct::field_count<T>()>();
+			} else {
+				return sizeof(std::uint32_t);
+			}
+		}
+
+		/* Offset of field I in the slot of T, the sum of the slots before it */
+		template<typename T, std::size_t I>
+		static constexpr std::size_t FieldOffset() {
+			if constexpr (I == 0) {
+				return 0;
+			} else {
+				return FieldOffset<T, I - 1>() + SlotSize<visit_struct::type_at<I - 1, T>>();
+			}
+		}
+
+		/* Index of the field Member points to */
+		template<typename T, auto Member, std::size_t I = 0>
+		static constexpr std::size_t MemberIndex() {
+			static_assert(I < visit_struct::field_count<T>(), "Member is not a field of the visitable struct");
+			if constexpr (I >= visit_struct::field_count<T>()) {
+				return I;
+			} else if constexpr (std::is_same_v<decltype(visit_struct::get_pointer<I, T>()), decltype(Member)>) {
+				if constexpr (visit_struct::get_pointer<I, T>() == Member) {
+					return I;
+				} else {
+					return MemberIndex<T, Member, I + 1>();
+				}
+			} else {
+				return MemberIndex<T, Member, I + 1>();
+			}
+		}
+
+		/* What a view returns for a T stored at position: the value for raw types and bools, View for structs, */
+		/* std::string_view for strings, ListView for lists, and a decoded copy for packed types */
+		template<typename T>
+		static auto Load(const std::uint8_t* data, std::size_t size, std::size_t position) {
+			if constexpr (KindOf<T>() == Kind::Raw) {
+				T value;
+				std::memcpy(&value, data + position, sizeof(T));
+				return value;
+			} else if constexpr (KindOf<T>() == Kind::Bool) {
+				return data[position] != 0;
+			} else if constexpr (KindOf<T>() == Kind::Struct) {
+				return View<T>(data, size, position);
+			} else if constexpr (KindOf<T>() == Kind::String) {
+				const std::size_t target = Offset(data, position);
+				const std::size_t length = Length(data, size, target);
+				return std::string_view(length == 0 ? "" : reinterpret_cast<const char*>(data + target + sizeof(std::uint32_t)), length);
+			} else if constexpr (KindOf<T>() == Kind::List) {
+				return ListView<element_t<T>>(data, size, Offset(data, position));
+			} else {
+				T value{};
+				const std::size_t target = Offset(data, position);
+				const std::size_t length = Length(data, size, target);
+				const std::uint8_t* begin = data + target + sizeof(std::uint32_t);
+				const json j = json::from_msgpack(begin, begin + length, true, false);
+				if (!j.is_discarded()) {
+					Deserializer::FromJson(j, value);
+				}
+				return value;
+			}
+		}
+
+		static std::size_t AlignOffset(std::size_t offset) {
+			return (offset + BINARY_ALIGNMENT - 1) / BINARY_ALIGNMENT * BINARY_ALIGNMENT;
+		}
+
+	private: /* Types */
+
+		template<typename T>
+		static constexpr bool is_list_v = std::is_array_v<T> || is_std_array_v<T> || is_std_vector_v<T> ||
+			is_specialization<T, std::deque>::value || is_specialization<T, std::list>::value || is_set_v<T>;
+
+		template<typename T, typename = void>
+		struct element { using type = typename T::value_type; };
+
+		template<typename T>
+		struct element<T, std::enable_if_t<std::is_array_v<T>>> { using type = std::remove_extent_t<T>; };
+
+		template<typename T>
+		using element_t = typename element<T>::type;
+
+		struct Builder {
+			std::vector<std::uint8_t> bytes;
+
+			void Append(const void* data, std::size_t size) {
+				const auto* begin = static_cast<const std::uint8_t*>(data);
+				bytes.insert(bytes.end(), begin, begin + size);
+			}
+
+			/* Adds size zeroed bytes at the end and returns where they start */
+			std::size_t Allocate(std::size_t size, bool aligned) {
+				if (aligned) {
+					bytes.resize(AlignOffset(bytes.size()), 0);
+				}
+				const std::size_t position = bytes.size();
+				bytes.resize(position + size, 0);
+				return position;
+			}
+
+			void Put(std::size_t position, const void* data, std::size_t size) {
+				if (size != 0) std::memcpy(bytes.data() + position, data, size);
+			}
+
+			void Put32(std::size_t position, std::size_t value) {
+				if (value > std::numeric_limits<std::uint32_t>::max()) {
+					Deserializer::HandleError("Value too large for a view buffer", json(value));
+				}
+				const std::uint32_t narrow = static_cast<std::uint32_t>(value);
+				Put(position, &narrow, sizeof(narrow));
+			}
+		};
+
+	private: /* Write */
+
+		/* Fills the slot at position, data that does not fit in the slot is added at the end */
+		template<typename T>
+		static void WriteSlot(Builder& builder, std::size_t position, const T& value) {
+			if constexpr (KindOf<T>() == Kind::Raw) {
+				builder.Put(position, &value, sizeof(T));
+			} else if constexpr (KindOf<T>() == Kind::Bool) {
+				builder.bytes[position] = value ? 1 : 0;
+			} else if constexpr (KindOf<T>() == Kind::Struct) {
+				WriteFields(builder, position, value, std::make_index_sequence<visit_struct::field_count<T>()>{});
+			} else if constexpr (KindOf<T>() == Kind::String) {
+				const std::size_t target = builder.Allocate(sizeof(std::uint32_t) + value.size() + 1, false);
+				builder.Put32(target, value.size());
+				builder.Put(target + sizeof(std::uint32_t), value.data(), value.size());
+				builder.Put32(position, target);
+			} else if constexpr (KindOf<T>() == Kind::List) {
+				using E = element_t<T>;
+				const std::size_t count = std::size(value);
+				const std::size_t target = builder.Allocate(sizeof(std::uint32_t), false);
+				builder.Put32(target, count);
+				const std::size_t elements = builder.Allocate(count * SlotSize<E>(), KindOf<E>() == Kind::Raw);
+				builder.Put32(position, target);
+				if constexpr (KindOf<E>() == Kind::Raw && is_std_vector_v<T>) {
+					builder.Put(elements, value.data(), count * sizeof(E));
+				} else {
+					std::size_t at = elements;
+					for (const auto& item : value) {
+						WriteSlot<E>(builder, at, item);
+						at += SlotSize<E>();
+					}
+				}
+			} else {
+				std::vector<std::uint8_t> packed;
+				json::to_msgpack(Serializer::ToJson(value), packed);
+				const std::size_t target = builder.Allocate(sizeof(std::uint32_t) + packed.size(), false);
+				builder.Put32(target, packed.size());
+				builder.Put(target + sizeof(std::uint32_t), packed.data(), packed.size());
+				builder.Put32(position, target);
+			}
+		}
+
+		template<typename T, std::size_t... I>
+		static void WriteFields(Builder& builder, std::size_t position, const T& value, std::index_sequence<I...>) {
+			(WriteSlot<visit_struct::type_at<I, T>>(builder, position + FieldOffset<T, I>(), visit_struct::get<I>(value)), ...);
+		}
+
+	private: /* Read */
+
+		static std::size_t Offset(const std::uint8_t* data, std::size_t position) {
+			std::uint32_t offset = 0;
+			std::memcpy(&offset, data + position, sizeof(offset));
+			return offset;
+		}
+
+		/* Length of the data at target, 0 if it does not fit in the buffer */
+		static std::size_t Length(const std::uint8_t* data, std::size_t size, std::size_t target) {
+			if (target > size || size - target < sizeof(std::uint32_t)) {
+				return 0;
+			}
+			std::uint32_t length = 0;
+			std::memcpy(&length, data + target, sizeof(length));
+			return length <= size - target - sizeof(std::uint32_t) ? length : 0;
+		}
+	};
+
+	/* Read-only access to a T inside a buffer written by ViewFormat::Write, without deserializing it. */
+	/* A field is read from its constant offset, view.Get<&Weapon::damage>() costs a memcpy of the int. */
+	/* The view points into the buffer, which has to outlive it. Offsets are checked against the buffer when followed */
+	template<typename T>
+	class View {
+		static_assert(is_visitable_v<T>, "View needs a visitable struct");
+
+	public:
+		View() = default;
+
+		View(const std::uint8_t* data, std::size_t size, std::size_t position) : data(data), size(size), position(position) {}
+
+		/* The root of a buffer written by ViewFormat::Write. A buffer that is not one for T is reported */
+		/* through Deserializer::HandleError and gives an invalid view */
+		static View Open(const void* buffer, std::size_t length) {
+			const auto* bytes = static_cast<const std::uint8_t*>(buffer);
+			if (length < VIEW_HEADER_SIZE + ViewFormat::SlotSize<T>() || std::memcmp(bytes, VIEW_MAGIC, sizeof(VIEW_MAGIC)) != 0) {
+				Deserializer::HandleError("Not a view buffer", json(length));
+				return View();
+			}
+			std::uint64_t schema = 0;
+			std::memcpy(&schema, bytes + 8, sizeof(schema));
+			if (bytes[4] != VIEW_VERSION || bytes[5] != NativeByteOrder() || schema != Binary::SchemaHash<T>()) {
+				Deserializer::HandleError("View buffer version, byte order or schema does not match the type", json(schema));
+				return View();
+			}
+			return View(bytes, length, VIEW_HEADER_SIZE);
+		}
+
+		static View Open(const std::vector<std::uint8_t>& bytes) {
+			return Open(bytes.data(), bytes.size());
+		}
+
+		bool IsValid() const {
+			return data != nullptr;
+		}
+
+		explicit operator bool() const {
+			return IsValid();
+		}
+
+		/* The field Member points to, for example view.Get<&Weapon::name>() */
+		template<auto Member>
+		auto Get() const {
+			return At<ViewFormat::MemberIndex<T, Member>()>();
+		}
+
+		/* Field I in VISITABLE_STRUCT order. An invalid view, which Open returns when errors do not throw, */
+		/* gives a default value: 0, an empty string or list, or another invalid view */
+		template<std::size_t I>
+		auto At() const {
+			using Result = decltype(ViewFormat::Load<visit_struct::type_at<I, T>>(data, size, position));
+			if (!IsValid()) {
+				return Result{};
+			}
+			return ViewFormat::Load<visit_struct::type_at<I, T>>(data, size, position + ViewFormat::FieldOffset<T, I>());
+		}
+
+	private:
+		const std::uint8_t* data = nullptr;
+		std::size_t size = 0;
+		std::size_t position = 0;
+	};
+
+	/* Read-only access to a list of E, elements are read the same way fields are */
+	template<typename E>
+	class ListView {
+	public:
+		class Iterator {
+		public:
+			Iterator(const ListView* list, std::size_t index) : list(list), index(index) {}
+
+			auto operator*() const {
+				return (*list)[index];
+			}
+
+			Iterator& operator++() {
+				++index;
+				return *this;
+			}
+
+			bool operator==(const Iterator& other) const {
+				return index == other.index;
+			}
+
+			bool operator!=(const Iterator& other) const {
+				return index != other.index;
+			}
+
+		private:
+			const ListView* list;
+			std::size_t index;
+		};
+
+		ListView() = default;
+
+		/* An offset or count that does not fit in the buffer gives an empty list */
+		ListView(const std::uint8_t* data, std::size_t size, std::size_t offset) : data(data) {
+			if (offset > size || size - offset < sizeof(std::uint32_t)) {
+				return;
+			}
+			std::uint32_t length = 0;
+			std::memcpy(&length, data + offset, sizeof(length));
+			const std::size_t begin = ViewFormat::KindOf<E>() == ViewFormat::Kind::Raw ? ViewFormat::AlignOffset(offset + sizeof(std::uint32_t)) : offset + sizeof(std::uint32_t);
+			constexpr std::size_t slot = ViewFormat::SlotSize<E>();
+			if (begin > size || (slot != 0 && length > (size - begin) / slot)) {
+				return;
+			}
+			this->size = size;
+			start = begin;
+			count = length;
+		}
+
+		std::size_t Size() const {
+			return count;
+		}
+
+		bool Empty() const {
+			return count == 0;
+		}
+
+		/* Not bounds checked, like std::vector */
+		auto operator[](std::size_t index) const {
+			return ViewFormat::Load<E>(data, size, start + index * ViewFormat::SlotSize<E>());
+		}
+
+		/* The elements in place, only for raw elements. Aligned if the buffer is 16 byte aligned, as vectors and mappings are */
+		const E* Data() const {
+			static_assert(ViewFormat::KindOf<E>() == ViewFormat::Kind::Raw, "Data is only available for raw elements");
+			return reinterpret_cast<const E*>(data + start);
+		}
+
+		Iterator begin() const {
+			return Iterator(this, 0);
+		}
+
+		Iterator end() const {
+			return Iterator(this, count);
+		}
+
+	private:
+		const std::uint8_t* data = nullptr;
+		std::size_t size = 0;
+		std::size_t start = 0;
+		std::size_t count = 0;
+	};
+
+	/* Writes value as a view buffer, returns false if the file could not be written */
+	template<typename T>
+	bool WriteViewFile(const std::string& path, const T& value) {
+		const auto bytes = ViewFormat::Write(value);
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+		return static_cast<bool>(file);
+	}
+}
@@ -0,0 +1,145 @@
+﻿#pragma once
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "svh/serializer.hpp"
+#include "svh/archive.hpp"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace archive_tests {
+
+	static std::wstring to_wstring(const std::string& s) {
+		return std::wstring(s.begin(), s.end());
+	}
+
+	TEST_CLASS(Archive) {
+public:
+	TEST_METHOD(LazyDecoding) {
+		auto path = TempPath("lazy", ".svha");
+		svh::ArchiveWriter writer;
+		writer.Add("units/soldier", MakeLoadout("soldier", 5));
+		writer.Add("units/captain", MakeLoadout("captain", 8));
+		writer.Add("items/medkit", MakeLoadout("medkit", 0));
+		Assert::IsTrue(writer.Save(path));
+
+		svh::PrefabArchive archive;
+		Assert::IsTrue(archive.Open(path));
+		Assert::AreEqual(size_t(3), archive.Size());
+		Assert::AreEqual(size_t(0), archive.DecodedCount());
+		Assert::AreEqual(to_wstring("items/medkit"), to_wstring(archive.Ids()[0]));
+		Assert::IsTrue(archive.Contains("units/captain"));
+		Assert::IsFalse(archive.Contains("units/general"));
+
+		auto captain = archive.Get<Loadout>("units/captain");
+		Assert::AreEqual(8, captain->weapons[0].damage);
+		Assert::IsTrue(archive.IsDecoded("units/captain"));
+		Assert::IsFalse(archive.IsDecoded("units/soldier"));
+		Assert::IsTrue(captain == archive.Get<Loadout>("units/captain"));
+		Assert::IsTrue(archive.Get<Loadout>("units/general") == nullptr);
+
+		/* Released objects stay valid for their holders */
+		archive.Release("units/captain");
+		Assert::AreEqual(size_t(0), archive.DecodedCount());
+		Assert::AreEqual(to_wstring("captain"), to_wstring(captain->name));
+		Assert::IsFalse(captain == archive.Get<Loadout>("units/captain"));
+
+		archive.Close();
+		std::filesystem::remove(path);
+	}
+
+	TEST_METHOD(EntryBytes) {
+		auto path = TempPath("bytes", ".svha");
+		svh::ArchiveWriter writer;
+		writer.Add("a", MakeLoadout("a", 1));
+		writer.Add("b", MakeLoadout("b", 2));
+		writer.Save(path);
+
+		svh::PrefabArchive archive;
+		archive.Open(path);
+		std::size_t length = 0;
+		const std::uint8_t* bytes = archive.Bytes("b", length);
+		Assert::IsTrue(svh::IsBinary(bytes, length));
+		Assert::AreEqual(size_t(0), reinterpret_cast<std::uintptr_t>(bytes) % svh::BINARY_ALIGNMENT);
+		Loadout b;
+		Assert::IsTrue(svh::Binary::Read(bytes, length, b));
+		Assert::AreEqual(2, b.weapons[0].damage);
+		archive.Close();
+		std::filesystem::remove(path);
+	}
+
+	TEST_METHOD(Errors) {
+		auto path = TempPath("errors", ".svha");
+		svh::ArchiveWriter writer;
+		writer.Add("weapon", Weapon{ "rifle", 5 });
+		Assert::IsFalse(writer.AddBinary("text", { '{', '}' }));
+		writer.Save(path);
+
+		svh::PrefabArchive archive;
+		Assert::IsTrue(archive.Open(path));
+		bool thrown = false;
+		try {
+			archive.Get<Loadout>("weapon");
+		} catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		Assert::IsTrue(thrown);
+		Assert::AreEqual(5, archive.Get<Weapon>("weapon")->damage);
+		archive.Close();
+
+		std::ofstream(path, std::ios::trunc) << "{ \"name\": \"soldier\" }";
+		Assert::IsFalse(archive.Open(path));
+		Assert::IsFalse(archive.Open(TempPath("missing", ".svha")));
+		std::filesystem::remove(path);
+	}
+
+	TEST_METHOD(PackDirectory) {
+		auto directory = std::filesystem::temp_directory_path() / "svh_pack";
+		auto path = TempPath("pack", ".svha");
+		std::filesystem::create_directories(directory / "units");
+		svh::WriteBinaryFile((directory / "units" / "soldier.prefab").string(), MakeLoadout("soldier", 5));
+		svh::WriteBinaryFile((directory / "medkit.prefab").string(), MakeLoadout("medkit", 0));
+		std::ofstream(directory / "notes.txt") << "skipped";
+
+		Assert::AreEqual(size_t(2), svh::PackArchive(directory, path));
+		svh::PrefabArchive archive;
+		archive.Open(path);
+		Assert::AreEqual(5, archive.Get<Loadout>("units/soldier")->weapons[0].damage);
+		archive.Close();
+		std::filesystem::remove_all(directory);
+		std::filesystem::remove(path);
+	}
+
+	/* Opening does not depend on the size of the archive */
+	TEST_METHOD(OpenTime) {
+		auto path = TempPath("open_time", ".svha");
+		svh::ArchiveWriter writer;
+		constexpr int count = 20000;
+		for (int i = 0; i < count; ++i) {
+			Loadout loadout = MakeLoadout("unit " + std::to_string(i), i);
+			loadout.stats.assign(256, i);
+			writer.Add("units/" + std::to_string(i), loadout);
+		}
+		writer.Save(path);
+
+		svh::PrefabArchive archive;
+		auto start = std::chrono::high_resolution_clock::now();
+		Assert::IsTrue(archive.Open(path));
+		auto opened = std::chrono::high_resolution_clock::now();
+		auto unit = archive.Get<Loadout>("units/12345");
+		auto end = std::chrono::high_resolution_clock::now();
+		Assert::AreEqual(12345, unit->stats[255]);
+		Assert::AreEqual(size_t(1), archive.DecodedCount());
+
+		std::wstring message = L"Archive of " + std::to_wstring(count) + L" prefabs (" + std::to_wstring(std::filesystem::file_size(path) / 1024 / 1024) + L" MB) opened in " + std::to_wstring(std::chrono::duration<double, std::micro>(opened - start).count()) + L" us, first entry decoded in " + std::to_wstring(std::chrono::duration<double, std::micro>(end - opened).count()) + L" us";
+		Logger::WriteMessage(message.c_str());
+		archive.Close();
+		std::filesystem::remove(path);
+	}
+	};
+}
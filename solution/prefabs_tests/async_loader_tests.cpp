@@ -0,0 +1,183 @@
+﻿#pragma once
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "svh/serializer.hpp"
+#include "svh/async_loader.hpp"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+#include <atomic>
+#include <future>
+#include <mutex>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace async_loader_tests {
+
+	static std::wstring to_wstring(const std::string& s) {
+		return std::wstring(s.begin(), s.end());
+	}
+
+	static Loadout MakePrefab(int i) {
+		Loadout prefab;
+		prefab.name = "prefab " + std::to_string(i);
+		for (int s = 0; s < 200; ++s) {
+			prefab.stats.push_back(i * s);
+		}
+		for (int w = 0; w < 20; ++w) {
+			prefab.weapons.push_back({ "weapon " + std::to_string(w), i + w });
+		}
+		prefab.slots = { { 0, "head" }, { 1, "chest" } };
+		return prefab;
+	}
+
+	static void WriteFile(const std::string& path, const Loadout& value) {
+		std::ofstream file(path, std::ios::trunc);
+		file << svh::Serializer::ToJson(value).dump(1, '\t');
+	}
+
+	/* Keeps the only worker of a pool busy until Release */
+	class Blocker {
+	public:
+		explicit Blocker(svh::LoadPool& pool) {
+			auto future = release.get_future().share();
+			pool.Submit(1000, [future]() { future.wait(); });
+		}
+		void Release() { release.set_value(); }
+	private:
+		std::promise<void> release;
+	};
+
+	TEST_CLASS(AsyncLoader) {
+public:
+	TEST_METHOD(LoadManyAsync) {
+		std::vector<std::string> paths;
+		for (int i = 0; i < 20; ++i) {
+			paths.push_back(TempPath("async_many_" + std::to_string(i), ".json"));
+			WriteFile(paths.back(), MakePrefab(i));
+		}
+		auto futures = svh::LoadManyAsync<Loadout>(paths);
+		for (int i = 0; i < 20; ++i) {
+			Loadout loaded = futures[i].get();
+			Assert::IsTrue(svh::Compare::GetChanges(MakePrefab(i), loaded).empty());
+			std::filesystem::remove(paths[i]);
+		}
+	}
+
+	TEST_METHOD(MissingFile) {
+		auto future = svh::LoadAsync<Loadout>(TempPath("async_does_not_exist", ".json"));
+		bool thrown = false;
+		try {
+			future.get();
+		} catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		Assert::IsTrue(thrown);
+	}
+
+	TEST_METHOD(PriorityOrder) {
+		svh::LoadPool pool(1);
+		Blocker blocker(pool);
+		std::vector<int> order;
+		std::mutex mutex;
+		for (int priority : { 0, 2, 1, 2 }) {
+			pool.Submit(priority, [&, priority]() {
+				std::lock_guard<std::mutex> lock(mutex);
+				order.push_back(priority);
+			});
+		}
+		std::promise<void> done;
+		pool.Submit(-1, [&]() { done.set_value(); });
+		blocker.Release();
+		done.get_future().wait();
+		Assert::AreEqual(to_wstring("2 2 1 0"), to_wstring(std::to_string(order[0]) + " " + std::to_string(order[1]) + " " + std::to_string(order[2]) + " " + std::to_string(order[3])));
+	}
+
+	TEST_METHOD(Cancel) {
+		auto path = TempPath("async_cancel", ".json");
+		WriteFile(path, MakePrefab(1));
+		svh::LoadPool pool(1);
+		svh::AsyncLoader<Loadout> loader(pool);
+		Blocker blocker(pool);
+		svh::CancelToken token;
+		auto future = loader.Load(path, 0, token);
+		token.Cancel();
+		blocker.Release();
+
+		bool cancelled = false;
+		try {
+			future.get();
+		} catch (const svh::LoadCancelled&) {
+			cancelled = true;
+		}
+		Assert::IsTrue(cancelled);
+		/* Loaded again after a cancel */
+		Assert::AreEqual(to_wstring("prefab 1"), to_wstring(loader.Load(path).get().name));
+		std::filesystem::remove(path);
+	}
+
+	TEST_METHOD(PrefetchReferences) {
+		/* The name of a prefab is the path of the prefab it references */
+		auto parent = TempPath("async_prefetch_parent", ".json");
+		auto child = TempPath("async_prefetch_child", ".json");
+		Loadout parent_prefab = MakePrefab(1);
+		parent_prefab.name = child;
+		WriteFile(parent, parent_prefab);
+		WriteFile(child, MakePrefab(2));
+
+		std::atomic<int> parsed{ 0 };
+		svh::AsyncLoader<Loadout> loader;
+		loader.SetReferences([&](const svh::json& j) {
+			++parsed;
+			std::vector<std::string> paths;
+			if (j.contains("name") && j["name"].get<std::string>() == child) {
+				paths.push_back(child);
+			}
+			return paths;
+		});
+		loader.Load(parent).wait();
+		/* Queued when the parent was parsed, the request below shares that load */
+		auto future = loader.Load(child);
+		Assert::AreEqual(to_wstring("prefab 2"), to_wstring(future.get().name));
+		Assert::AreEqual(2, parsed.load());
+		std::filesystem::remove(parent);
+		std::filesystem::remove(child);
+	}
+
+	/* Level load: serial loop against LoadManyAsync on the default pool */
+	TEST_METHOD(LevelLoadTime) {
+		const int count = 300;
+		std::vector<std::string> paths;
+		for (int i = 0; i < count; ++i) {
+			paths.push_back(TempPath("async_level_" + std::to_string(i), ".json"));
+			WriteFile(paths.back(), MakePrefab(i));
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		std::vector<Loadout> serial(count);
+		for (int i = 0; i < count; ++i) {
+			svh::Deserializer::FromJson(svh::ReadPrefabFile(paths[i]), serial[i]);
+		}
+		auto serial_end = std::chrono::steady_clock::now();
+
+		auto futures = svh::LoadManyAsync<Loadout>(paths);
+		std::vector<Loadout> parallel;
+		for (auto& future : futures) {
+			parallel.push_back(future.get());
+		}
+		auto parallel_end = std::chrono::steady_clock::now();
+
+		Assert::IsTrue(svh::Compare::GetChanges(serial[count - 1], parallel[count - 1]).empty());
+		auto serial_ms = std::chrono::duration_cast<std::chrono::milliseconds>(serial_end - start).count();
+		auto parallel_ms = std::chrono::duration_cast<std::chrono::milliseconds>(parallel_end - serial_end).count();
+		std::wstring message = L"300 files, serial: " + std::to_wstring(serial_ms) + L" ms, async on " + std::to_wstring(svh::DefaultLoadPool().ThreadCount()) + L" threads: " + std::to_wstring(parallel_ms) + L" ms\n";
+		Logger::WriteMessage(message.c_str());
+		for (const auto& path : paths) {
+			std::filesystem::remove(path);
+		}
+	}
+	};
+}
@@ -0,0 +1,204 @@
+﻿#pragma once
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "svh/serializer.hpp"
+#include "svh/binary.hpp"
+
+#include <vector>
+#include <string>
+#include <array>
+#include <chrono>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+template<>
+struct svh::is_bulk_copyable<glm::vec3> : std::true_type {};
+
+namespace binary_tests {
+
+	static std::wstring to_wstring(const std::string& s) {
+		return std::wstring(s.begin(), s.end());
+	}
+
+	struct Vertex {
+		float position[3];
+		float uv[2];
+		int material;
+	};
+
+	struct Mesh {
+		std::string name;
+		std::vector<Vertex> vertices;
+		std::vector<std::uint32_t> indices;
+		std::array<int, 4> lods;
+		std::vector<glm::vec3> normals;
+		std::vector<bool> visible;
+		std::optional<Transform> pivot;
+	};
+
+	/* Same fields as Mesh with another type for indices */
+	struct WideMesh {
+		std::string name;
+		std::vector<Vertex> vertices;
+		std::vector<std::uint64_t> indices;
+		std::array<int, 4> lods;
+		std::vector<glm::vec3> normals;
+		std::vector<bool> visible;
+		std::optional<Transform> pivot;
+	};
+
+	static Mesh MakeMesh(std::size_t count) {
+		Mesh mesh;
+		mesh.name = "rock";
+		for (std::size_t i = 0; i < count; ++i) {
+			const float f = static_cast<float>(i);
+			mesh.vertices.push_back({ { f, f + 1, f + 2 }, { f / 2, f / 3 }, static_cast<int>(i % 4) });
+			mesh.indices.push_back(static_cast<std::uint32_t>(i));
+			mesh.normals.push_back(glm::vec3(0.0f, 1.0f, f));
+		}
+		mesh.lods = { 100, 50, 25, 10 };
+		mesh.visible = { true, false, true };
+		return mesh;
+	}
+
+	/* True if Read reports an error */
+	template<typename Bytes, typename T>
+	static bool Rejects(const Bytes& bytes, T& value) {
+		try {
+			return !svh::Binary::Read(bytes, value);
+		} catch (const std::runtime_error&) {
+			return true;
+		}
+	}
+}
+
+VISITABLE_STRUCT(binary_tests::Vertex, position, uv, material);
+VISITABLE_STRUCT(binary_tests::Mesh, name, vertices, indices, lods, normals, visible, pivot);
+VISITABLE_STRUCT(binary_tests::WideMesh, name, vertices, indices, lods, normals, visible, pivot);
+
+namespace binary_tests {
+
+	TEST_CLASS(Binary) {
+public:
+	TEST_METHOD(RoundTrip) {
+		Loadout loadout;
+		loadout.name = "soldier";
+		loadout.stats = { 1, 2, 3 };
+		loadout.weapons = { { "rifle", 5 }, { "knife", 2 } };
+		loadout.slots = { { 0, "head" } };
+		loadout.upgrades = { { "armor", { 1, 2 } } };
+		loadout.holder = std::make_shared<ItemHolder>();
+
+		auto bytes = svh::Binary::Write(loadout);
+		Assert::IsTrue(svh::IsBinary(bytes.data(), bytes.size()));
+		Loadout result;
+		Assert::IsTrue(svh::Binary::Read(bytes, result));
+		Assert::IsTrue(svh::Compare::GetChanges(loadout, result).empty());
+		Assert::IsTrue(static_cast<bool>(result.holder));
+
+		loadout.holder.reset();
+		Assert::IsTrue(svh::Binary::Read(svh::Binary::Write(loadout), result));
+		Assert::IsFalse(static_cast<bool>(result.holder));
+	}
+
+	TEST_METHOD(BulkTypes) {
+		Assert::IsTrue(svh::Binary::IsBulk<Vertex>());
+		Assert::IsTrue(svh::Binary::IsBulk<std::array<int, 4>>());
+		Assert::IsTrue(svh::Binary::IsBulk<glm::vec3>());
+		Assert::IsFalse(svh::Binary::IsBulk<bool>());
+		Assert::IsFalse(svh::Binary::IsBulk<Weapon>());
+
+		Mesh mesh = MakeMesh(100);
+		mesh.pivot = Transform();
+		mesh.pivot->position = glm::vec3(1.0f, 2.0f, 3.0f);
+		Mesh result;
+		Assert::IsTrue(svh::Binary::Read(svh::Binary::Write(mesh), result));
+		Assert::IsTrue(svh::Serializer::ToJson(mesh) == svh::Serializer::ToJson(result));
+		Assert::AreEqual(3.0f, result.pivot->position.z);
+		Assert::AreEqual(99.0f, result.normals[99].z);
+	}
+
+	TEST_METHOD(SchemaHash) {
+		constexpr auto hash = svh::Binary::SchemaHash<Mesh>();
+		static_assert(hash != svh::Binary::SchemaHash<WideMesh>(), "field types are part of the schema");
+		static_assert(svh::Binary::SchemaHash<Skill>() != svh::Binary::SchemaHash<SkillTree>(), "recursive structs are hashed");
+		Assert::IsTrue(hash != 0);
+
+		auto bytes = svh::Binary::Write(MakeMesh(4));
+		WideMesh wide;
+		Assert::IsTrue(Rejects(bytes, wide));
+	}
+
+	TEST_METHOD(CorruptData) {
+		auto bytes = svh::Binary::Write(MakeMesh(16));
+		Mesh result;
+		bytes.resize(bytes.size() / 2);
+		Assert::IsTrue(Rejects(bytes, result));
+		/* A string index past the end of the table */
+		std::vector<Inventory> scene(1);
+		scene[0].items = { "torch" };
+		auto interned = svh::Binary::Write(scene, svh::StringTable::KeysAndValues);
+		/* The varint index of "torch" comes right before the uint32 counts of ammo and misc */
+		Assert::AreEqual(0, static_cast<int>(interned[interned.size() - 9]));
+		interned[interned.size() - 9] = 0x7f;
+		std::vector<Inventory> scene_result;
+		Assert::IsTrue(Rejects(interned, scene_result));
+
+		std::string text = "{ \"name\": \"rock\" }";
+		Assert::IsTrue(Rejects(text, result));
+	}
+
+	TEST_METHOD(StringTable) {
+		std::vector<Inventory> scene(2000);
+		const std::vector<std::string> names = { "health potion", "mana potion", "iron sword", "leather armor", "torch" };
+		for (std::size_t i = 0; i < scene.size(); ++i) {
+			scene[i].items = { names[i % 5], names[(i + 1) % 5], names[(i + 3) % 5] };
+			scene[i].ammo = { { "arrows", static_cast<int>(i) }, { "bolts", 3 } };
+			scene[i].misc = { "key " + std::to_string(i % 10) };
+		}
+
+		auto none = svh::Binary::Write(scene, svh::StringTable::None);
+		auto keys = svh::Binary::Write(scene, svh::StringTable::Keys);
+		auto all = svh::Binary::Write(scene, svh::StringTable::KeysAndValues);
+		Assert::IsTrue(keys.size() < none.size());
+		Assert::IsTrue(all.size() < keys.size());
+
+		for (const auto* bytes : { &none, &keys, &all }) {
+			std::vector<Inventory> result;
+			Assert::IsTrue(svh::Binary::Read(*bytes, result));
+			Assert::IsTrue(svh::Serializer::ToJson(scene) == svh::Serializer::ToJson(result));
+		}
+
+		/* A raw block after the table is still aligned */
+		Mesh mesh = MakeMesh(8);
+		mesh.name = "table";
+		auto mesh_bytes = svh::Binary::Write(mesh, svh::StringTable::KeysAndValues);
+		Mesh mesh_result;
+		Assert::IsTrue(svh::Binary::Read(mesh_bytes, mesh_result));
+		Assert::AreEqual(to_wstring("table"), to_wstring(mesh_result.name));
+
+		std::wstring message = L"2000 inventories: json " + std::to_wstring(svh::Serializer::ToJson(scene).dump().size()) + L" bytes, binary " + std::to_wstring(none.size()) + L" bytes, interned keys " + std::to_wstring(keys.size()) + L" bytes, interned keys and values " + std::to_wstring(all.size()) + L" bytes";
+		Logger::WriteMessage(message.c_str());
+	}
+
+	TEST_METHOD(LoadSpeed) {
+		Mesh mesh = MakeMesh(200000);
+		auto bytes = svh::Binary::Write(mesh);
+		auto packed = svh::json::to_msgpack(svh::Serializer::ToJson(mesh));
+
+		Mesh binary;
+		auto start = std::chrono::high_resolution_clock::now();
+		svh::Binary::Read(bytes, binary);
+		auto mid = std::chrono::high_resolution_clock::now();
+		Mesh decoded;
+		svh::Deserializer::FromJson(svh::json::from_msgpack(packed), decoded);
+		auto end = std::chrono::high_resolution_clock::now();
+		Assert::AreEqual(mesh.vertices.size(), binary.vertices.size());
+
+		const double binary_ms = std::chrono::duration<double, std::milli>(mid - start).count();
+		const double msgpack_ms = std::chrono::duration<double, std::milli>(end - mid).count();
+		std::wstring message = L"200k vertices: binary " + std::to_wstring(bytes.size() / 1024 / 1024) + L" MB in " + std::to_wstring(binary_ms) + L" ms (" + std::to_wstring(bytes.size() / 1048576.0 / (binary_ms / 1000.0)) + L" MB/s), MessagePack " + std::to_wstring(packed.size() / 1024 / 1024) + L" MB in " + std::to_wstring(msgpack_ms) + L" ms";
+		Logger::WriteMessage(message.c_str());
+	}
+	};
+}
@@ -1628,6 +1628,18 @@ public:
 		CheckCompare(mm, mm2, expected);
 		CheckOverwrite(mm, mm2);
 	}
+	TEST_METHOD(IntMap_Changed) {
+		std::map<int, int> A{ {1,1},{2,2},{-3,3} };
+		std::map<int, int> B{ {1,5},{-3,3},{40,4} };
+		//{"removed":[2],"changed":[{"1":5}],"added":[{"40":4}]}
+		svh::json expected = {
+			{ svh::REMOVED, svh::json::array({ 2 }) },
+			{ svh::CHANGED_VALUES, svh::json::array({ svh::json::object({ { "1", 5 } }) }) },
+			{ svh::ADDED_VALUES, svh::json::array({ svh::json::object({ { "40", 4 } }) }) }
+		};
+		CheckCompare(A, B, expected);
+		CheckOverwrite(A, B);
+	}
 
 	/* Unordered map*/
 	TEST_METHOD(UnorderedMap_Unchanged) {
@@ -0,0 +1,221 @@
+﻿#pragma once
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "svh/serializer.hpp"
+#include "svh/cook.hpp"
+#include "svh/async_loader.hpp"
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <iterator>
+#include <fstream>
+#include <filesystem>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace cook_tests {
+
+	static std::wstring to_wstring(const std::string& s) {
+		return std::wstring(s.begin(), s.end());
+	}
+
+	static void WriteText(const std::filesystem::path& path, const std::string& text) {
+		std::filesystem::create_directories(path.parent_path());
+		std::ofstream(path, std::ios::trunc) << text;
+	}
+
+	static void WriteBase(const std::filesystem::path& path, const Loadout& value) {
+		WriteText(path, svh::Serializer::ToJson(value).dump(1, '\t'));
+	}
+
+	static void WriteOverride(const std::filesystem::path& path, const std::string& parent, const Loadout& parent_value, const Loadout& value) {
+		svh::json j;
+		j[svh::PREFAB_PARENT] = parent;
+		j[svh::PREFAB_PATCH] = svh::Compare::GetChanges(parent_value, value);
+		WriteText(path, j.dump(1, '\t'));
+	}
+
+	static Loadout ReadCooked(const std::filesystem::path& path) {
+		Loadout value;
+		svh::Deserializer::FromJson(svh::ReadPrefabFile(path.string()), value);
+		return value;
+	}
+
+	/* soldier <- captain <- general, and an unrelated medic */
+	struct CookDirectory {
+		std::filesystem::path input = std::filesystem::temp_directory_path() / "svh_cook_input";
+		std::filesystem::path output = std::filesystem::temp_directory_path() / "svh_cook_output";
+		Loadout soldier = MakeLoadout("soldier");
+		Loadout captain = soldier;
+		Loadout general = soldier;
+
+		CookDirectory() {
+			std::filesystem::remove_all(input);
+			std::filesystem::remove_all(output);
+			captain.name = "captain";
+			captain.stats.push_back(40);
+			general = captain;
+			general.slots[1] = "medal";
+			WriteBase(input / "soldier.json", soldier);
+			WriteOverride(input / "ranks" / "captain.json", "soldier", soldier, captain);
+			WriteOverride(input / "ranks" / "general.json", "ranks/captain", captain, general);
+			WriteBase(input / "medic.json", MakeLoadout("medic"));
+		}
+
+		~CookDirectory() {
+			std::filesystem::remove_all(input);
+			std::filesystem::remove_all(output);
+		}
+	};
+
+	TEST_CLASS(Cook) {
+public:
+	TEST_METHOD(FlattensInheritance) {
+		CookDirectory directory;
+		svh::PrefabCooker<Loadout> cooker(directory.input, directory.output, 2);
+		auto report = cooker.Cook();
+		Assert::AreEqual(size_t(0), report.errors.size());
+		Assert::AreEqual(size_t(4), report.cooked);
+
+		Loadout general = ReadCooked(cooker.OutputPath("ranks/general"));
+		Assert::IsTrue(svh::Compare::GetChanges(directory.general, general).empty());
+
+		std::ifstream file(cooker.OutputPath("soldier"), std::ios::binary);
+		std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		Assert::IsTrue(svh::IsCooked(content));
+		Assert::IsTrue(std::filesystem::exists(directory.output / svh::COOK_MANIFEST));
+	}
+
+	TEST_METHOD(Incremental) {
+		CookDirectory directory;
+		svh::PrefabCooker<Loadout> cooker(directory.input, directory.output);
+		cooker.Cook();
+
+		auto report = cooker.Cook();
+		Assert::AreEqual(size_t(0), report.cooked);
+		Assert::AreEqual(size_t(4), report.skipped);
+
+		/* A parent change cooks its dependents again, medic is untouched */
+		directory.soldier.weapons[0].damage = 9;
+		WriteBase(directory.input / "soldier.json", directory.soldier);
+		report = cooker.Cook();
+		Assert::AreEqual(size_t(3), report.cooked);
+		Assert::AreEqual(size_t(1), report.skipped);
+		Assert::AreEqual(9, ReadCooked(cooker.OutputPath("ranks/general")).weapons[0].damage);
+
+		report = cooker.Cook(true);
+		Assert::AreEqual(size_t(4), report.cooked);
+	}
+
+	TEST_METHOD(RemovedInput) {
+		CookDirectory directory;
+		svh::PrefabCooker<Loadout> cooker(directory.input, directory.output);
+		cooker.Cook();
+		std::filesystem::remove(directory.input / "medic.json");
+		auto report = cooker.Cook();
+		Assert::AreEqual(size_t(1), report.removed);
+		Assert::IsFalse(std::filesystem::exists(cooker.OutputPath("medic")));
+	}
+
+	TEST_METHOD(Errors) {
+		CookDirectory directory;
+		WriteText(directory.input / "orphan.json", R"({ "$parent": "missing", "$patch": {} })");
+		WriteText(directory.input / "broken.json", "{ \"name\": ");
+		svh::PrefabCooker<Loadout> cooker(directory.input, directory.output);
+		auto report = cooker.Cook();
+		Assert::AreEqual(size_t(2), report.errors.size());
+		Assert::AreEqual(size_t(4), report.cooked);
+
+		/* Failed prefabs are not in the manifest, so they are tried again */
+		report = cooker.Cook();
+		Assert::AreEqual(size_t(2), report.errors.size());
+	}
+
+	TEST_METHOD(MalformedParent) {
+		CookDirectory directory;
+		WriteText(directory.input / "numbered.json", R"({ "$parent": 5, "$patch": {} })");
+		svh::PrefabCooker<Loadout> cooker(directory.input, directory.output);
+		auto report = cooker.Cook();
+		Assert::AreEqual(size_t(1), report.errors.size());
+		Assert::AreEqual(to_wstring("numbered: $parent must be a string"), to_wstring(report.errors[0]));
+		Assert::AreEqual(size_t(4), report.cooked);
+		Assert::IsTrue(std::filesystem::exists(directory.output / svh::COOK_MANIFEST));
+	}
+
+	TEST_METHOD(MalformedPatch) {
+		CookDirectory directory;
+		WriteText(directory.input / "mistyped.json", R"({ "$parent": "soldier", "$patch": { "name": 7 } })");
+		WriteText(directory.input / "derived.json", R"({ "$parent": "mistyped", "$patch": {} })");
+		svh::PrefabCooker<Loadout> cooker(directory.input, directory.output, 2);
+		auto report = cooker.Cook();
+		/* The prefab with the bad patch and the one derived from it fail, the others are cooked */
+		Assert::AreEqual(size_t(2), report.errors.size());
+		Assert::AreEqual(size_t(4), report.cooked);
+		Assert::IsFalse(std::filesystem::exists(cooker.OutputPath("mistyped")));
+		Assert::IsTrue(std::filesystem::exists(directory.output / svh::COOK_MANIFEST));
+	}
+
+	TEST_METHOD(CommandLine) {
+		CookDirectory directory;
+		std::string input = directory.input.string();
+		std::string output = directory.output.string();
+		std::string name = "cook", threads = "--threads", count = "2", bad = "abc";
+		char* valid[] = { name.data(), input.data(), output.data(), threads.data(), count.data() };
+		Assert::AreEqual(0, svh::CookMain<Loadout>(5, valid));
+
+		/* A bad thread count prints the usage instead of throwing */
+		char* invalid[] = { name.data(), input.data(), output.data(), threads.data(), bad.data() };
+		Assert::AreEqual(2, svh::CookMain<Loadout>(5, invalid));
+	}
+
+	TEST_METHOD(CookSpeed) {
+		CookDirectory directory;
+		constexpr int count = 500;
+		for (int i = 0; i < count; ++i) {
+			Loadout variant = directory.soldier;
+			variant.name = "variant " + std::to_string(i);
+			variant.upgrades["level"] = { i };
+			WriteOverride(directory.input / "variants" / (std::to_string(i) + ".json"), "soldier", directory.soldier, variant);
+		}
+		svh::PrefabCooker<Loadout> cooker(directory.input, directory.output);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		auto report = cooker.Cook();
+		auto mid = std::chrono::high_resolution_clock::now();
+		auto again = cooker.Cook();
+		auto end = std::chrono::high_resolution_clock::now();
+		Assert::AreEqual(size_t(count + 4), report.cooked);
+		Assert::AreEqual(size_t(count + 4), again.skipped);
+
+		std::wstring message = L"Cooked " + std::to_wstring(count + 4) + L" prefabs in " + std::to_wstring(std::chrono::duration<double, std::milli>(mid - start).count()) + L" ms, up to date check in " + std::to_wstring(std::chrono::duration<double, std::milli>(end - mid).count()) + L" ms";
+		Logger::WriteMessage(message.c_str());
+	}
+
+	TEST_METHOD(BinaryFormat) {
+		CookDirectory directory;
+		svh::PrefabCooker<Loadout> cooker(directory.input, directory.output, 0, svh::CookFormat::Binary);
+		Assert::AreEqual(size_t(4), cooker.Cook().cooked);
+
+		std::ifstream file(cooker.OutputPath("ranks/general"), std::ios::binary);
+		std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		Assert::IsTrue(svh::IsBinary(content));
+		Loadout general = svh::LoadAsync<Loadout>(cooker.OutputPath("ranks/general").string()).get();
+		Assert::IsTrue(svh::Compare::GetChanges(directory.general, general).empty());
+
+		/* Switching the format cooks everything again */
+		svh::PrefabCooker<Loadout> messagepack(directory.input, directory.output);
+		Assert::AreEqual(size_t(4), messagepack.Cook().cooked);
+		Assert::AreEqual(size_t(4), messagepack.Cook().skipped);
+	}
+
+	TEST_METHOD(LoadsCookedFiles) {
+		CookDirectory directory;
+		svh::PrefabCooker<Loadout> cooker(directory.input, directory.output);
+		cooker.Cook();
+		Loadout captain = svh::LoadAsync<Loadout>(cooker.OutputPath("ranks/captain").string()).get();
+		Assert::AreEqual(to_wstring("captain"), to_wstring(captain.name));
+		Assert::AreEqual(size_t(4), captain.stats.size());
+	}
+	};
+}
@@ -0,0 +1,164 @@
+﻿#pragma once
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "svh/serializer.hpp"
+#include "svh/cow_instance.hpp"
+#include "svh/prefab_library.hpp"
+
+#include <vector>
+#include <string>
+#include <memory>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace cow_instance_tests {
+
+	static std::wstring to_wstring(const std::string& s) {
+		return std::wstring(s.begin(), s.end());
+	}
+
+	/* hidden is not a visitable field */
+	struct Partial {
+		int kept = 1;
+		int hidden = 2;
+	};
+}
+
+VISITABLE_STRUCT(cow_instance_tests::Partial, kept);
+
+namespace cow_instance_tests {
+
+	static std::shared_ptr<const Loadout> MakeBase() {
+		auto base = std::make_shared<Loadout>();
+		base->name = "soldier";
+		base->stats = std::vector<int>(1000, 7);
+		base->weapons = { { "rifle", 5 }, { "knife", 2 } };
+		base->slots = { { 0, "head" }, { 1, "chest" } };
+		base->upgrades = { { "armor", { 1, 2 } } };
+		base->holder = std::make_shared<ItemHolder>();
+		return base;
+	}
+
+	TEST_CLASS(CowInstance) {
+public:
+	TEST_METHOD(SharesFieldsUntilWritten) {
+		auto base = MakeBase();
+		svh::CowInstance<Loadout> a(base);
+		svh::CowInstance<Loadout> b(base);
+		Assert::IsTrue(&a.Get(&Loadout::stats) == &base->stats);
+		Assert::AreEqual(6, a.SharedFieldCount());
+
+		a.Mutable(&Loadout::name) = "captain";
+		Assert::AreEqual(5, a.SharedFieldCount());
+		Assert::AreEqual(6, b.SharedFieldCount());
+		Assert::IsTrue(&a.Get(&Loadout::stats) == &base->stats);
+		Assert::AreEqual(to_wstring("captain"), to_wstring(a.Get<0>()));
+		Assert::AreEqual(to_wstring("soldier"), to_wstring(b.Get<0>()));
+		Assert::AreEqual(to_wstring("soldier"), to_wstring(base->name));
+	}
+
+	TEST_METHOD(OverwriteDetachesTouchedFields) {
+		auto base = MakeBase();
+		Loadout edited = *base;
+		edited.name = "captain";
+		edited.slots[2] = "legs";
+		auto patch = svh::Compare::GetChanges(*base, edited);
+
+		svh::CowInstance<Loadout> instance(base);
+		svh::Overwrite::FromJson(patch, instance);
+		Assert::AreEqual(4, instance.SharedFieldCount());
+		Assert::IsTrue(svh::Compare::GetChanges(edited, instance.Materialize()).empty());
+		Assert::AreEqual(size_t(2), base->slots.size());
+	}
+
+	TEST_METHOD(SharedPointerFieldIsNotWrittenThrough) {
+		auto base = MakeBase();
+		svh::CowInstance<Loadout> instance(base);
+		svh::Overwrite::FromJson(svh::json{ { "holder", { { "item_count", 9 } } } }, instance);
+		Assert::AreEqual(9, instance.Get(&Loadout::holder)->item_count);
+		Assert::AreEqual(3, base->holder->item_count);
+	}
+
+	TEST_METHOD(CopiesShareWrittenFields) {
+		svh::CowInstance<Loadout> a(MakeBase());
+		a.Mutable(&Loadout::stats).push_back(1);
+		svh::CowInstance<Loadout> b = a;
+		Assert::IsTrue(&a.Get(&Loadout::stats) == &b.Get(&Loadout::stats));
+
+		b.Mutable(&Loadout::stats).push_back(2);
+		Assert::AreEqual(size_t(1001), a.Get(&Loadout::stats).size());
+		Assert::AreEqual(size_t(1002), b.Get(&Loadout::stats).size());
+	}
+
+	TEST_METHOD(UnknownMemberIsReported) {
+		svh::CowInstance<Partial> instance;
+		Assert::AreEqual(1, instance.Get(&Partial::kept));
+		bool reported = false;
+		try {
+			instance.Get(&Partial::hidden);
+		} catch (const std::runtime_error&) {
+			reported = true;
+		}
+		Assert::IsTrue(reported);
+		reported = false;
+		try {
+			instance.Mutable(&Partial::hidden) = 5;
+		} catch (const std::runtime_error&) {
+			reported = true;
+		}
+		Assert::IsTrue(reported);
+		Assert::AreEqual(1, instance.SharedFieldCount());
+	}
+
+	TEST_METHOD(SerializesLikeTheStruct) {
+		auto base = MakeBase();
+		svh::CowInstance<Loadout> instance(base);
+		instance.Mutable(&Loadout::name) = "captain";
+		Loadout plain = instance.Materialize();
+		Assert::AreEqual(to_wstring(svh::Serializer::ToJson(plain).dump()), to_wstring(svh::Serializer::ToJson(instance).dump()));
+
+		svh::CowInstance<Loadout> other(base);
+		Assert::AreEqual(to_wstring(svh::Compare::GetChanges(*base, plain).dump()), to_wstring(svh::Compare::GetChanges(other, instance).dump()));
+
+		svh::CowInstance<Loadout> loaded(base);
+		svh::Deserializer::FromJson(svh::json{ { "stats", { 1, 2 } } }, loaded);
+		Assert::AreEqual(5, loaded.SharedFieldCount());
+		Assert::AreEqual(size_t(2), loaded.Get(&Loadout::stats).size());
+	}
+
+	TEST_METHOD(LibraryInstancesKeepTheirVersion) {
+		svh::PrefabLibrary<Loadout> library;
+		library.SetBase("soldier", *MakeBase());
+		auto instance = library.InstantiateShared("soldier");
+		Assert::IsTrue(&instance.Get(&Loadout::stats) == &library.Resolve("soldier").stats);
+
+		Loadout changed = *MakeBase();
+		changed.name = "veteran";
+		library.SetBase("soldier", changed);
+		Assert::AreEqual(to_wstring("soldier"), to_wstring(instance.Get(&Loadout::name)));
+		Assert::AreEqual(to_wstring("veteran"), to_wstring(library.InstantiateShared("soldier").Get(&Loadout::name)));
+	}
+
+	TEST_METHOD(Memory) {
+		auto base = MakeBase();
+		const std::size_t count = 100000;
+		std::vector<svh::CowInstance<Loadout>> instances(count, svh::CowInstance<Loadout>(base));
+		for (std::size_t i = 0; i < count; i += 100) {
+			instances[i].Mutable(&Loadout::name) = "override";
+		}
+
+		/* Untouched instances read the base's storage, only the written 1% own a copy of name */
+		for (std::size_t i = 0; i < count; ++i) {
+			const auto& instance = instances[i];
+			Assert::IsTrue(instance.Get(&Loadout::stats).data() == base->stats.data());
+			if (i % 100 == 0) {
+				Assert::IsFalse(&instance.Get(&Loadout::name) == &base->name);
+				Assert::AreEqual(5, instance.SharedFieldCount());
+			} else {
+				Assert::IsTrue(&instance.Get(&Loadout::name) == &base->name);
+				Assert::AreEqual(6, instance.SharedFieldCount());
+			}
+		}
+	}
+	};
+}
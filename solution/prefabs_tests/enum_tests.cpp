@@ -0,0 +1,148 @@
+﻿#pragma once
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "svh/serializer.hpp"
+#include "svh/binary.hpp"
+
+#include <vector>
+#include <string>
+#include <map>
+#include <cstdint>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace enum_tests {
+
+	enum class Element : std::uint8_t { Fire, Water, Earth, Air, Lightning, Ice };
+	enum Layer { Background = -10, Default = 0, Foreground = 10, Overlay = 100 };
+	enum class Flags : char { None = 0, Hidden = 1, Static = 2 };
+	/* Written as "custom" by its own functions, the built-in names are not used */
+	enum class Custom { A, B };
+
+	inline svh::json SerializeImpl(const Custom& c) {
+		return c == Custom::A ? "custom a" : "custom b";
+	}
+
+	inline void DeserializeImpl(const svh::json& j, Custom& c) {
+		c = j.get<std::string>() == "custom a" ? Custom::A : Custom::B;
+	}
+
+	struct Spell {
+		std::string name;
+		Element element = Element::Fire;
+		Layer layer = Default;
+		Flags flags = Flags::None;
+		Custom custom = Custom::A;
+		std::vector<Element> combo;
+		std::map<std::string, Element> resistances;
+	};
+
+	/* True if FromJson reports an error */
+	template<typename T>
+	static bool Rejects(const svh::json& j, T& value) {
+		try {
+			svh::Deserializer::FromJson(j, value);
+			return false;
+		} catch (const std::runtime_error&) {
+			return true;
+		}
+	}
+}
+
+VISITABLE_STRUCT(enum_tests::Spell, name, element, layer, flags, custom, combo, resistances);
+
+template<> struct svh::enum_as_integer<enum_tests::Flags> : std::true_type {};
+
+namespace enum_tests {
+
+	TEST_CLASS(Enums) {
+public:
+	TEST_METHOD(NameTables) {
+		static_assert(svh::EnumCodec<Element>::Name(Element::Lightning) == "Lightning", "Names are known at compile time");
+		static_assert(svh::EnumCodec<Layer>::Name(Overlay) == "Overlay", "Sparse enums are looked up by value");
+		Assert::IsTrue(svh::EnumCodec<Layer>::Name(static_cast<Layer>(5)).empty());
+
+		Element element = Element::Fire;
+		Assert::IsTrue(svh::EnumCodec<Element>::Decode("Ice", element));
+		Assert::IsTrue(element == Element::Ice);
+		Assert::IsTrue(svh::EnumCodec<Element>::Decode("Air", element));
+		Assert::IsTrue(element == Element::Air);
+		Assert::IsFalse(svh::EnumCodec<Element>::Decode("Steam", element));
+		Assert::IsFalse(svh::EnumCodec<Element>::Decode("", element));
+		Assert::IsTrue(element == Element::Air);
+	}
+
+	TEST_METHOD(Serialize) {
+		Assert::AreEqual(std::string("\"Water\""), svh::Serializer::ToJson(Element::Water).dump());
+		Assert::AreEqual(std::string("\"Background\""), svh::Serializer::ToJson(Background).dump());
+		/* No name, written as the integer */
+		Assert::AreEqual(std::string("5"), svh::Serializer::ToJson(static_cast<Layer>(5)).dump());
+		/* enum_as_integer, char is written as a number */
+		Assert::AreEqual(std::string("2"), svh::Serializer::ToJson(Flags::Static).dump());
+		Assert::AreEqual(std::string("\"custom b\""), svh::Serializer::ToJson(Custom::B).dump());
+	}
+
+	TEST_METHOD(Deserialize) {
+		Layer layer = Default;
+		svh::Deserializer::FromJson(svh::json("Foreground"), layer);
+		Assert::IsTrue(layer == Foreground);
+		svh::Deserializer::FromJson(svh::json(-10), layer);
+		Assert::IsTrue(layer == Background);
+
+		Flags flags = Flags::None;
+		svh::Deserializer::FromJson(svh::json("Hidden"), flags);
+		Assert::IsTrue(flags == Flags::Hidden);
+		svh::Deserializer::FromJson(svh::json(2), flags);
+		Assert::IsTrue(flags == Flags::Static);
+
+		Element element = Element::Fire;
+		Assert::IsTrue(Rejects(svh::json("Steam"), element));
+		Assert::IsTrue(Rejects(svh::json(1.5), element));
+		Assert::IsTrue(element == Element::Fire);
+	}
+
+	TEST_METHOD(RoundTrip) {
+		Spell spell;
+		spell.name = "storm";
+		spell.element = Element::Lightning;
+		spell.layer = Overlay;
+		spell.flags = Flags::Hidden;
+		spell.custom = Custom::B;
+		spell.combo = { Element::Water, Element::Air };
+		spell.resistances = { { "golem", Element::Earth } };
+
+		svh::json j = svh::Serializer::ToJson(spell);
+		Assert::AreEqual(std::string("Lightning"), j["element"].get<std::string>());
+		Assert::AreEqual(std::string("Air"), j["combo"][1].get<std::string>());
+		Assert::AreEqual(1, j["flags"].get<int>());
+
+		Spell loaded;
+		svh::Deserializer::FromJson(j, loaded);
+		Assert::IsTrue(spell == loaded);
+	}
+
+	TEST_METHOD(CompareAndOverwrite) {
+		Spell left;
+		Spell right;
+		right.element = Element::Ice;
+		right.layer = Background;
+
+		svh::json changes = svh::Compare::GetChanges(left, right);
+		Assert::AreEqual(std::string("{\"element\":\"Ice\",\"layer\":\"Background\"}"), changes.dump());
+		svh::Overwrite::FromJson(changes, left);
+		Assert::IsTrue(left == right);
+	}
+
+	TEST_METHOD(Binary) {
+		/* The binary format stores the underlying integer, names are never written */
+		Spell spell;
+		spell.element = Element::Earth;
+		spell.combo = { Element::Ice, Element::Fire, Element::Air };
+		const std::vector<std::uint8_t> bytes = svh::Binary::Write(spell);
+
+		Spell loaded;
+		Assert::IsTrue(svh::Binary::Read(bytes.data(), bytes.size(), loaded));
+		Assert::IsTrue(spell == loaded);
+	}
+	};
+}
@@ -0,0 +1,174 @@
+﻿#pragma once
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "svh/serializer.hpp"
+#include "svh/hot_reload.hpp"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace hot_reload_tests {
+
+	static std::wstring to_wstring(const std::string& s) {
+		return std::wstring(s.begin(), s.end());
+	}
+
+	static void WriteFile(const std::string& path, const Loadout& value) {
+		std::ofstream file(path, std::ios::trunc);
+		file << svh::Serializer::ToJson(value).dump(1, '\t');
+	}
+
+	TEST_CLASS(HotReload) {
+public:
+	TEST_METHOD(OverriddenFieldsAreKept) {
+		auto path = TempPath("overridden", ".json");
+		Loadout prefab = MakeLoadout();
+		WriteFile(path, prefab);
+
+		svh::HotReloader<Loadout> reloader;
+		Assert::IsTrue(reloader.Load(path));
+
+		std::vector<Loadout> plain(100, prefab);
+		Loadout renamed = prefab;
+		renamed.name = "captain";
+		Loadout reslotted = prefab;
+		reslotted.slots[1] = "armor";
+		for (auto& instance : plain) {
+			reloader.Track(path, &instance);
+		}
+		reloader.Track(path, &renamed);
+		reloader.Track(path, &reslotted);
+
+		Loadout edited = prefab;
+		edited.name = "veteran";
+		edited.weapons[0].damage = 8;
+		edited.slots[0] = "helmet";
+		edited.slots[1] = "vest";
+		WriteFile(path, edited);
+		Assert::IsTrue(reloader.Reload(path));
+
+		Assert::IsTrue(svh::Compare::GetChanges(edited, plain[42]).empty());
+		Assert::AreEqual(to_wstring("captain"), to_wstring(renamed.name));
+		Assert::AreEqual(8, renamed.weapons[0].damage);
+		Assert::AreEqual(to_wstring("veteran"), to_wstring(reslotted.name));
+		Assert::AreEqual(to_wstring(R"({"0":"helmet","1":"armor"})"), to_wstring(svh::Serializer::ToJson(reslotted.slots).dump()));
+		std::filesystem::remove(path);
+	}
+
+	TEST_METHOD(UpdateReloadsChangedFiles) {
+		auto path = TempPath("update", ".json");
+		auto other = TempPath("update_other", ".json");
+		WriteFile(path, MakeLoadout());
+		WriteFile(other, MakeLoadout());
+
+		svh::HotReloader<Loadout> reloader;
+		reloader.Load(path);
+		reloader.Load(other);
+		Loadout instance = reloader.Get(path);
+		reloader.Track(path, &instance);
+		Assert::IsTrue(reloader.Update().empty());
+
+		Loadout edited = MakeLoadout();
+		edited.stats.push_back(40);
+		WriteFile(path, edited);
+		auto reloaded = reloader.Update();
+		Assert::AreEqual(size_t(1), reloaded.size());
+		Assert::AreEqual(to_wstring(path), to_wstring(reloaded[0]));
+		Assert::AreEqual(size_t(4), instance.stats.size());
+		std::filesystem::remove(path);
+		std::filesystem::remove(other);
+	}
+
+	TEST_METHOD(InvalidFileIsIgnored) {
+		auto path = TempPath("invalid", ".json");
+		WriteFile(path, MakeLoadout());
+		svh::HotReloader<Loadout> reloader;
+		reloader.Load(path);
+		Loadout instance = reloader.Get(path);
+		reloader.Track(path, &instance);
+
+		std::ofstream(path, std::ios::trunc) << "{ \"name\": ";
+		Assert::IsFalse(reloader.Reload(path));
+		Assert::AreEqual(to_wstring("soldier"), to_wstring(instance.name));
+		std::filesystem::remove(path);
+	}
+
+	TEST_METHOD(SnapshotWhileReloading) {
+		auto path = TempPath("snapshot", ".json");
+		WriteFile(path, MakeLoadout());
+		svh::HotReloader<Loadout> reloader;
+		reloader.Load(path);
+		auto before = reloader.Snapshot(path);
+
+		std::atomic<bool> done{ false };
+		std::atomic<int> highest{ 0 };
+		std::thread reader([&]() {
+			while (!done.load()) {
+				auto snapshot = reloader.Snapshot(path);
+				highest = std::max(highest.load(), snapshot->weapons[0].damage);
+			}
+		});
+		/* Loading other prefabs grows the map the reader looks path up in */
+		std::vector<std::string> others;
+		Loadout edited = MakeLoadout();
+		for (int damage = 6; damage <= 20; ++damage) {
+			edited.weapons[0].damage = damage;
+			WriteFile(path, edited);
+			reloader.Reload(path);
+			others.push_back(TempPath("snapshot_" + std::to_string(damage), ".json"));
+			WriteFile(others.back(), edited);
+			reloader.Load(others.back());
+		}
+		done = true;
+		reader.join();
+		for (const auto& other : others) {
+			std::filesystem::remove(other);
+		}
+
+		Assert::AreEqual(5, before->weapons[0].damage);
+		Assert::AreEqual(20, reloader.Snapshot(path)->weapons[0].damage);
+		Assert::IsTrue(highest.load() <= 20);
+		std::filesystem::remove(path);
+	}
+
+	/* One field edit with 100k live instances */
+	TEST_METHOD(ReloadLatency) {
+		auto path = TempPath("latency", ".json");
+		Loadout prefab = MakeLoadout();
+		WriteFile(path, prefab);
+		svh::HotReloader<Loadout> reloader;
+		reloader.Load(path);
+
+		std::vector<Loadout> instances(100000, prefab);
+		for (size_t i = 0; i < instances.size(); ++i) {
+			if (i % 10 == 0) {
+				instances[i].name = "override " + std::to_string(i);
+				reloader.Track(path, &instances[i], svh::json{ { "name", instances[i].name } });
+			} else {
+				reloader.Track(path, &instances[i], svh::json());
+			}
+		}
+
+		Loadout edited = prefab;
+		edited.weapons[0].damage = 9;
+		WriteFile(path, edited);
+		auto start = std::chrono::steady_clock::now();
+		reloader.Reload(path);
+		auto end = std::chrono::steady_clock::now();
+
+		Assert::AreEqual(9, instances[10].weapons[0].damage);
+		Assert::AreEqual(9, instances[11].weapons[0].damage);
+		auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+		std::wstring message = L"reload of 100k instances: " + std::to_wstring(ms) + L" ms\n";
+		Logger::WriteMessage(message.c_str());
+		std::filesystem::remove(path);
+	}
+	};
+}
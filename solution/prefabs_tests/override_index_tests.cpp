@@ -0,0 +1,154 @@
+﻿#pragma once
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "svh/serializer.hpp"
+#include "svh/override_index.hpp"
+
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace override_index_tests {
+
+	static std::wstring to_wstring(const std::string& s) {
+		return std::wstring(s.begin(), s.end());
+	}
+
+	static svh::PathElement Field(std::size_t index) {
+		return { svh::PathElement::Kind::Field, index, {} };
+	}
+
+	static svh::PathElement Index(std::size_t index) {
+		return { svh::PathElement::Kind::Index, index, {} };
+	}
+
+	static svh::PathElement Key(const std::string& key) {
+		return { svh::PathElement::Kind::Key, 0, key };
+	}
+
+	static Loadout MakeBase() {
+		Loadout base;
+		base.name = "soldier";
+		base.stats = { 1, 2, 3 };
+		base.weapons = { { "rifle", 5 }, { "knife", 2 } };
+		base.slots = { { 0, "head" }, { 1, "chest" } };
+		base.upgrades = { { "fire", { 1, 2 } }, { "ice", { 3 } } };
+		base.holder = std::make_shared<ItemHolder>();
+		return base;
+	}
+
+	static Loadout Mutate(const Loadout& base, std::mt19937& random) {
+		Loadout result = base;
+		result.holder = std::make_shared<ItemHolder>(*base.holder);
+		switch (random() % 7) {
+		case 0: result.name += "x"; break;
+		case 1: result.stats[random() % result.stats.size()] += 1; break;
+		case 2: result.stats.push_back(7); break;
+		case 3: result.weapons[random() % result.weapons.size()].damage += 1; break;
+		case 4: result.slots[static_cast<int>(random() % 4)] = "slot"; break;
+		case 5: result.upgrades["fire"][random() % 2] += 1; break;
+		case 6: result.holder->item_count += 1; break;
+		}
+		return result;
+	}
+
+	TEST_CLASS(OverrideIndex) {
+public:
+	TEST_METHOD(Lookup) {
+		Loadout base = MakeBase();
+		Loadout instance = base;
+		instance.weapons[1].damage = 9;
+		instance.upgrades["fire"][0] = 4;
+		auto index = svh::OverrideIndex::Build<Loadout>(svh::Compare::GetChanges(base, instance));
+
+		Assert::IsTrue(index.IsOverridden({ Field(2), Index(1), Field(1) }));
+		Assert::IsFalse(index.IsOverridden({ Field(2), Index(1), Field(0) }));
+		Assert::IsFalse(index.IsOverridden({ Field(2) }));
+		Assert::IsTrue(index.HasOverrides({ Field(2) }));
+		Assert::IsTrue(index.HasOverrides({ Field(4), Key("fire") }));
+		Assert::IsFalse(index.HasOverrides({ Field(4), Key("ice") }));
+		Assert::IsFalse(index.HasOverrides({ Field(0) }));
+		Assert::AreEqual(size_t(2), svh::OverrideIndex::FieldIndex<Loadout>("weapons"));
+	}
+
+	TEST_METHOD(WholeValues) {
+		Loadout base = MakeBase();
+		Loadout instance = base;
+		instance.stats.push_back(4);
+		instance.slots.erase(0);
+		instance.slots[5] = "legs";
+		auto index = svh::OverrideIndex::Build<Loadout>(svh::Compare::GetChanges(base, instance));
+
+		/* Added elements override the vector and everything in it */
+		Assert::IsTrue(index.IsOverridden({ Field(1) }));
+		Assert::IsTrue(index.IsOverridden({ Field(1), Index(0) }));
+		Assert::IsTrue(index.IsOverridden({ Field(3), Key("0") }));
+		Assert::IsTrue(index.IsOverridden({ Field(3), Key("5") }));
+		Assert::IsFalse(index.IsOverridden({ Field(3), Key("1") }));
+		Assert::AreEqual(size_t(3), index.Paths().size());
+	}
+
+	TEST_METHOD(MatchesOverwriteObserver) {
+		std::mt19937 random(7);
+		for (int i = 0; i < 500; ++i) {
+			Loadout base = MakeBase();
+			Loadout instance = Mutate(Mutate(base, random), random);
+			auto patch = svh::Compare::GetChanges(base, instance);
+			auto index = svh::OverrideIndex::Build<Loadout>(patch);
+
+			Loadout target = base;
+			target.holder = std::make_shared<ItemHolder>(*base.holder);
+			svh::Overwrite::FromJson(patch, target, [&](const svh::FieldPath& path) {
+				Assert::IsTrue(index.IsOverridden(path));
+			});
+			for (const auto& path : index.Paths()) {
+				Assert::IsTrue(index.HasOverrides({ path.front() }));
+			}
+		}
+	}
+
+	TEST_METHOD(IncrementalUpdate) {
+		std::mt19937 random(11);
+		Loadout base = MakeBase();
+		Loadout instance = base;
+		svh::json previous;
+		svh::OverrideIndex index;
+		for (int i = 0; i < 300; ++i) {
+			instance = i % 50 == 49 ? base : Mutate(instance, random);
+			auto next = svh::Compare::GetChanges(base, instance);
+			index.Update<Loadout>(previous, next);
+			auto rebuilt = svh::OverrideIndex::Build<Loadout>(next);
+			Assert::AreEqual(rebuilt.Paths().size(), index.Paths().size());
+			for (const auto& path : rebuilt.Paths()) {
+				Assert::IsTrue(index.IsOverridden(path));
+			}
+			Assert::AreEqual(rebuilt.Empty(), index.Empty());
+			previous = next;
+		}
+	}
+
+	TEST_METHOD(LookupTime) {
+		Loadout base = MakeBase();
+		Loadout instance = base;
+		for (int i = 0; i < 1000; ++i) {
+			instance.upgrades["key " + std::to_string(i)] = { i };
+		}
+		auto patch = svh::Compare::GetChanges(base, instance);
+		auto index = svh::OverrideIndex::Build<Loadout>(patch);
+
+		auto start = std::chrono::steady_clock::now();
+		std::size_t found = 0;
+		for (int i = 0; i < 100000; ++i) {
+			found += index.IsOverridden({ Field(4), Key("key " + std::to_string(i % 2000)) });
+		}
+		auto end = std::chrono::steady_clock::now();
+		Assert::AreEqual(size_t(50000), found);
+		auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 100000;
+		std::wstring message = L"override lookup: " + std::to_wstring(ns) + L" ns\n";
+		Logger::WriteMessage(message.c_str());
+	}
+	};
+}
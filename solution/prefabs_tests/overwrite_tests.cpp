@@ -0,0 +1,178 @@
+﻿#pragma once
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "svh/serializer.hpp"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace overwrite_tests {
+
+	static std::wstring to_wstring(const std::string& s) {
+		return std::wstring(s.begin(), s.end());
+	}
+
+	/* Targets that differ from each other, so the patch is not applied to identical objects */
+	static std::vector<Loadout> MakeTargets(size_t count) {
+		std::vector<Loadout> targets(count);
+		for (size_t i = 0; i < count; ++i) {
+			auto& target = targets[i];
+			target.name = "target " + std::to_string(i);
+			target.stats = { static_cast<int>(i % 7), 1, 2 };
+			target.slots[static_cast<int>(i % 3)] = "slot";
+			target.holder = std::make_shared<ItemHolder>();
+		}
+		return targets;
+	}
+
+	static svh::json MakePatch() {
+		Loadout base;
+		base.holder = std::make_shared<ItemHolder>();
+		Loadout changed = base;
+		changed.holder = std::make_shared<ItemHolder>(*base.holder);
+		changed.stats = { 9 };
+		changed.weapons.push_back({ "sword", 10 });
+		changed.slots[5] = "shield";
+		changed.holder->items.push_back(4);
+		return svh::Compare::GetChanges(base, changed);
+	}
+
+	TEST_CLASS(Batch) {
+public:
+	TEST_METHOD(MatchesSequential) {
+		auto patch = MakePatch();
+		auto sequential = MakeTargets(3000);
+		auto batched = MakeTargets(3000);
+
+		for (auto& target : sequential) {
+			svh::Overwrite::FromJson(patch, target);
+		}
+		svh::Overwrite::FromJsonBatch(patch, batched, 4);
+
+		for (size_t i = 0; i < sequential.size(); ++i) {
+			auto difference = svh::Compare::GetChanges(sequential[i], batched[i]);
+			Assert::IsTrue(difference.empty(), to_wstring(std::to_string(i) + ": " + difference.dump()).c_str());
+		}
+	}
+
+	TEST_METHOD(SharedPointerOverwrittenOnce) {
+		auto shared = std::make_shared<ItemHolder>();
+		std::vector<GameEntity> targets(2000);
+		for (auto& target : targets) {
+			target.item_holder = shared;
+		}
+
+		ItemHolder changed = *shared;
+		changed.items.push_back(4);
+		svh::json patch = { { "item_holder", svh::Compare::GetChanges(*shared, changed) } };
+		svh::Overwrite::FromJsonBatch(patch, targets, 8);
+
+		Assert::AreEqual(to_wstring("[1,2,3,4]"), to_wstring(svh::Serializer::ToJson(shared->items).dump()));
+	}
+
+	TEST_METHOD(NullPatch) {
+		auto targets = MakeTargets(10);
+		svh::Overwrite::FromJsonBatch(svh::json(), targets);
+		Assert::AreEqual(to_wstring("target 3"), to_wstring(targets[3].name));
+	}
+
+	TEST_METHOD(ErrorIsRethrown) {
+		auto targets = MakeTargets(1000);
+		svh::json patch = { { "name", 5 } };
+		bool thrown = false;
+		try {
+			svh::Overwrite::FromJsonBatch(patch, targets, 4);
+		} catch (const std::exception&) {
+			thrown = true;
+		}
+		Assert::IsTrue(thrown);
+	}
+	};
+
+	/* Every reported path as "f<field>", "i<index>" or "k<key>" joined by '/' */
+	template<typename T>
+	static std::vector<std::string> ObservedPaths(const T& before, const T& after) {
+		std::vector<std::string> paths;
+		T value = before;
+		svh::Overwrite::FromJson(svh::Compare::GetChanges(before, after), value, [&](const svh::FieldPath& path) {
+			std::string text;
+			for (const auto& element : path) {
+				if (!text.empty()) text += "/";
+				switch (element.kind) {
+				case svh::PathElement::Kind::Field: text += "f" + std::to_string(element.index); break;
+				case svh::PathElement::Kind::Index: text += "i" + std::to_string(element.index); break;
+				case svh::PathElement::Kind::Key: text += "k" + element.key; break;
+				}
+			}
+			paths.push_back(text);
+		});
+		Assert::IsTrue(svh::Compare::GetChanges(after, value).empty());
+		return paths;
+	}
+
+	static std::wstring Join(const std::vector<std::string>& paths) {
+		std::string result;
+		for (const auto& path : paths) {
+			result += path + ";";
+		}
+		return to_wstring(result);
+	}
+
+	TEST_CLASS(Observer) {
+public:
+	TEST_METHOD(StructField) {
+		Loadout before;
+		Loadout after = before;
+		after.name = "changed";
+		Assert::AreEqual(to_wstring("f0;"), Join(ObservedPaths(before, after)));
+	}
+
+	TEST_METHOD(VectorElementChanged) {
+		Loadout before;
+		before.stats = { 1, 2, 3 };
+		Loadout after = before;
+		after.stats[1] = 5;
+		Assert::AreEqual(to_wstring("f1/i1;"), Join(ObservedPaths(before, after)));
+	}
+
+	TEST_METHOD(VectorElementAdded) {
+		Loadout before;
+		before.weapons = { { "sword", 1 } };
+		Loadout after = before;
+		after.weapons.push_back({ "bow", 2 });
+		Assert::AreEqual(to_wstring("f2;"), Join(ObservedPaths(before, after)));
+	}
+
+	TEST_METHOD(NestedStructInVector) {
+		Loadout before;
+		before.weapons = { { "sword", 1 }, { "bow", 2 } };
+		Loadout after = before;
+		after.weapons[1].damage = 3;
+		Assert::AreEqual(to_wstring("f2/i1/f1;"), Join(ObservedPaths(before, after)));
+	}
+
+	TEST_METHOD(MapKeys) {
+		Loadout before;
+		before.slots = { { 1, "a" }, { 2, "b" } };
+		before.upgrades = { { "fire", { 1, 2 } } };
+		Loadout after = before;
+		after.slots.erase(1);
+		after.slots[7] = "c";
+		after.upgrades["fire"][0] = 4;
+		Assert::AreEqual(to_wstring("f3/k1;f3/k7;f4/kfire/i0;"), Join(ObservedPaths(before, after)));
+	}
+
+	TEST_METHOD(SharedPointerMember) {
+		Loadout before;
+		before.holder = std::make_shared<ItemHolder>();
+		Loadout after = before;
+		after.holder = std::make_shared<ItemHolder>(*before.holder);
+		after.holder->item_count = 9;
+		Assert::AreEqual(to_wstring("f5/f0;"), Join(ObservedPaths(before, after)));
+	}
+	};
+}
@@ -0,0 +1,240 @@
+﻿#pragma once
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "svh/serializer.hpp"
+#include "svh/patch_journal.hpp"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+#include <cstring>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace patch_journal_tests {
+
+	static std::wstring to_wstring(const std::string& s) {
+		return std::wstring(s.begin(), s.end());
+	}
+
+	/* The state after tick i */
+	static Loadout Tick(Loadout loadout, int i) {
+		loadout.stats.push_back(i);
+		loadout.weapons[0].damage = i;
+		loadout.slots[i % 4] = "slot " + std::to_string(i);
+		return loadout;
+	}
+
+	static Loadout Start() {
+		Loadout loadout;
+		loadout.name = "soldier";
+		loadout.weapons = { { "rifle", 0 } };
+		return loadout;
+	}
+
+	static bool Same(const Loadout& left, const Loadout& right) {
+		return svh::Compare::GetChanges(left, right).is_null();
+	}
+
+	TEST_CLASS(PatchJournal) {
+public:
+	TEST_METHOD(Replay) {
+		auto path = TempPath("replay", ".svhj");
+		Loadout value = Start();
+		{
+			svh::PatchJournal<Loadout> journal(path, 0);
+			Assert::IsTrue(journal.Open(value));
+			for (int i = 0; i < 10; ++i) {
+				value = Tick(value, i);
+				Assert::IsTrue(journal.Record(value));
+			}
+			Assert::IsFalse(journal.Record(value));
+			Assert::AreEqual(size_t(10), journal.RecordCount());
+		}
+		Loadout loaded;
+		Assert::IsTrue(svh::PatchJournal<Loadout>::Load(path, loaded));
+		Assert::IsTrue(Same(value, loaded));
+
+		/* Reopening continues where it stopped */
+		Loadout reopened;
+		svh::PatchJournal<Loadout> journal(path, 0);
+		Assert::IsTrue(journal.Open(reopened));
+		Assert::IsTrue(Same(value, reopened));
+		Assert::AreEqual(size_t(10), journal.RecordCount());
+		value = Tick(value, 10);
+		journal.Record(value);
+		journal.Close();
+		Assert::IsTrue(svh::PatchJournal<Loadout>::Load(path, loaded));
+		Assert::IsTrue(Same(value, loaded));
+		std::filesystem::remove(path);
+	}
+
+	/* What a crash would leave: the file while the journal is still open */
+	TEST_METHOD(FlushInterval) {
+		auto path = TempPath("flush", ".svhj");
+		Loadout value = Start();
+		Loadout loaded;
+		{
+			svh::PatchJournal<Loadout> journal(path, 0);
+			journal.Open(value);
+			value = Tick(value, 0);
+			journal.Record(value);
+			Assert::IsTrue(svh::PatchJournal<Loadout>::Load(path, loaded));
+			Assert::IsTrue(Same(value, loaded));
+		}
+		std::filesystem::remove(path);
+
+		value = Start();
+		svh::PatchJournal<Loadout> journal(path, 0, 4);
+		journal.Open(value);
+		const Loadout start = value;
+		for (int i = 0; i < 3; ++i) {
+			value = Tick(value, i);
+			journal.Record(value);
+		}
+		Assert::IsTrue(svh::PatchJournal<Loadout>::Load(path, loaded));
+		Assert::IsTrue(Same(start, loaded));
+		value = Tick(value, 3);
+		journal.Record(value);
+		Assert::IsTrue(svh::PatchJournal<Loadout>::Load(path, loaded));
+		Assert::IsTrue(Same(value, loaded));
+		journal.Close();
+		std::filesystem::remove(path);
+	}
+
+	TEST_METHOD(TornTail) {
+		auto path = TempPath("torn", ".svhj");
+		Loadout value = Start();
+		Loadout before_last;
+		{
+			svh::PatchJournal<Loadout> journal(path, 0);
+			journal.Open(value);
+			for (int i = 0; i < 5; ++i) {
+				before_last = value;
+				value = Tick(value, i);
+				journal.Record(value);
+			}
+		}
+		/* A crash in the middle of the last frame */
+		std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+		Loadout loaded;
+		Assert::IsTrue(svh::PatchJournal<Loadout>::Load(path, loaded));
+		Assert::IsTrue(Same(before_last, loaded));
+
+		/* Opening cuts the torn frame off so new frames are reachable */
+		{
+			Loadout reopened;
+			svh::PatchJournal<Loadout> journal(path, 0);
+			Assert::IsTrue(journal.Open(reopened));
+			Assert::AreEqual(size_t(4), journal.RecordCount());
+			journal.Record(value);
+		}
+		Assert::IsTrue(svh::PatchJournal<Loadout>::Load(path, loaded));
+		Assert::IsTrue(Same(value, loaded));
+		std::filesystem::remove(path);
+	}
+
+	TEST_METHOD(CorruptFrame) {
+		auto path = TempPath("corrupt", ".svhj");
+		Loadout value = Start();
+		Loadout first;
+		{
+			svh::PatchJournal<Loadout> journal(path, 0);
+			journal.Open(value);
+			first = value = Tick(value, 0);
+			journal.Record(value);
+			value = Tick(value, 1);
+			journal.Record(value);
+		}
+		/* Flips the last byte, the checksum of the last frame no longer matches */
+		{
+			std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+			file.seekg(-1, std::ios::end);
+			char last = static_cast<char>(file.get());
+			file.seekp(-1, std::ios::end);
+			file.put(static_cast<char>(last ^ 0x5a));
+		}
+		Loadout loaded;
+		Assert::IsTrue(svh::PatchJournal<Loadout>::Load(path, loaded));
+		Assert::IsTrue(Same(first, loaded));
+
+		/* A torn frame header whose length is far past the end of the file is cut off without reading it */
+		{
+			std::ofstream file(path, std::ios::binary | std::ios::app);
+			char frame[svh::JOURNAL_FRAME_SIZE] = {};
+			frame[0] = static_cast<char>(svh::JournalFrame::Delta);
+			const std::uint32_t length = 0xFFFFFFF0u;
+			std::memcpy(frame + 4, &length, sizeof(length));
+			file.write(frame, sizeof(frame));
+		}
+		Assert::IsTrue(svh::PatchJournal<Loadout>::Load(path, loaded));
+		Assert::IsTrue(Same(first, loaded));
+
+		/* Not a journal */
+		std::ofstream(path, std::ios::binary | std::ios::trunc) << "{}";
+		Assert::IsFalse(svh::PatchJournal<Loadout>::Load(path, loaded));
+		std::filesystem::remove(path);
+	}
+
+	TEST_METHOD(Compaction) {
+		auto path = TempPath("compaction", ".svhj");
+		auto uncompacted_path = TempPath("uncompacted", ".svhj");
+		Loadout value = Start();
+		svh::PatchJournal<Loadout> journal(path, 16);
+		svh::PatchJournal<Loadout> uncompacted(uncompacted_path, 0);
+		journal.Open(value);
+		uncompacted.Open(value);
+		for (int i = 0; i < 200; ++i) {
+			value = Tick(value, i);
+			journal.Record(value);
+			uncompacted.Record(value);
+		}
+		journal.WaitForCompaction();
+		journal.Flush();
+		uncompacted.Flush();
+		Assert::IsTrue(journal.CompactionCount() > 0);
+		Assert::IsTrue(journal.RecordCount() < 200);
+		Assert::IsTrue(std::filesystem::file_size(path) < std::filesystem::file_size(uncompacted_path));
+		Assert::IsFalse(std::filesystem::exists(path + ".compact"));
+
+		Loadout loaded;
+		Assert::IsTrue(svh::PatchJournal<Loadout>::Load(path, loaded));
+		Assert::IsTrue(Same(value, loaded));
+		journal.Close();
+		uncompacted.Close();
+		std::filesystem::remove(path);
+		std::filesystem::remove(uncompacted_path);
+	}
+
+	TEST_METHOD(AppendCost) {
+		auto path = TempPath("cost", ".svhj");
+		Loadout value = Start();
+		for (int i = 0; i < 100000; ++i) value.stats.push_back(i);
+		svh::PatchJournal<Loadout> journal(path, 0);
+		journal.Open(value);
+		const auto checkpoint_size = std::filesystem::file_size(path);
+		Loadout next = value;
+		next.weapons[0].damage = 7;
+		const svh::json delta = svh::Compare::GetChanges(value, next);
+
+		const int ticks = 1000;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < ticks; ++i) {
+			journal.Append(delta);
+		}
+		journal.Flush();
+		auto end = std::chrono::high_resolution_clock::now();
+		const auto appended = std::filesystem::file_size(path) - checkpoint_size;
+		Assert::IsTrue(appended < ticks * 64);
+		Assert::AreEqual(7, journal.Value().weapons[0].damage);
+
+		std::wstring message = L"Checkpoint " + std::to_wstring(checkpoint_size) + L" bytes, " + std::to_wstring(appended / ticks) + L" bytes and " +
+			std::to_wstring(std::chrono::duration<double, std::micro>(end - start).count() / ticks) + L" us per append";
+		Logger::WriteMessage(message.c_str());
+		journal.Close();
+		std::filesystem::remove(path);
+	}
+	};
+}
@@ -0,0 +1,460 @@
+﻿#pragma once
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "svh/serializer.hpp"
+#include "svh/patch.hpp"
+#include "svh/undo_journal.hpp"
+
+#include <vector>
+#include <map>
+#include <string>
+#include <memory>
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace patch_tests {
+
+	static std::wstring to_wstring(const std::string& s) {
+		return std::wstring(s.begin(), s.end());
+	}
+
+	/* Random edits, so every step produces removed/added/changed entries */
+	static void Mutate(std::mt19937& rng, int& value) {
+		value = static_cast<int>(rng() % 10);
+	}
+
+	static void Mutate(std::mt19937& rng, std::string& value) {
+		value = std::string(1, static_cast<char>('a' + rng() % 4));
+	}
+
+	static void Mutate(std::mt19937& rng, Weapon& value) {
+		if (rng() % 2) Mutate(rng, value.name);
+		if (rng() % 2) Mutate(rng, value.damage);
+	}
+
+	template<typename T>
+	static void Mutate(std::mt19937& rng, std::vector<T>& values) {
+		int edits = static_cast<int>(rng() % 4);
+		for (int e = 0; e < edits; ++e) {
+			auto op = rng() % 3;
+			if (op == 0 && !values.empty()) {
+				values.erase(values.begin() + rng() % values.size());
+			} else if (op == 1) {
+				T value{};
+				Mutate(rng, value);
+				values.insert(values.begin() + rng() % (values.size() + 1), value);
+			} else if (!values.empty()) {
+				Mutate(rng, values[rng() % values.size()]);
+			}
+		}
+	}
+
+	template<typename K, typename V>
+	static void Mutate(std::mt19937& rng, std::map<K, V>& values) {
+		int edits = static_cast<int>(rng() % 4);
+		for (int e = 0; e < edits; ++e) {
+			K key{};
+			Mutate(rng, key);
+			auto op = rng() % 3;
+			if (op == 0) {
+				values.erase(key);
+			} else {
+				Mutate(rng, values[key]);
+			}
+		}
+	}
+
+	static void Mutate(std::mt19937& rng, Loadout& value) {
+		if (rng() % 4 == 0) Mutate(rng, value.name);
+		Mutate(rng, value.stats);
+		Mutate(rng, value.weapons);
+		Mutate(rng, value.slots);
+		Mutate(rng, value.upgrades);
+		/* Compare does not support a pointer going from null to set */
+		if (!value.holder) value.holder = std::make_shared<ItemHolder>();
+		if (rng() % 2) Mutate(rng, value.holder->items);
+	}
+
+	/* Applying the composed patch must give the same result as applying the chain in sequence */
+	template<typename T>
+	void CheckCompose(unsigned seed, int chain_length) {
+		std::mt19937 rng(seed);
+		T base{};
+		Mutate(rng, base);
+
+		std::vector<T> states{ base };
+		std::vector<svh::json> chain;
+		for (int i = 0; i < chain_length; ++i) {
+			T next = states.back();
+			Mutate(rng, next);
+			chain.push_back(svh::Compare::GetChanges(states.back(), next));
+			states.push_back(next);
+		}
+
+		T sequential = base;
+		for (const auto& patch : chain) {
+			svh::Overwrite::FromJson(patch, sequential);
+		}
+
+		svh::json composed;
+		try {
+			composed = svh::ComposePatches<T>(chain);
+		} catch (const std::exception& ex) {
+			Assert::Fail(to_wstring(std::string("Exception thrown: ") + ex.what()).c_str());
+		}
+		T squashed = base;
+		svh::Overwrite::FromJson(composed, squashed);
+
+		auto difference = svh::Compare::GetChanges(sequential, squashed);
+		std::wstring message = to_wstring("\nseed " + std::to_string(seed) + ": " + composed.dump() + "\n");
+		Assert::IsTrue(difference.empty(), message.c_str());
+	}
+
+	TEST_CLASS(ComposePatches) {
+public:
+	TEST_METHOD(EmptyChain) {
+		auto composed = svh::ComposePatches<std::vector<int>>(svh::json(), svh::json());
+		Assert::IsTrue(composed.is_null());
+	}
+
+	TEST_METHOD(Vector_AddThenChange) {
+		std::vector<int> a{ 1, 2, 3 };
+		std::vector<int> b{ 1, 4, 2, 3 };
+		std::vector<int> c{ 1, 5, 2 };
+		auto composed = svh::ComposePatches<std::vector<int>>(
+			svh::Compare::GetChanges(a, b),
+			svh::Compare::GetChanges(b, c));
+		svh::Overwrite::FromJson(composed, a);
+		Assert::IsTrue(svh::Compare::GetChanges(a, c).empty());
+	}
+
+	TEST_METHOD(Map_RemoveThenAdd) {
+		std::map<int, std::string> a{ {1, "a"}, {2, "b"} };
+		std::map<int, std::string> b{ {2, "b"} };
+		std::map<int, std::string> c{ {1, "c"}, {2, "d"} };
+		auto composed = svh::ComposePatches<std::map<int, std::string>>(
+			svh::Compare::GetChanges(a, b),
+			svh::Compare::GetChanges(b, c));
+		svh::Overwrite::FromJson(composed, a);
+		Assert::IsTrue(svh::Compare::GetChanges(a, c).empty());
+	}
+
+	TEST_METHOD(Struct_FieldsFromBothPatches) {
+		ItemHolder a;
+		ItemHolder b = a;
+		b.item_count = 5;
+		ItemHolder c = b;
+		c.items.push_back(4);
+		auto composed = svh::ComposePatches<ItemHolder>(
+			svh::Compare::GetChanges(a, b),
+			svh::Compare::GetChanges(b, c));
+		svh::json expected = {
+			{ "item_count", 5 },
+			{ "items", {
+				{ svh::ADDED_VALUES, svh::json::array({
+					{ { svh::INDEX, svh::json::array({ 3 }) }, { svh::VALUE, 4 } }
+				}) }
+			} }
+		};
+		Assert::AreEqual(to_wstring(expected.dump()), to_wstring(composed.dump()));
+	}
+
+	TEST_METHOD(RandomVectors) {
+		for (unsigned seed = 0; seed < 200; ++seed) {
+			CheckCompose<std::vector<int>>(seed, 4);
+		}
+	}
+
+	TEST_METHOD(RandomMaps) {
+		for (unsigned seed = 0; seed < 200; ++seed) {
+			CheckCompose<std::map<int, std::string>>(seed, 4);
+		}
+	}
+
+	TEST_METHOD(RandomNestedStructs) {
+		for (unsigned seed = 0; seed < 200; ++seed) {
+			CheckCompose<Loadout>(seed, 4);
+		}
+	}
+	};
+
+	/* Undoing every step must return to the start, redoing every step to the end */
+	template<typename T>
+	void CheckUndoRedo(unsigned seed, int steps) {
+		std::mt19937 rng(seed);
+		T base{};
+		Mutate(rng, base);
+
+		svh::UndoJournal journal(SIZE_MAX);
+		T current = base;
+		for (int i = 0; i < steps; ++i) {
+			T next = current;
+			Mutate(rng, next);
+			journal.Record(current, next);
+			current = next;
+		}
+		const T final_state = current;
+
+		while (journal.Undo(current)) {}
+		auto difference = svh::Compare::GetChanges(base, current);
+		std::wstring message = to_wstring("\nundo seed " + std::to_string(seed) + ": " + difference.dump() + "\n");
+		Assert::IsTrue(difference.empty(), message.c_str());
+
+		while (journal.Redo(current)) {}
+		difference = svh::Compare::GetChanges(final_state, current);
+		message = to_wstring("\nredo seed " + std::to_string(seed) + ": " + difference.dump() + "\n");
+		Assert::IsTrue(difference.empty(), message.c_str());
+	}
+
+	TEST_CLASS(InvertPatches) {
+public:
+	TEST_METHOD(Map_UndoOnlyStoresTouchedKeys) {
+		std::map<int, std::string> a{ {1, "a"}, {2, "b"}, {3, "c"} };
+		std::map<int, std::string> b{ {2, "x"}, {3, "c"}, {4, "d"} };
+		auto patch = svh::GetInvertibleChanges(a, b);
+		svh::json expected = {
+			{ svh::REMOVED, svh::json::array({ 4 }) },
+			{ svh::CHANGED_VALUES, svh::json::array({ { { "2", "b" } } }) },
+			{ svh::ADDED_VALUES, svh::json::array({ { { "1", "a" } } }) }
+		};
+		Assert::AreEqual(to_wstring(expected.dump()), to_wstring(patch[svh::UNDO].dump()));
+	}
+
+	TEST_METHOD(InvertTwice) {
+		ItemHolder a;
+		ItemHolder b = a;
+		b.item_count = 7;
+		b.items.erase(b.items.begin());
+		auto patch = svh::GetInvertibleChanges(a, b);
+		Assert::AreEqual(to_wstring(patch.dump()), to_wstring(svh::Invert(svh::Invert(patch)).dump()));
+
+		svh::Overwrite::FromJson(svh::Invert(patch)[svh::REDO], b);
+		Assert::IsTrue(svh::Compare::GetChanges(a, b).empty());
+	}
+
+	TEST_METHOD(NoChanges) {
+		std::vector<int> a{ 1, 2, 3 };
+		Assert::IsTrue(svh::GetInvertibleChanges(a, a).is_null());
+	}
+
+	TEST_METHOD(RandomNestedStructs) {
+		for (unsigned seed = 0; seed < 200; ++seed) {
+			CheckUndoRedo<Loadout>(seed, 6);
+		}
+	}
+
+	TEST_METHOD(Journal_RecordDropsRedo) {
+		svh::UndoJournal journal(SIZE_MAX);
+		std::vector<int> value{ 1, 2, 3 };
+		journal.Record(std::vector<int>{ 1 }, std::vector<int>{ 1, 2 });
+		journal.Record(std::vector<int>{ 1, 2 }, std::vector<int>{ 1, 2, 3 });
+		journal.Undo(value);
+		Assert::IsTrue(journal.CanRedo());
+		journal.Record(std::vector<int>{ 1, 2 }, std::vector<int>{ 5 });
+		Assert::IsFalse(journal.CanRedo());
+		Assert::AreEqual(size_t(2), journal.UndoCount());
+	}
+
+	TEST_METHOD(Journal_MemoryBudget) {
+		std::vector<std::string> before;
+		std::vector<std::string> after{ std::string(1000, 'x') };
+		svh::json patch = svh::GetInvertibleChanges(before, after);
+		const size_t step_size = svh::EstimateSize(patch);
+
+		svh::UndoJournal journal(step_size * 3);
+		for (int i = 0; i < 10; ++i) {
+			journal.Push(patch);
+			Assert::IsTrue(journal.MemoryUsage() <= journal.MemoryBudget());
+		}
+		Assert::AreEqual(size_t(3), journal.UndoCount());
+	}
+	};
+
+	static Loadout Apply(const Loadout& base, const svh::json& patch) {
+		Loadout result = base;
+		if (base.holder) result.holder = std::make_shared<ItemHolder>(*base.holder);
+		svh::Overwrite::FromJson(patch, result);
+		return result;
+	}
+
+	/* Fields the instance did not touch follow the new base, fields the base did not change keep the instance value */
+	void CheckRebase(unsigned seed) {
+		std::mt19937 rng(seed);
+		Loadout old_base{};
+		Mutate(rng, old_base);
+		Loadout instance = Apply(old_base, svh::json());
+		Mutate(rng, instance);
+		Loadout new_base = Apply(old_base, svh::json());
+		Mutate(rng, new_base);
+		/* Keep the pointer fields comparable, Compare does not support null to set */
+		if (!instance.holder) instance.holder = std::make_shared<ItemHolder>();
+
+		auto patch = svh::Compare::GetChanges(old_base, instance);
+		auto rebased = svh::Rebase(old_base, new_base, patch);
+		Loadout result = Apply(new_base, rebased.patch);
+
+		auto old_json = svh::Serializer::ToJson(old_base);
+		auto new_json = svh::Serializer::ToJson(new_base);
+		auto instance_json = svh::Serializer::ToJson(instance);
+		auto result_json = svh::Serializer::ToJson(result);
+		std::wstring message = to_wstring("\nseed " + std::to_string(seed) + ": " + rebased.patch.dump() + "\n");
+		for (auto it = result_json.begin(); it != result_json.end(); ++it) {
+			if (!patch.is_object() || !patch.contains(it.key())) {
+				Assert::AreEqual(to_wstring(new_json[it.key()].dump()), to_wstring(it.value().dump()), message.c_str());
+			} else if (old_json[it.key()] == new_json[it.key()]) {
+				Assert::AreEqual(to_wstring(instance_json[it.key()].dump()), to_wstring(it.value().dump()), message.c_str());
+			}
+		}
+		if (rebased.conflicts.empty() && old_json == new_json) {
+			Assert::AreEqual(to_wstring(instance_json.dump()), to_wstring(result_json.dump()), message.c_str());
+		}
+	}
+
+	TEST_CLASS(RebasePatches) {
+public:
+	TEST_METHOD(BaseUnchanged) {
+		Loadout base;
+		base.stats = { 1, 2, 3 };
+		Loadout instance = base;
+		instance.stats.push_back(4);
+		auto patch = svh::Compare::GetChanges(base, instance);
+		auto rebased = svh::Rebase(base, base, patch);
+		Assert::AreEqual(to_wstring(patch.dump()), to_wstring(rebased.patch.dump()));
+		Assert::IsTrue(rebased.conflicts.empty());
+	}
+
+	TEST_METHOD(DifferentFields) {
+		Loadout old_base;
+		Loadout instance = old_base;
+		instance.name = "instance";
+		Loadout new_base = old_base;
+		new_base.stats = { 7 };
+
+		auto rebased = svh::Rebase(old_base, new_base, svh::Compare::GetChanges(old_base, instance));
+		Loadout result = Apply(new_base, rebased.patch);
+		Assert::AreEqual(to_wstring("instance"), to_wstring(result.name));
+		Assert::AreEqual(to_wstring("[7]"), to_wstring(svh::Serializer::ToJson(result.stats).dump()));
+		Assert::IsTrue(rebased.conflicts.empty());
+	}
+
+	TEST_METHOD(SameFieldConflict) {
+		Loadout old_base;
+		Loadout instance = old_base;
+		instance.name = "instance";
+		Loadout new_base = old_base;
+		new_base.name = "base";
+
+		auto rebased = svh::Rebase(old_base, new_base, svh::Compare::GetChanges(old_base, instance));
+		Assert::AreEqual(size_t(1), rebased.conflicts.size());
+		Assert::AreEqual(size_t(0), rebased.conflicts[0].path[0].index);
+		Assert::AreEqual(to_wstring("\"base\""), to_wstring(rebased.conflicts[0].base.dump()));
+		Assert::AreEqual(to_wstring("instance"), to_wstring(Apply(new_base, rebased.patch).name));
+	}
+
+	TEST_METHOD(SameValueIsNotAConflict) {
+		Loadout old_base;
+		Loadout instance = old_base;
+		instance.name = "same";
+		Loadout new_base = old_base;
+		new_base.name = "same";
+
+		auto rebased = svh::Rebase(old_base, new_base, svh::Compare::GetChanges(old_base, instance));
+		Assert::IsTrue(rebased.patch.is_null());
+		Assert::IsTrue(rebased.conflicts.empty());
+	}
+
+	TEST_METHOD(VectorThreeWayMerge) {
+		Loadout old_base;
+		old_base.stats = { 1, 2, 3 };
+		Loadout instance = old_base;
+		instance.stats.insert(instance.stats.begin(), 0);
+		Loadout new_base = old_base;
+		new_base.stats.push_back(4);
+
+		auto rebased = svh::Rebase(old_base, new_base, svh::Compare::GetChanges(old_base, instance));
+		Assert::IsTrue(rebased.conflicts.empty());
+		Assert::AreEqual(to_wstring("[0,1,2,3,4]"), to_wstring(svh::Serializer::ToJson(Apply(new_base, rebased.patch).stats).dump()));
+	}
+
+	TEST_METHOD(VectorConflict) {
+		Loadout old_base;
+		old_base.stats = { 1, 2, 3 };
+		Loadout instance = old_base;
+		instance.stats[1] = 5;
+		Loadout new_base = old_base;
+		new_base.stats[1] = 6;
+
+		auto rebased = svh::Rebase(old_base, new_base, svh::Compare::GetChanges(old_base, instance));
+		Assert::AreEqual(size_t(1), rebased.conflicts.size());
+		Assert::AreEqual(to_wstring("[1,5,3]"), to_wstring(svh::Serializer::ToJson(Apply(new_base, rebased.patch).stats).dump()));
+	}
+
+	TEST_METHOD(MapKeys) {
+		Loadout old_base;
+		old_base.slots = { { 1, "a" }, { 2, "b" }, { 3, "c" } };
+		Loadout instance = old_base;
+		instance.slots[2] = "instance";
+		instance.slots[4] = "added";
+		Loadout new_base = old_base;
+		new_base.slots.erase(1);
+		new_base.slots.erase(2);
+		new_base.slots[3] = "base";
+
+		auto rebased = svh::Rebase(old_base, new_base, svh::Compare::GetChanges(old_base, instance));
+		Loadout result = Apply(new_base, rebased.patch);
+		Assert::AreEqual(to_wstring(R"({"2":"instance","3":"base","4":"added"})"), to_wstring(svh::Serializer::ToJson(result.slots).dump()));
+		/* Key 2 was removed by the base but changed by the instance */
+		Assert::AreEqual(size_t(1), rebased.conflicts.size());
+		Assert::AreEqual(to_wstring("2"), to_wstring(rebased.conflicts[0].path.back().key));
+	}
+
+	TEST_METHOD(RandomNestedStructs) {
+		for (unsigned seed = 0; seed < 200; ++seed) {
+			CheckRebase(seed);
+		}
+	}
+	};
+
+	TEST_CLASS(MaskPatches) {
+public:
+	TEST_METHOD(StructFields) {
+		Loadout base;
+		base.name = "base";
+		base.stats = { 1, 2 };
+		Loadout edited = base;
+		edited.name = "edited";
+		edited.stats = { 1, 3 };
+		Loadout instance = base;
+		instance.name = "instance";
+
+		auto masked = svh::MaskPatch<Loadout>(svh::Compare::GetChanges(base, edited), svh::Compare::GetChanges(base, instance));
+		Loadout result = Apply(instance, masked);
+		Assert::AreEqual(to_wstring("instance"), to_wstring(result.name));
+		Assert::AreEqual(to_wstring("[1,3]"), to_wstring(svh::Serializer::ToJson(result.stats).dump()));
+	}
+
+	TEST_METHOD(MapKeys) {
+		Loadout base;
+		base.slots = { { 1, "a" }, { 2, "b" } };
+		Loadout edited = base;
+		edited.slots[1] = "edited";
+		edited.slots[2] = "edited";
+		edited.slots[3] = "added";
+		Loadout instance = base;
+		instance.slots[2] = "instance";
+
+		auto masked = svh::MaskPatch<Loadout>(svh::Compare::GetChanges(base, edited), svh::Compare::GetChanges(base, instance));
+		Loadout result = Apply(instance, masked);
+		Assert::AreEqual(to_wstring(R"({"1":"edited","2":"instance","3":"added"})"), to_wstring(svh::Serializer::ToJson(result.slots).dump()));
+	}
+
+	TEST_METHOD(EmptyMask) {
+		Loadout base;
+		Loadout edited = base;
+		edited.name = "edited";
+		auto patch = svh::Compare::GetChanges(base, edited);
+		Assert::AreEqual(to_wstring(patch.dump()), to_wstring(svh::MaskPatch<Loadout>(patch, svh::json()).dump()));
+	}
+	};
+}
@@ -0,0 +1,120 @@
+﻿#pragma once
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "svh/serializer.hpp"
+#include "svh/prefab_cache.hpp"
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace prefab_cache_tests {
+
+	static std::wstring to_wstring(const std::string& s) {
+		return std::wstring(s.begin(), s.end());
+	}
+
+	static std::string MakeContent(const std::string& name) {
+		Loadout prefab;
+		prefab.name = name;
+		prefab.stats = { 1, 2, 3 };
+		prefab.weapons = { { "rifle", 5 } };
+		return svh::Serializer::ToJson(prefab).dump();
+	}
+
+	TEST_CLASS(PrefabCache) {
+public:
+	TEST_METHOD(HitsAndMisses) {
+		svh::PrefabCache<Loadout> cache(1 << 20);
+		auto first = cache.Get("soldier.json", MakeContent("soldier"));
+		auto second = cache.Get("soldier.json", MakeContent("soldier"));
+		Assert::IsTrue(first == second);
+		Assert::AreEqual(to_wstring("soldier"), to_wstring(first->name));
+		Assert::AreEqual(size_t(1), cache.Stats().hits);
+		Assert::AreEqual(size_t(1), cache.Stats().misses);
+	}
+
+	TEST_METHOD(ChangedContentIsNotServed) {
+		svh::PrefabCache<Loadout> cache(1 << 20);
+		auto old_value = cache.Get("soldier.json", MakeContent("soldier"));
+		auto new_value = cache.Get("soldier.json", MakeContent("veteran"));
+		Assert::AreEqual(to_wstring("veteran"), to_wstring(new_value->name));
+		/* The old version stays valid for whoever holds it */
+		Assert::AreEqual(to_wstring("soldier"), to_wstring(old_value->name));
+		Assert::AreEqual(size_t(2), cache.Stats().misses);
+		Assert::AreEqual(size_t(1), cache.Size());
+	}
+
+	TEST_METHOD(EvictsToBudget) {
+		svh::PrefabCache<Loadout> probe(1 << 20);
+		probe.Get("probe", MakeContent("prefab 0"));
+		const std::size_t entry = probe.MemoryUsage();
+
+		svh::PrefabCache<Loadout> cache(entry * 4);
+		for (int i = 0; i < 10; ++i) {
+			cache.Get("prefab " + std::to_string(i), MakeContent("prefab " + std::to_string(i)));
+		}
+		Assert::IsTrue(cache.MemoryUsage() <= cache.MemoryBudget());
+		Assert::AreEqual(size_t(4), cache.Size());
+		Assert::AreEqual(size_t(6), cache.Stats().evictions);
+		Assert::IsTrue(cache.Contains("prefab 9"));
+	}
+
+	TEST_METHOD(RecentlyUsedSurvives) {
+		svh::PrefabCache<Loadout> probe(1 << 20);
+		probe.Get("probe", MakeContent("prefab 0"));
+		const std::size_t entry = probe.MemoryUsage();
+
+		svh::PrefabCache<Loadout> cache(entry * 3);
+		for (int i = 0; i < 3; ++i) {
+			cache.Get("prefab " + std::to_string(i), MakeContent("prefab " + std::to_string(i)));
+		}
+		/* A hit gives prefab 0 a second chance, prefab 1 is evicted instead */
+		cache.Get("prefab 0", MakeContent("prefab 0"));
+		cache.Get("prefab 3", MakeContent("prefab 3"));
+		Assert::IsTrue(cache.Contains("prefab 0"));
+		Assert::IsFalse(cache.Contains("prefab 1"));
+	}
+
+	TEST_METHOD(InvalidContent) {
+		svh::PrefabCache<Loadout> cache(1 << 20);
+		bool thrown = false;
+		try {
+			cache.Get("broken.json", "{ \"name\": ");
+		} catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		Assert::IsTrue(thrown);
+		Assert::AreEqual(size_t(0), cache.Size());
+	}
+
+	TEST_METHOD(ConcurrentReaders) {
+		svh::PrefabCache<Loadout> cache(1 << 16);
+		std::vector<std::string> contents;
+		for (int i = 0; i < 32; ++i) {
+			contents.push_back(MakeContent("prefab " + std::to_string(i)));
+		}
+		std::vector<std::thread> threads;
+		std::atomic<int> wrong{ 0 };
+		for (int t = 0; t < 4; ++t) {
+			threads.emplace_back([&, t]() {
+				for (int i = 0; i < 2000; ++i) {
+					const int id = (i * 7 + t) % 32;
+					auto value = cache.Get("prefab " + std::to_string(id), contents[id]);
+					if (value->name != "prefab " + std::to_string(id)) ++wrong;
+				}
+			});
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
+		auto stats = cache.Stats();
+		Assert::AreEqual(0, wrong.load());
+		Assert::AreEqual(size_t(8000), stats.hits + stats.misses);
+		Assert::IsTrue(cache.MemoryUsage() <= cache.MemoryBudget());
+	}
+	};
+}
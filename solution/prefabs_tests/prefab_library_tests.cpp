@@ -0,0 +1,242 @@
+﻿#pragma once
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "svh/serializer.hpp"
+#include "svh/prefab_library.hpp"
+
+#include <vector>
+#include <string>
+#include <chrono>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace prefab_library_tests {
+
+	static std::wstring to_wstring(const std::string& s) {
+		return std::wstring(s.begin(), s.end());
+	}
+
+	static Loadout MakeBase() {
+		Loadout base;
+		base.name = "soldier";
+		base.stats = { 10, 20, 30 };
+		base.weapons = { { "rifle", 5 }, { "knife", 2 } };
+		base.slots = { { 0, "head" }, { 1, "chest" } };
+		base.upgrades = { { "armor", { 1, 2 } } };
+		return base;
+	}
+
+	static svh::json MakeOverride(const std::string& name) {
+		Loadout base = MakeBase();
+		Loadout variant = base;
+		variant.name = name;
+		variant.stats.push_back(40);
+		variant.slots[2] = "legs";
+		return svh::Compare::GetChanges(base, variant);
+	}
+
+	TEST_CLASS(PrefabLibrary) {
+public:
+	TEST_METHOD(ResolveOverride) {
+		svh::PrefabLibrary<Loadout> library;
+		library.SetBase("soldier", MakeBase());
+		library.SetOverride("captain", "soldier", MakeOverride("captain"));
+
+		Loadout captain = library.Instantiate("captain");
+		Assert::AreEqual(to_wstring("captain"), to_wstring(captain.name));
+		Assert::AreEqual(to_wstring("[10,20,30,40]"), to_wstring(svh::Serializer::ToJson(captain.stats).dump()));
+		Assert::AreEqual(to_wstring("soldier"), to_wstring(library.Instantiate("soldier").name));
+	}
+
+	TEST_METHOD(ResultIsCached) {
+		svh::PrefabLibrary<Loadout> library;
+		library.SetBase("soldier", MakeBase());
+		library.SetOverride("captain", "soldier", MakeOverride("captain"));
+		Assert::IsFalse(library.IsCached("captain"));
+
+		const Loadout& first = library.Resolve("captain");
+		const Loadout& second = library.Resolve("captain");
+		Assert::IsTrue(&first == &second);
+		Assert::IsTrue(library.IsCached("captain"));
+		Assert::IsTrue(library.IsCached("soldier"));
+	}
+
+	TEST_METHOD(BaseChangeInvalidatesDerived) {
+		svh::PrefabLibrary<Loadout> library;
+		library.SetBase("soldier", MakeBase());
+		library.SetOverride("captain", "soldier", MakeOverride("captain"));
+		library.SetOverride("general", "captain", svh::json{ { "name", "general" } });
+		library.SetBase("medic", MakeBase());
+		library.Resolve("general");
+		library.Resolve("medic");
+
+		Loadout base = MakeBase();
+		base.weapons[0].damage = 50;
+		library.SetBase("soldier", base);
+		Assert::IsFalse(library.IsCached("captain"));
+		Assert::IsFalse(library.IsCached("general"));
+		Assert::IsTrue(library.IsCached("medic"));
+
+		Loadout general = library.Instantiate("general");
+		Assert::AreEqual(to_wstring("general"), to_wstring(general.name));
+		Assert::AreEqual(50, general.weapons[0].damage);
+	}
+
+	TEST_METHOD(OverrideChangeInvalidates) {
+		svh::PrefabLibrary<Loadout> library;
+		library.SetBase("soldier", MakeBase());
+		library.SetOverride("captain", "soldier", MakeOverride("captain"));
+		library.Resolve("captain");
+
+		library.SetOverride("captain", "soldier", MakeOverride("major"));
+		Assert::AreEqual(to_wstring("major"), to_wstring(library.Instantiate("captain").name));
+		Assert::IsTrue(library.IsCached("soldier"));
+	}
+
+	TEST_METHOD(MissingPrefab) {
+		svh::PrefabLibrary<Loadout> library;
+		library.SetOverride("orphan", "missing", svh::json());
+		bool thrown = false;
+		try {
+			library.Resolve("orphan");
+		} catch (const std::exception&) {
+			thrown = true;
+		}
+		Assert::IsTrue(thrown);
+	}
+
+	TEST_METHOD(ParentCycle) {
+		svh::PrefabLibrary<Loadout> library;
+		bool thrown = false;
+		try {
+			library.SetOverride("x", "x", svh::json());
+		} catch (const std::exception&) {
+			thrown = true;
+		}
+		Assert::IsTrue(thrown);
+		Assert::IsFalse(library.Contains("x"));
+
+		library.SetOverride("a", "b", svh::json());
+		thrown = false;
+		try {
+			library.SetOverride("b", "a", svh::json());
+		} catch (const std::exception&) {
+			thrown = true;
+		}
+		Assert::IsTrue(thrown);
+		Assert::IsFalse(library.Contains("b"));
+
+		/* A base for the missing parent makes it resolvable */
+		library.SetBase("b", MakeBase());
+		Assert::AreEqual(to_wstring("soldier"), to_wstring(library.Instantiate("a").name));
+
+		/* Turning the base into an override of its own dependent is rejected too, b stays a base */
+		thrown = false;
+		try {
+			library.SetOverride("b", "a", svh::json());
+		} catch (const std::exception&) {
+			thrown = true;
+		}
+		Assert::IsTrue(thrown);
+		library.SetBase("a", MakeBase());
+		Assert::IsTrue(library.IsCached("b"));
+	}
+
+	TEST_METHOD(InvalidatesOnlyDependents) {
+		svh::PrefabLibrary<Loadout> library;
+		library.SetBase("soldier", MakeBase());
+		library.SetOverride("captain", "soldier", MakeOverride("captain"));
+		library.SetOverride("general", "captain", svh::json{ { "name", "general" } });
+		library.SetOverride("sniper", "soldier", svh::json{ { "name", "sniper" } });
+		library.SetBase("medic", MakeBase());
+		Assert::AreEqual(size_t(5), library.ResolveAll());
+
+		library.SetOverride("captain", "soldier", MakeOverride("major"));
+		Assert::IsTrue(library.IsCached("soldier"));
+		Assert::IsTrue(library.IsCached("sniper"));
+		Assert::IsTrue(library.IsCached("medic"));
+		Assert::IsFalse(library.IsCached("general"));
+
+		/* Only captain and general are computed again */
+		Assert::AreEqual(size_t(2), library.ResolveAll());
+		Assert::AreEqual(to_wstring("[10,20,30,40]"), to_wstring(svh::Serializer::ToJson(library.Resolve("general").stats).dump()));
+	}
+
+	TEST_METHOD(ChangeParent) {
+		svh::PrefabLibrary<Loadout> library;
+		Loadout other = MakeBase();
+		other.stats = { 1 };
+		library.SetBase("soldier", MakeBase());
+		library.SetBase("other", other);
+		library.SetOverride("captain", "soldier", svh::json{ { "name", "captain" } });
+		library.ResolveAll();
+
+		library.SetOverride("captain", "other", svh::json{ { "name", "captain" } });
+		library.SetBase("soldier", MakeBase());
+		library.ResolveAll();
+		Assert::AreEqual(to_wstring("[1]"), to_wstring(svh::Serializer::ToJson(library.Resolve("captain").stats).dump()));
+
+		/* No longer a dependent of soldier */
+		library.SetBase("soldier", MakeBase());
+		Assert::IsTrue(library.IsCached("captain"));
+	}
+
+	/* Resolving every wave in parallel gives the same prefabs as resolving one by one */
+	TEST_METHOD(ResolveAllMatchesResolve) {
+		svh::PrefabLibrary<Loadout> parallel;
+		svh::PrefabLibrary<Loadout> sequential;
+		for (auto* library : { &parallel, &sequential }) {
+			library->SetBase("0", MakeBase());
+			for (int i = 1; i < 300; ++i) {
+				svh::json patch = {
+					{ "name", "prefab " + std::to_string(i) },
+					{ "stats", { { svh::ADDED_VALUES, svh::json::array({ { { svh::INDEX, { 0 } }, { svh::VALUE, i } } }) } } }
+				};
+				library->SetOverride(std::to_string(i), std::to_string((i - 1) / 3), patch);
+			}
+			/* Missing parent is skipped */
+			library->SetOverride("orphan", "missing", svh::json());
+		}
+
+		Assert::AreEqual(size_t(300), parallel.ResolveAll(4));
+		for (int i = 0; i < 300; ++i) {
+			auto id = std::to_string(i);
+			auto difference = svh::Compare::GetChanges(sequential.Resolve(id), parallel.Resolve(id));
+			Assert::IsTrue(difference.empty(), to_wstring(id + ": " + difference.dump()).c_str());
+		}
+		Assert::IsFalse(parallel.IsCached("orphan"));
+	}
+
+	/* Spawning from the cache against deserializing the base and applying the override every time */
+	TEST_METHOD(SpawnLatency) {
+		const int count = 10000;
+		const svh::json base_json = svh::Serializer::ToJson(MakeBase());
+		const svh::json patch = MakeOverride("captain");
+
+		auto start = std::chrono::steady_clock::now();
+		std::vector<Loadout> from_json(count);
+		for (auto& instance : from_json) {
+			svh::Deserializer::FromJson(base_json, instance);
+			svh::Overwrite::FromJson(patch, instance);
+		}
+		auto middle = std::chrono::steady_clock::now();
+
+		svh::PrefabLibrary<Loadout> library;
+		library.SetBaseJson("soldier", base_json);
+		library.SetOverride("captain", "soldier", patch);
+		std::vector<Loadout> from_cache;
+		from_cache.reserve(count);
+		for (int i = 0; i < count; ++i) {
+			from_cache.push_back(library.Instantiate("captain"));
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		Assert::IsTrue(svh::Compare::GetChanges(from_json.back(), from_cache.back()).empty());
+
+		auto json_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(middle - start).count() / count;
+		auto cache_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - middle).count() / count;
+		std::wstring message = L"json path: " + std::to_wstring(json_ns) + L" ns/spawn, cached: " + std::to_wstring(cache_ns) + L" ns/spawn\n";
+		Logger::WriteMessage(message.c_str());
+	}
+	};
+}
@@ -0,0 +1,120 @@
+﻿#pragma once
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "svh/serializer.hpp"
+#include "svh/published.hpp"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace published_tests {
+
+	static std::wstring to_wstring(const std::string& s) {
+		return std::wstring(s.begin(), s.end());
+	}
+
+	/* Every stat equals the length of the name, so a reader can tell a torn version */
+	static Loadout MakeVersion(int version) {
+		Loadout value;
+		value.name = std::string(static_cast<size_t>(version % 50 + 1), 'x');
+		value.stats.assign(8, static_cast<int>(value.name.size()));
+		value.weapons = { { "rifle", version } };
+		return value;
+	}
+
+	static bool IsConsistent(const Loadout& value) {
+		for (int stat : value.stats) {
+			if (stat != static_cast<int>(value.name.size())) return false;
+		}
+		return value.stats.size() == 8;
+	}
+
+	TEST_CLASS(Published) {
+public:
+	TEST_METHOD(ReadAndPublish) {
+		svh::Published<Loadout> published(MakeVersion(1));
+		auto first = published.Read();
+		Assert::AreEqual(1, first->weapons[0].damage);
+
+		published.Publish(MakeVersion(2));
+		Assert::AreEqual(2, published.Read()->weapons[0].damage);
+		/* A snapshot keeps its version */
+		Assert::AreEqual(1, first->weapons[0].damage);
+		Assert::AreEqual(uint64_t(1), published.VersionCount());
+	}
+
+	TEST_METHOD(OldVersionsAreFreed) {
+		svh::Published<Loadout> published(MakeVersion(1));
+		std::weak_ptr<const Loadout> first = published.Read();
+		auto second = std::make_shared<const Loadout>(MakeVersion(2));
+		published.Publish(second);
+		Assert::IsTrue(first.expired());
+
+		std::weak_ptr<const Loadout> weak = second;
+		auto snapshot = published.Read();
+		second.reset();
+		published.Publish(MakeVersion(3));
+		Assert::IsFalse(weak.expired());
+		snapshot.reset();
+		Assert::IsTrue(weak.expired());
+	}
+
+	TEST_METHOD(UpdateAndPatch) {
+		svh::Published<Loadout> published(MakeVersion(1));
+		published.Update([](Loadout& next) { next.slots[0] = "head"; });
+		Loadout patched = *published.Read();
+		patched.weapons[0].damage = 7;
+		published.Patch(svh::Compare::GetChanges(*published.Read(), patched));
+
+		auto latest = published.Read();
+		Assert::AreEqual(to_wstring("head"), to_wstring(latest->slots.at(0)));
+		Assert::AreEqual(7, latest->weapons[0].damage);
+		Assert::AreEqual(uint64_t(2), published.VersionCount());
+	}
+
+	/* Readers never see a torn version while a writer publishes as fast as it can */
+	TEST_METHOD(ConcurrentReaders) {
+		svh::Published<Loadout> published(MakeVersion(0));
+		std::atomic<bool> done{ false };
+		std::atomic<size_t> reads{ 0 };
+		std::atomic<size_t> torn{ 0 };
+
+		std::vector<std::thread> readers;
+		for (int t = 0; t < 4; ++t) {
+			readers.emplace_back([&]() {
+				int last = 0;
+				while (!done.load()) {
+					auto snapshot = published.Read();
+					if (!IsConsistent(*snapshot) || snapshot->weapons[0].damage < last) torn.fetch_add(1);
+					last = snapshot->weapons[0].damage;
+					reads.fetch_add(1, std::memory_order_relaxed);
+				}
+			});
+		}
+
+		constexpr int versions = 2000;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int v = 1; v <= versions; ++v) {
+			published.Publish(MakeVersion(v));
+			/* Lets the readers run on machines with few cores */
+			if (v % 100 == 0) std::this_thread::yield();
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		done = true;
+		for (auto& reader : readers) {
+			reader.join();
+		}
+
+		Assert::AreEqual(size_t(0), torn.load());
+		Assert::AreEqual(versions, published.Read()->weapons[0].damage);
+		std::wstring message = L"Published " + std::to_wstring(versions) + L" versions in " + std::to_wstring(std::chrono::duration<double, std::milli>(end - start).count()) + L" ms with " + std::to_wstring(reads.load()) + L" concurrent reads";
+		Logger::WriteMessage(message.c_str());
+	}
+	};
+}
@@ -0,0 +1,229 @@
+﻿#pragma once
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "svh/serializer.hpp"
+#include "svh/replication.hpp"
+
+#include <vector>
+#include <string>
+#include <map>
+#include <cmath>
+#include <chrono>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace replication_tests {
+
+	static std::wstring to_wstring(const std::string& s) {
+		return std::wstring(s.begin(), s.end());
+	}
+
+	struct Unit {
+		std::string name;
+		float position[3];
+		float yaw;
+		int health;
+		int ammo;
+		std::uint8_t stance;
+		bool firing;
+		std::map<std::string, int> buffs;
+	};
+
+	struct World {
+		std::vector<Unit> units;
+		std::uint32_t time;
+	};
+}
+
+VISITABLE_STRUCT(replication_tests::Unit, name, position, yaw, health, ammo, stance, firing, buffs);
+VISITABLE_STRUCT(replication_tests::World, units, time);
+
+/* Positions in a 2 km world to about 1 cm, yaw to about a degree, health 0 to 100 */
+template<> struct svh::replicated_field<&replication_tests::Unit::position> { static constexpr int bits = 18; static constexpr double min = -1024, max = 1024; };
+template<> struct svh::replicated_field<&replication_tests::Unit::yaw> { static constexpr int bits = 9; static constexpr double min = 0, max = 360; };
+template<> struct svh::replicated_field<&replication_tests::Unit::health> { static constexpr int bits = 7; static constexpr double min = 0, max = 100; };
+
+namespace replication_tests {
+
+	static World MakeWorld(int units) {
+		World world{};
+		for (int i = 0; i < units; ++i) {
+			Unit unit{};
+			unit.name = "unit " + std::to_string(i);
+			unit.position[0] = static_cast<float>(i % 100) * 10;
+			unit.position[2] = static_cast<float>(i / 100) * 10;
+			unit.yaw = 90;
+			unit.health = 100;
+			unit.ammo = 30;
+			world.units.push_back(unit);
+		}
+		return world;
+	}
+
+	/* Every unit walks forward, every tenth one turns and shoots */
+	static void Step(World& world, std::uint32_t tick) {
+		world.time = tick;
+		for (std::size_t i = 0; i < world.units.size(); ++i) {
+			Unit& unit = world.units[i];
+			unit.position[0] += 0.05f;
+			if ((i + tick) % 10 == 0) {
+				unit.yaw = std::fmod(unit.yaw + 15, 360.0f);
+				unit.firing = !unit.firing;
+				unit.ammo = unit.ammo > 0 ? unit.ammo - 1 : 30;
+			}
+			if ((i + tick) % 50 == 0) {
+				unit.health = unit.health > 10 ? unit.health - 10 : 100;
+				unit.stance = static_cast<std::uint8_t>((unit.stance + 1) % 3);
+			}
+		}
+	}
+
+	/* Quantized fields within half a step, everything else exact */
+	static bool Matches(const World& sent, const World& received) {
+		if (sent.units.size() != received.units.size() || sent.time != received.time) {
+			return false;
+		}
+		for (std::size_t i = 0; i < sent.units.size(); ++i) {
+			const Unit& a = sent.units[i];
+			const Unit& b = received.units[i];
+			for (int axis = 0; axis < 3; ++axis) {
+				if (std::abs(a.position[axis] - b.position[axis]) > 0.005f) return false;
+			}
+			if (std::abs(a.yaw - b.yaw) > 0.36f || a.health != b.health || a.ammo != b.ammo || a.stance != b.stance ||
+				a.firing != b.firing || a.name != b.name || a.buffs != b.buffs) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	TEST_CLASS(Replication) {
+public:
+	TEST_METHOD(RoundTrip) {
+		World world = MakeWorld(20);
+		world.units[3].buffs = { { "haste", 2 } };
+		svh::ReplicationEncoder<World> encoder;
+		svh::ReplicationDecoder<World> decoder;
+		World received;
+		for (std::uint32_t tick = 1; tick <= 20; ++tick) {
+			Step(world, tick);
+			if (tick == 7) world.units.push_back(world.units[0]);
+			if (tick == 12) world.units.resize(10);
+			Assert::IsTrue(decoder.Decode(encoder.Encode(1, tick, world), received));
+			encoder.Acknowledge(1, decoder.LastTick());
+			Assert::IsTrue(Matches(world, received));
+		}
+		Assert::AreEqual(2, received.units[3].buffs["haste"]);
+	}
+
+	TEST_METHOD(Quantization) {
+		World world = MakeWorld(1);
+		world.units[0].health = 250;
+		world.units[0].position[1] = 0.1234f;
+		svh::ReplicationEncoder<World> encoder;
+		svh::ReplicationDecoder<World> decoder;
+		World received;
+		Assert::IsTrue(decoder.Decode(encoder.Encode(1, 1, world), received));
+		/* Clamped to the range */
+		Assert::AreEqual(100, received.units[0].health);
+		Assert::IsTrue(std::abs(received.units[0].position[1] - 0.1234f) < 0.005f);
+
+		/* A change smaller than a step is not sent */
+		encoder.Acknowledge(1, 1);
+		world.units[0].health = 100;
+		const auto unchanged = encoder.Encode(1, 2, world);
+		world.units[0].position[1] += 0.0001f;
+		const auto tiny = encoder.Encode(1, 3, world);
+		Assert::AreEqual(unchanged.size(), tiny.size());
+	}
+
+	TEST_METHOD(Baselines) {
+		World world = MakeWorld(10);
+		svh::ReplicationEncoder<World> encoder(8);
+		svh::ReplicationDecoder<World> decoder(8);
+		World received;
+
+		/* Without acknowledgements every packet is a full state */
+		Step(world, 1);
+		const auto full = encoder.Encode(1, 1, world);
+		Step(world, 2);
+		Assert::IsTrue(encoder.Encode(1, 2, world).size() >= full.size() / 2);
+		Assert::IsTrue(decoder.Decode(full, received));
+		encoder.Acknowledge(1, 1);
+
+		/* Lost packets: later deltas still decode against the acknowledged baseline */
+		for (std::uint32_t tick = 3; tick <= 6; ++tick) {
+			Step(world, tick);
+			encoder.Encode(1, tick, world);
+		}
+		Step(world, 7);
+		const auto delta = encoder.Encode(1, 7, world);
+		Assert::IsTrue(delta.size() < full.size());
+		Assert::IsTrue(decoder.Decode(delta, received));
+		Assert::IsTrue(Matches(world, received));
+
+		/* A second receiver starts from a full state */
+		Assert::IsTrue(encoder.Encode(2, 7, world).size() > delta.size());
+		Assert::AreEqual(size_t(2), encoder.ReceiverCount());
+
+		/* The baseline of a packet that arrives too late is gone */
+		svh::ReplicationDecoder<World> late(8);
+		Assert::IsFalse(late.Decode(delta, received));
+
+		bool thrown = false;
+		try {
+			decoder.Decode(std::vector<std::uint8_t>{ 1, 2 }, received);
+		} catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		Assert::IsTrue(thrown);
+	}
+
+	/* Loopback: one sender, one receiver acknowledging every packet it gets, every seventh packet lost */
+	TEST_METHOD(Loopback) {
+		const int units = 1000;
+		const std::uint32_t ticks = 120;
+		World world = MakeWorld(units);
+		svh::ReplicationEncoder<World> encoder;
+		svh::ReplicationDecoder<World> decoder;
+		World received;
+		World previous = world;
+
+		std::size_t bytes = 0;
+		std::size_t json_bytes = 0;
+		double encode_s = 0;
+		double decode_s = 0;
+		for (std::uint32_t tick = 1; tick <= ticks; ++tick) {
+			Step(world, tick);
+			/* Per unit, Compare on the whole vector is quadratic in its size */
+			for (int i = 0; i < units; ++i) {
+				const svh::json changes = svh::Compare::GetChanges(previous.units[i], world.units[i]);
+				if (!changes.is_null()) json_bytes += changes.dump().size();
+			}
+			previous = world;
+
+			auto start = std::chrono::high_resolution_clock::now();
+			const auto packet = encoder.Encode(1, tick, world);
+			auto encoded = std::chrono::high_resolution_clock::now();
+			encode_s += std::chrono::duration<double>(encoded - start).count();
+			if (tick % 7 == 0) {
+				continue;
+			}
+			bytes += packet.size();
+			start = std::chrono::high_resolution_clock::now();
+			Assert::IsTrue(decoder.Decode(packet, received));
+			decode_s += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			encoder.Acknowledge(1, decoder.LastTick());
+			Assert::IsTrue(Matches(world, received));
+		}
+		const double delivered = static_cast<double>(ticks - ticks / 7);
+		const double per_entity = static_cast<double>(bytes) / delivered / units;
+		const double json_per_entity = static_cast<double>(json_bytes) / ticks / units;
+		Assert::IsTrue(per_entity * 4 < json_per_entity);
+
+		std::wstring message = std::to_wstring(per_entity) + L" bytes per entity per tick, Compare json " + std::to_wstring(json_per_entity) +
+			L". Encode " + std::to_wstring(units * ticks / encode_s / 1e6) + L"M, decode " + std::to_wstring(units * delivered / decode_s / 1e6) + L"M entities/s";
+		Logger::WriteMessage(message.c_str());
+	}
+	};
+}
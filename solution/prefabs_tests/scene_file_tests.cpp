@@ -0,0 +1,191 @@
+﻿#pragma once
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "svh/serializer.hpp"
+#include "svh/scene_file.hpp"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace scene_file_tests {
+
+	static std::wstring to_wstring(const std::string& s) {
+		return std::wstring(s.begin(), s.end());
+	}
+
+	/* A unit box at x */
+	static svh::SceneKeys Keys(float x, std::vector<std::string> tags) {
+		svh::SceneKeys keys;
+		keys.tags = std::move(tags);
+		keys.has_bounds = true;
+		keys.bounds = { { x, 0, 0 }, { x + 1, 1, 1 } };
+		return keys;
+	}
+
+	TEST_CLASS(SceneFile) {
+public:
+	TEST_METHOD(LoadEntity) {
+		auto path = TempPath("load", ".svhs");
+		{
+			svh::SceneWriter writer(path);
+			writer.Add("soldier", MakeLoadout("soldier", 5));
+			writer.Add("captain", MakeLoadout("captain", 8));
+			Assert::AreEqual(size_t(2), writer.Size());
+		}
+		svh::SceneFile scene;
+		Assert::IsTrue(scene.Open(path));
+		Assert::AreEqual(size_t(2), scene.Size());
+		Loadout loadout;
+		Assert::IsTrue(scene.LoadEntity("captain", loadout));
+		Assert::IsTrue(svh::Compare::GetChanges(MakeLoadout("captain", 8), loadout).is_null());
+		Assert::IsFalse(scene.LoadEntity("missing", loadout));
+		scene.Close();
+		std::filesystem::remove(path);
+	}
+
+	TEST_METHOD(TagsAndRegions) {
+		auto path = TempPath("keys", ".svhs");
+		{
+			svh::SceneWriter writer(path);
+			writer.Add("a", MakeLoadout("a", 1), Keys(0, { "enemy" }));
+			writer.Add("b", MakeLoadout("b", 2), Keys(10, { "enemy", "boss" }));
+			writer.Add("c", MakeLoadout("c", 3), Keys(20, {}));
+			writer.Add("d", MakeLoadout("d", 4));
+		}
+		svh::SceneFile scene;
+		Assert::IsTrue(scene.Open(path));
+		auto enemies = scene.IdsWithTag("enemy");
+		std::sort(enemies.begin(), enemies.end());
+		Assert::AreEqual(size_t(2), enemies.size());
+		Assert::AreEqual(to_wstring("b"), to_wstring(enemies[1]));
+		Assert::AreEqual(size_t(1), scene.IdsWithTag("boss").size());
+
+		svh::SceneBounds region = { { 9.5f, 0, 0 }, { 20.5f, 1, 1 } };
+		auto ids = scene.IdsInRegion(region);
+		std::sort(ids.begin(), ids.end());
+		Assert::AreEqual(size_t(2), ids.size());
+		Assert::AreEqual(to_wstring("c"), to_wstring(ids[1]));
+		Loadout loadout;
+		Assert::IsTrue(scene.LoadEntity(ids[1], loadout));
+		Assert::AreEqual(3, loadout.weapons[0].damage);
+		scene.Close();
+		std::filesystem::remove(path);
+	}
+
+	TEST_METHOD(Invalid) {
+		auto path = TempPath("invalid", ".svhs");
+		{
+			svh::SceneWriter writer(path);
+			writer.Add("soldier", MakeLoadout("soldier", 5));
+		}
+		svh::SceneFile scene;
+		Assert::IsTrue(scene.Open(path));
+		bool thrown = false;
+		try {
+			Inventory inventory;
+			scene.LoadEntity("soldier", inventory);
+		} catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		Assert::IsTrue(thrown);
+		scene.Close();
+
+		/* A scene whose writer never wrote the index */
+		std::filesystem::resize_file(path, std::filesystem::file_size(path) - 4);
+		Assert::IsFalse(scene.Open(path));
+		std::ofstream(path, std::ios::binary | std::ios::trunc) << "{}";
+		Assert::IsFalse(scene.Open(path));
+		std::filesystem::remove(path);
+	}
+
+	/* An index with fields of the wrong type skips those entries instead of throwing */
+	TEST_METHOD(MalformedIndex) {
+		auto path = TempPath("malformed", ".svhs");
+		{
+			svh::SceneWriter writer(path);
+			writer.Add("soldier", MakeLoadout("soldier", 5), Keys(0, { "unit" }));
+		}
+		std::vector<char> bytes(static_cast<std::size_t>(std::filesystem::file_size(path)));
+		std::ifstream(path, std::ios::binary).read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+		std::vector<char> trailer(bytes.end() - svh::SCENE_TRAILER_SIZE, bytes.end());
+		std::uint64_t index_offset = 0;
+		std::memcpy(&index_offset, trailer.data(), sizeof(index_offset));
+		svh::json entries = svh::json::from_msgpack(std::vector<std::uint8_t>(bytes.begin() + index_offset, bytes.end() - svh::SCENE_TRAILER_SIZE));
+		const svh::json valid = entries[0];
+
+		const svh::json broken[] = {
+			{ { "id", 5 } },
+			{ { "tags", "unit" } },
+			{ { "tags", { 1, 2 } } },
+			{ { "bounds", { "a", 0, 0, 1, 1, 1 } } },
+			{ { "offset", "zero" } },
+		};
+		for (const auto& patch : broken) {
+			svh::json entry = valid;
+			entry.update(patch);
+			const std::vector<std::uint8_t> index = svh::json::to_msgpack(svh::json::array({ entry, valid }));
+			const std::uint64_t index_length = index.size();
+			std::memcpy(trailer.data() + 8, &index_length, sizeof(index_length));
+			{
+				std::ofstream file(path, std::ios::binary | std::ios::trunc);
+				file.write(bytes.data(), static_cast<std::streamsize>(index_offset));
+				file.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size()));
+				file.write(trailer.data(), static_cast<std::streamsize>(trailer.size()));
+			}
+			svh::SceneFile scene;
+			Assert::IsTrue(scene.Open(path), to_wstring(patch.dump()).c_str());
+			Assert::AreEqual(size_t(1), scene.Size());
+			Loadout loaded;
+			Assert::IsTrue(scene.LoadEntity("soldier", loaded));
+		}
+		std::filesystem::remove(path);
+	}
+
+	TEST_METHOD(RandomAccess) {
+		const int count = 20000;
+		auto path = TempPath("random", ".svhs");
+		auto json_path = TempPath("random_json", ".svhs");
+		{
+			svh::SceneWriter writer(path);
+			svh::json all = svh::json::object();
+			for (int i = 0; i < count; ++i) {
+				Loadout loadout = MakeLoadout("unit " + std::to_string(i), i);
+				writer.Add(std::to_string(i), loadout, Keys(static_cast<float>(i), {}));
+				all[std::to_string(i)] = svh::Serializer::ToJson(loadout);
+			}
+			std::ofstream(json_path) << all.dump();
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		std::ifstream json_file(json_path);
+		svh::json all = svh::json::parse(json_file);
+		Loadout from_json;
+		svh::Deserializer::FromJson(all["12345"], from_json);
+		auto parsed = std::chrono::high_resolution_clock::now();
+
+		svh::SceneFile scene;
+		Assert::IsTrue(scene.Open(path));
+		auto opened = std::chrono::high_resolution_clock::now();
+		Loadout loadout;
+		Assert::IsTrue(scene.LoadEntity("12345", loadout));
+		auto loaded = std::chrono::high_resolution_clock::now();
+		Assert::AreEqual(12345, loadout.weapons[0].damage);
+		Assert::IsTrue(svh::Compare::GetChanges(from_json, loadout).is_null());
+
+		auto ms = [](auto a, auto b) { return std::to_wstring(std::chrono::duration<double, std::milli>(b - a).count()); };
+		std::wstring message = L"Whole json file: " + ms(start, parsed) + L" ms, scene open: " + ms(parsed, opened) + L" ms, one entity: " + ms(opened, loaded) + L" ms";
+		Logger::WriteMessage(message.c_str());
+		scene.Close();
+		json_file.close();
+		std::filesystem::remove(path);
+		std::filesystem::remove(json_path);
+	}
+	};
+}
@@ -0,0 +1,180 @@
+﻿#pragma once
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "svh/serializer.hpp"
+#include "svh/schema.hpp"
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <fstream>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace schema_tests {
+
+	struct StatsV1 {
+		int hp = 0;
+		float speed = 0;
+	};
+
+	struct UnitV1 {
+		std::string name;
+		StatsV1 stats;
+		int armor = 0;
+	};
+
+	struct Stats {
+		int health = 0;
+		float speed = 0;
+	};
+
+	struct Unit {
+		std::string name;
+		Stats stats;
+		std::vector<std::string> tags;
+	};
+
+	struct UnitV2 {
+		std::string name;
+		Stats stats;
+	};
+}
+
+VISITABLE_STRUCT(schema_tests::StatsV1, hp, speed);
+VISITABLE_STRUCT(schema_tests::UnitV1, name, stats, armor);
+VISITABLE_STRUCT(schema_tests::Stats, health, speed);
+VISITABLE_STRUCT(schema_tests::Unit, name, stats, tags);
+VISITABLE_STRUCT(schema_tests::UnitV2, name, stats);
+
+namespace schema_tests {
+
+	/* UnitV1 -> UnitV2 renames stats.hp and drops armor, UnitV2 -> Unit adds tags */
+	static svh::Migrations MakeMigrations() {
+		svh::Migrations migrations;
+		const std::uint64_t v1 = svh::Schema::Fingerprint<UnitV1>();
+		const std::uint64_t v2 = svh::Schema::Fingerprint<UnitV2>();
+		migrations.Add(v1, v2, [](svh::json& document) {
+			svh::Migrations::Rename("hp", "health", "/stats")(document);
+			svh::Migrations::Remove("armor")(document);
+		});
+		migrations.Add(v2, svh::Schema::Fingerprint<Unit>(), svh::Migrations::AddField("tags", svh::json::array({ "legacy" })));
+		return migrations;
+	}
+
+	TEST_CLASS(Schema) {
+public:
+	TEST_METHOD(Fingerprints) {
+		static_assert(svh::Schema::Fingerprint<Unit>() != 0, "Fingerprint is computed at compile time");
+		Assert::IsTrue(svh::Schema::Fingerprint<Unit>() != svh::Schema::Fingerprint<UnitV1>());
+		Assert::IsTrue(svh::Schema::Fingerprint<Unit>() != svh::Schema::Fingerprint<UnitV2>());
+		Assert::IsTrue(svh::Schema::Fingerprint<Stats>() != svh::Schema::Fingerprint<StatsV1>());
+	}
+
+	TEST_METHOD(CurrentRoundTrip) {
+		Unit unit{ "knight", { 120, 4.5f }, { "melee", "armored" } };
+		svh::json document = svh::Schema::ToJson(unit);
+		Assert::AreEqual(std::string(svh::SCHEMA_KEY), document.begin().key());
+		Assert::IsTrue(svh::Schema::IsCurrent<Unit>(document));
+		Assert::AreEqual(svh::Schema::Fingerprint<Unit>(), svh::Migrations::ReadFingerprint(document));
+
+		Unit loaded;
+		svh::Migrations none;
+		Assert::IsTrue(svh::Schema::FromJson(document, loaded, none));
+		Assert::AreEqual(std::string("knight"), loaded.name);
+		Assert::AreEqual(120, loaded.stats.health);
+		Assert::AreEqual(4.5f, loaded.stats.speed);
+		Assert::AreEqual(size_t(2), loaded.tags.size());
+	}
+
+	TEST_METHOD(MigrateChain) {
+		UnitV1 old{ "archer", { 80, 6.0f }, 3 };
+		svh::json document = svh::Schema::ToJson(old);
+		const svh::Migrations migrations = MakeMigrations();
+
+		Unit loaded;
+		Assert::IsTrue(svh::Schema::FromJson(document, loaded, migrations));
+		Assert::AreEqual(std::string("archer"), loaded.name);
+		Assert::AreEqual(80, loaded.stats.health);
+		Assert::AreEqual(6.0f, loaded.stats.speed);
+		Assert::AreEqual(size_t(1), loaded.tags.size());
+		Assert::AreEqual(std::string("legacy"), loaded.tags[0]);
+		/* The document itself is left as it was */
+		Assert::IsTrue(document["stats"].contains("hp"));
+	}
+
+	TEST_METHOD(Upgrade) {
+		svh::json document = svh::Schema::ToJson(UnitV1{ "archer", { 80, 6.0f }, 3 });
+		const svh::Migrations migrations = MakeMigrations();
+		Assert::IsTrue(migrations.CanUpgrade(svh::Schema::Fingerprint<UnitV1>(), svh::Schema::Fingerprint<Unit>()));
+		Assert::IsFalse(migrations.CanUpgrade(svh::Schema::Fingerprint<Unit>(), svh::Schema::Fingerprint<UnitV1>()));
+
+		Assert::IsTrue(migrations.Upgrade(document, svh::Schema::Fingerprint<Unit>()));
+		Assert::IsTrue(svh::Schema::IsCurrent<Unit>(document));
+		Assert::IsFalse(document.contains("armor"));
+		Assert::AreEqual(80, document["stats"]["health"].get<int>());
+		/* Upgrading a current document is a no-op */
+		Assert::IsTrue(migrations.Upgrade(document, svh::Schema::Fingerprint<Unit>()));
+	}
+
+	TEST_METHOD(NoPath) {
+		svh::json document = svh::Schema::ToJson(UnitV1{ "archer", { 80, 6.0f }, 3 });
+		svh::Migrations migrations;
+		migrations.Add(svh::Schema::Fingerprint<UnitV2>(), svh::Schema::Fingerprint<Unit>(), svh::Migrations::AddField("tags", svh::json::array()));
+
+		Unit loaded;
+		Assert::IsFalse(svh::Schema::FromJson(document, loaded, migrations));
+		/* Fields with the same name are still read */
+		Assert::AreEqual(std::string("archer"), loaded.name);
+		Assert::AreEqual(0, loaded.stats.health);
+		Assert::IsFalse(migrations.Upgrade(document, svh::Schema::Fingerprint<Unit>()));
+		Assert::IsTrue(document["stats"].contains("hp"));
+	}
+
+	TEST_METHOD(Unversioned) {
+		/* Written before fingerprints, starts at 0 */
+		svh::json document = svh::Serializer::ToJson(UnitV2{ "mage", { 50, 3.0f } });
+		svh::Migrations migrations;
+		migrations.Add(0, svh::Schema::Fingerprint<Unit>(), svh::Migrations::AddField("tags", svh::json::array({ "caster" })));
+
+		Unit loaded;
+		Assert::IsTrue(svh::Schema::FromJson(document, loaded, migrations));
+		Assert::AreEqual(50, loaded.stats.health);
+		Assert::AreEqual(std::string("caster"), loaded.tags[0]);
+
+		/* With steps registered but none from 0 there is no path */
+		svh::Migrations other;
+		other.Add(svh::Schema::Fingerprint<UnitV2>(), svh::Schema::Fingerprint<Unit>(), svh::Migrations::AddField("tags", svh::json::array()));
+		Unit unversioned;
+		Assert::IsFalse(svh::Schema::FromJson(document, unversioned, other));
+		Assert::AreEqual(std::string("mage"), unversioned.name);
+	}
+
+	TEST_METHOD(UpgradeFile) {
+		const std::string path = "schema_tests_unit.json";
+		{
+			std::ofstream file(path);
+			file << svh::Schema::ToJson(UnitV1{ "archer", { 80, 6.0f }, 3 }).dump(1, '\t');
+		}
+		Assert::IsTrue(MakeMigrations().UpgradeFile(path, svh::Schema::Fingerprint<Unit>()));
+
+		std::ifstream file(path);
+		svh::json document = svh::json::parse(file);
+		file.close();
+		std::remove(path.c_str());
+		Assert::IsTrue(svh::Schema::IsCurrent<Unit>(document));
+		Assert::AreEqual(80, document["stats"]["health"].get<int>());
+	}
+
+	TEST_METHOD(FieldOrder) {
+		/* Keys out of field order are still found */
+		svh::json document = { { "tags", { "a" } }, { "stats", { { "speed", 2.0f }, { "health", 7 } } }, { "name", "scout" } };
+		Unit loaded;
+		svh::Deserializer::FromJson(document, loaded);
+		Assert::AreEqual(std::string("scout"), loaded.name);
+		Assert::AreEqual(7, loaded.stats.health);
+		Assert::AreEqual(2.0f, loaded.stats.speed);
+		Assert::AreEqual(size_t(1), loaded.tags.size());
+	}
+	};
+}
@@ -252,6 +252,10 @@ public:
 		std::map<std::string, int> m;
 		CheckSerialization(m, svh::json::object({}));
 	}
+	TEST_METHOD(IntMap) {
+		std::map<int, int> m{ {-1,1},{20,2} };
+		CheckSerialization(m, svh::json::object({ {"-1",1},{"20",2} }));
+	}
 
 	TEST_METHOD(MapOfMaps) {
 		std::map<std::string, std::map<std::string, int>> mm{
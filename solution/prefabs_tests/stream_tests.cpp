@@ -0,0 +1,151 @@
+﻿#pragma once
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "svh/serializer.hpp"
+#include "svh/stream.hpp"
+
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <filesystem>
+#include <chrono>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace stream_tests {
+
+	static std::wstring to_wstring(const std::string& s) {
+		return std::wstring(s.begin(), s.end());
+	}
+
+	static Loadout MakeRecord(int i) {
+		Loadout loadout;
+		loadout.name = "unit \"" + std::to_string(i) + "\" [a, {b}]";
+		loadout.stats = { i, i + 1, i + 2 };
+		loadout.weapons = { { "rifle", i % 10 } };
+		loadout.slots = { { 0, "head" }, { 1, "chest\\n" } };
+		loadout.upgrades = { { "armor", { 1, 2, 3 } } };
+		return loadout;
+	}
+
+	template<typename T>
+	static std::vector<T> ReadAll(svh::StreamReader<T>& reader) {
+		std::vector<T> values;
+		T value;
+		while (reader.Next(value)) {
+			values.push_back(value);
+		}
+		return values;
+	}
+
+	/* Raise to several GB to benchmark, memory stays the same */
+	constexpr int BENCHMARK_RECORDS = 100000;
+
+	TEST_CLASS(Stream) {
+public:
+	TEST_METHOD(Lines) {
+		std::stringstream stream;
+		{
+			svh::StreamWriter<Loadout> writer(stream);
+			for (int i = 0; i < 3; ++i) writer.Write(MakeRecord(i));
+			Assert::AreEqual(size_t(3), writer.Count());
+		}
+		std::string text = stream.str();
+		Assert::AreEqual(size_t(3), static_cast<size_t>(std::count(text.begin(), text.end(), '\n')));
+
+		svh::StreamReader<Loadout> reader(stream);
+		auto values = ReadAll(reader);
+		Assert::AreEqual(size_t(3), values.size());
+		Assert::IsTrue(svh::Compare::GetChanges(MakeRecord(2), values[2]).empty());
+	}
+
+	TEST_METHOD(Array) {
+		std::stringstream stream;
+		{
+			svh::StreamWriter<Loadout> writer(stream, svh::StreamFormat::Array);
+			for (int i = 0; i < 3; ++i) writer.Write(MakeRecord(i));
+		}
+		Assert::IsFalse(svh::json::parse(stream.str(), nullptr, false).is_discarded());
+		svh::StreamReader<Loadout> reader(stream);
+		auto values = ReadAll(reader);
+		Assert::AreEqual(size_t(3), values.size());
+		Assert::IsTrue(svh::Compare::GetChanges(MakeRecord(1), values[1]).empty());
+
+		/* Pretty printed arrays and arrays of plain values */
+		std::stringstream pretty(svh::Serializer::ToJson(std::vector<Loadout>{ MakeRecord(4), MakeRecord(5) }).dump(1, '\t'));
+		svh::StreamReader<Loadout> pretty_reader(pretty);
+		Assert::AreEqual(5, ReadAll(pretty_reader)[1].weapons[0].damage);
+		std::stringstream numbers("[1, 2,3 ]");
+		svh::StreamReader<int> number_reader(numbers);
+		Assert::AreEqual(size_t(3), ReadAll(number_reader).size());
+		std::stringstream strings("[\"a]\", \"b\\\"\"]");
+		svh::StreamReader<std::string> string_reader(strings);
+		Assert::AreEqual(to_wstring("b\""), to_wstring(ReadAll(string_reader)[1]));
+
+		/* Whitespace before the array is skipped before the format is decided */
+		std::stringstream leading("\n \t[1,2,3]");
+		svh::StreamReader<int> leading_reader(leading);
+		auto leading_values = ReadAll(leading_reader);
+		Assert::AreEqual(size_t(3), leading_values.size());
+		Assert::AreEqual(3, leading_values[2]);
+	}
+
+	TEST_METHOD(Empty) {
+		std::stringstream array;
+		{
+			svh::StreamWriter<Loadout> writer(array, svh::StreamFormat::Array);
+		}
+		Assert::AreEqual(to_wstring("[]\n"), to_wstring(array.str()));
+		svh::StreamReader<Loadout> reader(array);
+		Assert::AreEqual(size_t(0), ReadAll(reader).size());
+
+		std::stringstream empty;
+		svh::StreamReader<Loadout> empty_reader(empty);
+		Assert::AreEqual(size_t(0), ReadAll(empty_reader).size());
+	}
+
+	TEST_METHOD(InvalidRecord) {
+		std::stringstream stream("{\"name\": \"a\"}\n{\"name\": }\n");
+		svh::StreamReader<Loadout> reader(stream);
+		Loadout value;
+		Assert::IsTrue(reader.Next(value));
+		bool thrown = false;
+		try {
+			reader.Next(value);
+		} catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		Assert::IsTrue(thrown);
+	}
+
+	TEST_METHOD(Throughput) {
+		for (auto format : { svh::StreamFormat::Lines, svh::StreamFormat::Array }) {
+			auto path = (std::filesystem::temp_directory_path() / "svh_stream.json").string();
+			auto start = std::chrono::high_resolution_clock::now();
+			{
+				svh::StreamWriter<Loadout> writer(path, format);
+				for (int i = 0; i < BENCHMARK_RECORDS; ++i) writer.Write(MakeRecord(i));
+				Assert::IsTrue(writer.Good());
+			}
+			auto written = std::chrono::high_resolution_clock::now();
+			svh::StreamReader<Loadout> reader(path);
+			Loadout value;
+			int records = 0;
+			while (reader.Next(value)) ++records;
+			auto end = std::chrono::high_resolution_clock::now();
+
+			Assert::AreEqual(BENCHMARK_RECORDS, records);
+			/* The buffers only hold the largest record and one chunk */
+			Assert::IsTrue(reader.BufferCapacity() < svh::StreamReader<Loadout>::CHUNK_SIZE + 4096);
+
+			const double megabytes = std::filesystem::file_size(path) / 1048576.0;
+			const double write_s = std::chrono::duration<double>(written - start).count();
+			const double read_s = std::chrono::duration<double>(end - written).count();
+			std::wstring message = std::wstring(format == svh::StreamFormat::Lines ? L"NDJSON " : L"Array ") + std::to_wstring(megabytes) + L" MB: write " + std::to_wstring(megabytes / write_s) + L" MB/s, read " + std::to_wstring(megabytes / read_s) + L" MB/s";
+			Logger::WriteMessage(message.c_str());
+			std::filesystem::remove(path);
+		}
+	}
+	};
+}
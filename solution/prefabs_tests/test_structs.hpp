@@ -5,6 +5,9 @@
 
 #include <svh/defines.hpp>
 
+#include <filesystem>
+#include <string>
+
 namespace glm {
 	inline svh::json SerializeImpl(const glm::vec3& v) {
 		return svh::json::array({ v.x, v.y, v.z });
@@ -84,48 +87,6 @@ VISITABLE_STRUCT(DerivedComponent, name, value, id);
 enum class Color { Red, Green, Blue };
 enum class Direction { North, South, East, West };
 
-
-
-inline svh::json SerializeImpl(const Color& c) {
-	switch (c) {
-	case Color::Red: return svh::json("Red");
-	case Color::Green: return svh::json("Green");
-	case Color::Blue: return svh::json("Blue");
-	default: return svh::json("Unknown");
-	}
-}
-
-inline void DeserializeImpl(const svh::json& j, Color& c) {
-	if (j.is_string()) {
-		std::string color_str = j.get<std::string>();
-		if (color_str == "Red") c = Color::Red;
-		else if (color_str == "Green") c = Color::Green;
-		else if (color_str == "Blue") c = Color::Blue;
-		else c = Color::Red; // Default case
-	}
-}
-
-inline svh::json SerializeImpl(const Direction& d) {
-	switch (d) {
-	case Direction::North: return svh::json("North");
-	case Direction::South: return svh::json("South");
-	case Direction::East: return svh::json("East");
-	case Direction::West: return svh::json("West");
-	default: return svh::json("Unknown");
-	}
-}
-
-inline void DeserializeImpl(const svh::json& j, Direction& d) {
-	if (j.is_string()) {
-		std::string direction_str = j.get<std::string>();
-		if (direction_str == "North") d = Direction::North;
-		else if (direction_str == "South") d = Direction::South;
-		else if (direction_str == "East") d = Direction::East;
-		else if (direction_str == "West") d = Direction::West;
-		else d = Direction::North; // Default case
-	}
-}
-
 struct MyStruct {
 	int a = 0;
 	float b = 0.0f;
@@ -206,3 +167,31 @@ struct PlayerEntity {
 	std::optional<SkillTree> skill_tree;
 };
 VISITABLE_STRUCT(PlayerEntity, id, transform, inventory, weapons, armors, skill_tree);
+
+struct Loadout {
+	std::string name;
+	std::vector<int> stats;
+	std::vector<Weapon> weapons;
+	std::map<int, std::string> slots;
+	std::map<std::string, std::vector<int>> upgrades;
+	std::shared_ptr<ItemHolder> holder;
+};
+VISITABLE_STRUCT(Loadout, name, stats, weapons, slots, upgrades, holder);
+
+/* A soldier with one rifle, shared by the tests that write prefabs to files */
+inline Loadout MakeLoadout(const std::string& name = "soldier", int damage = 5) {
+	Loadout loadout;
+	loadout.name = name;
+	loadout.stats = { 10, 20, 30 };
+	loadout.weapons = { { "rifle", damage } };
+	loadout.slots = { { 0, "head" }, { 1, "chest" } };
+	return loadout;
+}
+
+/* A path in the temp directory, a file left there by an earlier run is removed */
+inline std::string TempPath(const std::string& name, const std::string& extension) {
+	auto path = std::filesystem::temp_directory_path() / ("svh_" + name + extension);
+	std::error_code error;
+	std::filesystem::remove(path, error);
+	return path.string();
+}
@@ -0,0 +1,190 @@
+﻿#pragma once
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "svh/serializer.hpp"
+#include "svh/view.hpp"
+
+#include <vector>
+#include <string>
+#include <map>
+#include <chrono>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace view_tests {
+
+	static std::wstring to_wstring(const std::string_view& s) {
+		return std::wstring(s.begin(), s.end());
+	}
+
+	struct WeaponStats {
+		std::string name;
+		int damage;
+		float fire_rate;
+		bool automatic;
+		std::vector<float> falloff;
+	};
+
+	struct Drop {
+		std::string item;
+		float chance;
+	};
+
+	struct LootTable {
+		std::string name;
+		std::vector<Drop> drops;
+		std::vector<WeaponStats> weapons;
+		std::map<std::string, int> weights;
+		std::vector<std::string> tags;
+		int rolls[2];
+	};
+
+	static WeaponStats MakeWeapon(int i) {
+		return { "weapon " + std::to_string(i), i, 0.5f * i, i % 2 == 0, { 1.0f, 0.75f, 0.5f } };
+	}
+
+	static LootTable MakeTable(int weapons) {
+		LootTable table;
+		table.name = "crate";
+		table.drops = { { "ammo", 0.5f }, { "medkit", 0.25f }, { "", 0.0f } };
+		for (int i = 0; i < weapons; ++i) {
+			table.weapons.push_back(MakeWeapon(i));
+		}
+		table.weights = { { "common", 10 }, { "rare", 1 } };
+		table.rolls[0] = 1;
+		table.rolls[1] = 3;
+		return table;
+	}
+
+	/* True if Open reports an error */
+	template<typename T>
+	static bool Rejects(const std::vector<std::uint8_t>& bytes) {
+		try {
+			return !svh::View<T>::Open(bytes);
+		} catch (const std::runtime_error&) {
+			return true;
+		}
+	}
+}
+
+VISITABLE_STRUCT(view_tests::WeaponStats, name, damage, fire_rate, automatic, falloff);
+VISITABLE_STRUCT(view_tests::Drop, item, chance);
+VISITABLE_STRUCT(view_tests::LootTable, name, drops, weapons, weights, tags, rolls);
+
+namespace view_tests {
+
+	TEST_CLASS(View) {
+public:
+	TEST_METHOD(Fields) {
+		const auto bytes = svh::ViewFormat::Write(MakeWeapon(4));
+		auto view = svh::View<WeaponStats>::Open(bytes);
+		Assert::IsTrue(view.IsValid());
+		Assert::AreEqual(to_wstring("weapon 4"), to_wstring(view.Get<&WeaponStats::name>()));
+		Assert::AreEqual(4, view.Get<&WeaponStats::damage>());
+		Assert::AreEqual(2.0f, view.Get<&WeaponStats::fire_rate>());
+		Assert::IsTrue(view.Get<&WeaponStats::automatic>());
+		Assert::AreEqual(4, view.At<1>());
+
+		auto falloff = view.Get<&WeaponStats::falloff>();
+		Assert::AreEqual(size_t(3), falloff.Size());
+		Assert::AreEqual(0.75f, falloff[1]);
+		/* Raw elements are read in place */
+		Assert::AreEqual(0.5f, falloff.Data()[2]);
+		Assert::AreEqual(size_t(0), reinterpret_cast<std::uintptr_t>(falloff.Data()) % alignof(float));
+
+		/* Offsets are constants from the VISITABLE_STRUCT metadata */
+		static_assert(svh::ViewFormat::FieldOffset<WeaponStats, 2>() == 8);
+		static_assert(svh::ViewFormat::SlotSize<WeaponStats>() == 17);
+	}
+
+	TEST_METHOD(Nested) {
+		const LootTable table = MakeTable(10);
+		const auto bytes = svh::ViewFormat::Write(table);
+		auto view = svh::View<LootTable>::Open(bytes);
+		Assert::AreEqual(to_wstring("crate"), to_wstring(view.Get<&LootTable::name>()));
+
+		auto drops = view.Get<&LootTable::drops>();
+		Assert::AreEqual(size_t(3), drops.Size());
+		Assert::AreEqual(to_wstring("medkit"), to_wstring(drops[1].Get<&Drop::item>()));
+		Assert::AreEqual(to_wstring(""), to_wstring(drops[2].Get<&Drop::item>()));
+		Assert::AreEqual(0.25f, drops[1].Get<&Drop::chance>());
+
+		int damage = 0;
+		for (auto weapon : view.Get<&LootTable::weapons>()) {
+			damage += weapon.Get<&WeaponStats::damage>();
+		}
+		Assert::AreEqual(45, damage);
+		Assert::AreEqual(to_wstring("weapon 7"), to_wstring(view.Get<&LootTable::weapons>()[7].Get<&WeaponStats::name>()));
+		Assert::AreEqual(0.5f, view.Get<&LootTable::weapons>()[7].Get<&WeaponStats::falloff>()[2]);
+
+		/* Maps are not laid out for views, they are decoded when read */
+		auto weights = view.Get<&LootTable::weights>();
+		Assert::AreEqual(1, weights["rare"]);
+		Assert::IsTrue(view.Get<&LootTable::tags>().Empty());
+		Assert::AreEqual(3, view.Get<&LootTable::rolls>()[1]);
+	}
+
+	TEST_METHOD(Recursive) {
+		SkillTree tree;
+		tree.skills = { { "combat", 1, { { "swords", 2, {} }, { "bows", 3, { { "longbow", 4, {} } } } } } };
+		const auto bytes = svh::ViewFormat::Write(tree);
+		auto view = svh::View<SkillTree>::Open(bytes);
+		auto combat = view.Get<&SkillTree::skills>()[0];
+		auto longbow = combat.Get<&Skill::subskills>()[1].Get<&Skill::subskills>()[0];
+		Assert::AreEqual(to_wstring("longbow"), to_wstring(longbow.Get<&Skill::name>()));
+		Assert::AreEqual(4, longbow.Get<&Skill::level>());
+	}
+
+	TEST_METHOD(Invalid) {
+		auto bytes = svh::ViewFormat::Write(MakeWeapon(1));
+		Assert::IsTrue(Rejects<Drop>(bytes));
+		Assert::IsTrue(Rejects<WeaponStats>({ 1, 2, 3 }));
+		Assert::IsTrue(Rejects<WeaponStats>(svh::Binary::Write(MakeWeapon(1))));
+
+		/* An offset past the end of the buffer reads as empty instead of out of bounds */
+		const std::uint32_t corrupt = 0xfffffff0u;
+		std::memcpy(bytes.data() + svh::VIEW_HEADER_SIZE, &corrupt, sizeof(corrupt));
+		auto view = svh::View<WeaponStats>::Open(bytes);
+		Assert::IsTrue(view.Get<&WeaponStats::name>().empty());
+		Assert::AreEqual(1, view.Get<&WeaponStats::damage>());
+
+		/* What Open returns when errors do not throw, its fields read as defaults */
+		svh::View<LootTable> invalid;
+		Assert::IsFalse(invalid.IsValid());
+		Assert::IsTrue(invalid.Get<&LootTable::name>().empty());
+		Assert::IsTrue(invalid.Get<&LootTable::drops>().Empty());
+		Assert::IsTrue(invalid.Get<&LootTable::weights>().empty());
+		Assert::AreEqual(0, svh::View<WeaponStats>().Get<&WeaponStats::damage>());
+	}
+
+	TEST_METHOD(Performance) {
+		const LootTable table = MakeTable(100000);
+		const auto view_bytes = svh::ViewFormat::Write(table);
+		const auto binary_bytes = svh::Binary::Write(table);
+
+		/* One field of one weapon */
+		auto start = std::chrono::high_resolution_clock::now();
+		const int viewed = svh::View<LootTable>::Open(view_bytes).Get<&LootTable::weapons>()[54321].Get<&WeaponStats::damage>();
+		auto view_one = std::chrono::high_resolution_clock::now();
+		LootTable loaded;
+		svh::Binary::Read(binary_bytes, loaded);
+		const int read = loaded.weapons[54321].damage;
+		auto binary_one = std::chrono::high_resolution_clock::now();
+		Assert::AreEqual(54321, viewed);
+		Assert::AreEqual(54321, read);
+
+		/* One field of every weapon */
+		long long sum = 0;
+		for (auto weapon : svh::View<LootTable>::Open(view_bytes).Get<&LootTable::weapons>()) {
+			sum += weapon.Get<&WeaponStats::damage>();
+		}
+		auto view_all = std::chrono::high_resolution_clock::now();
+		Assert::AreEqual(100000LL * 99999 / 2, sum);
+
+		auto us = [](auto a, auto b) { return std::to_wstring(std::chrono::duration<double, std::micro>(b - a).count()); };
+		std::wstring message = L"One field: view " + us(start, view_one) + L" us, Binary::Read " + us(view_one, binary_one) +
+			L" us. Every weapon through the view: " + us(binary_one, view_all) + L" us";
+		Logger::WriteMessage(message.c_str());
+	}
+	};
+}